@@ -0,0 +1,307 @@
+/**
+ * Immutable binary tree with arena-allocated nodes
+ * For workloads that build many trees and then drop all of them together:
+ * nodes are bump-allocated from the chunks of a TreeArena, carry no reference
+ * counts, and are all released at once when the arena is.
+ */
+#ifndef __ARENA_BINTREE_H
+#define __ARENA_BINTREE_H
+
+#include "Exceptions.h"
+#include "NodePool.h"        // Chunks of nodes
+#include "Stack.h"           // Nodes to destroy, if elements need it
+#include "BinTreeIterator.h" // Lazy traversals
+#include <iomanip>           // setw
+#include <iostream>          // endl
+#include <utility>           // move, forward
+
+template <typename T> class TreeArena;
+
+/**
+ * Binary tree whose nodes belong to a TreeArena. Same observers as BinTree,
+ * but trees are just a pointer to their root: copying, assigning or
+ * destroying them is O(1), and never touches the nodes. In exchange, trees
+ * (and any trees built from them) are only valid while the arena that holds
+ * their nodes is alive and has not been released.
+ *
+ * Operations are:
+ * - ArenaBinTree constructors: generators; non-empty trees are built in an arena
+ * - left, right: observers, return left or right children of a tree (also trees!)
+ * - elem: observer, returns element at root
+ * - empty: observer, returning true IFF a tree is empty
+ * - nodeCount, depth: observers
+ * - begin(order), end(), traversal(order): observers, iterate through elements in
+ *      any TraversalOrder (see BinTreeIterator.h)
+ *
+ * Nodes are never modified once built, so subtrees can be shared freely.
+ */
+template <typename T>
+class ArenaBinTree {
+protected:
+    class Node; // Forward declaration, for iterators
+
+public:
+
+    /** Constructor; returns an empty tree */
+    ArenaBinTree() : _root(nullptr) {}
+
+    /** Constructor; returns a tree from left + element + right, built in arena. O(1) */
+    ArenaBinTree(TreeArena<T> &arena, const ArenaBinTree &left, const T &elem, const ArenaBinTree &right) :
+            _root(arena.create(left._root, elem, right._root)) {}
+
+    /** Same as ArenaBinTree(arena, left, elem, right), but moves elem instead of copying it */
+    ArenaBinTree(TreeArena<T> &arena, const ArenaBinTree &left, T &&elem, const ArenaBinTree &right) :
+            _root(arena.create(left._root, std::move(elem), right._root)) {}
+
+    /** Constructor; returns a leaf containing elem, built in arena. O(1) */
+    ArenaBinTree(TreeArena<T> &arena, const T &elem) :
+            _root(arena.create(nullptr, elem, nullptr)) {}
+
+    /** Same as ArenaBinTree(arena, elem), but moves elem instead of copying it */
+    ArenaBinTree(TreeArena<T> &arena, T &&elem) :
+            _root(arena.create(nullptr, std::move(elem), nullptr)) {}
+
+    /**
+     * Returns element at root.
+     * Partial observer, O(1)
+     */
+    const T &elem() const {
+        if (empty()) {
+            throw EmptyTreeException();
+        }
+        return _root->_elem;
+    }
+
+    /**
+     * Returns left subtree. Fails if tree is empty.
+     * Partial observer, O(1)
+     */
+    ArenaBinTree left() const {
+        if (empty()) {
+            throw EmptyTreeException();
+        }
+        return ArenaBinTree(_root->_left);
+    }
+
+    /**
+     * Returns right subtree. Fails if tree is empty.
+     * Partial observer, O(1)
+     */
+    ArenaBinTree right() const {
+        if (empty()) {
+            throw EmptyTreeException();
+        }
+        return ArenaBinTree(_root->_right);
+    }
+
+    /**
+     * Returns true IFF tree is empty.
+     * Observer, O(1)
+     */
+    bool empty() const {
+        return _root == nullptr;
+    }
+
+    /** Returns the number of nodes in a tree. O(n) */
+    unsigned int nodeCount() const {
+        return nodeCountAux(_root);
+    }
+
+    /** Returns the depth of the tree. O(n) */
+    unsigned int depth() const {
+        return depthAux(_root);
+    }
+
+    // //
+    // LAZY TRAVERSALS; return references to elements, without copies
+    // //
+
+    /** Iterator over elements, in any TraversalOrder */
+    using ConstIterator = BinTreeIterator<T, Node>;
+
+    /** Returns an iterator at the 1st element in the given order. O(depth) */
+    ConstIterator begin(TraversalOrder order = TraversalOrder::IN_ORDER) const {
+        return ConstIterator(_root, order);
+    }
+
+    /** Returns an iterator past the last element, for any order. O(1) */
+    ConstIterator end() const {
+        return ConstIterator();
+    }
+
+    /**
+     * Returns a traversal in the given order, for range-based for loops:
+     *     for (const T &e : tree.traversal(TraversalOrder::PRE_ORDER)) ...
+     */
+    BinTreeTraversal<T, Node> traversal(TraversalOrder order) const {
+        return BinTreeTraversal<T, Node>(_root, order);
+    }
+
+    // //
+    // BOILERPLATE C++ CODE; copies are shallow, and free
+    // //
+
+    /** Comparison operators; structural, O(n) */
+    bool operator==(const ArenaBinTree &rhs) const {
+        return compareAux(_root, rhs._root);
+    }
+
+    bool operator!=(const ArenaBinTree &rhs) const {
+        return !(*this == rhs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, const ArenaBinTree& t){
+        o  << "==== Tree =====" << std::endl;
+        outputIndented(o, 0, t._root);
+        o << "===============" << std::endl;
+        return o;
+    }
+
+protected:
+    friend class TreeArena<T>;
+
+    /** used to generate output */
+    static const int TREE_INDENTATION = 4;
+
+    /**
+     * Internal node class; no reference count, since arenas free all nodes at once
+     */
+    class Node {
+    public:
+        template <typename TT>
+        Node(Node *left, TT &&elem, Node *right) :
+                _elem(std::forward<TT>(elem)), _left(left), _right(right) {}
+
+        T _elem;
+        Node *_left;
+        Node *_right;
+    };
+
+    /** Protected constructor, which wraps an existing root node */
+    explicit ArenaBinTree(Node *root) : _root(root) {}
+
+    static unsigned int nodeCountAux(Node *root) {
+        if (root == nullptr) {
+            return 0;
+        }
+        return 1 + nodeCountAux(root->_left) + nodeCountAux(root->_right);
+    }
+
+    static unsigned int depthAux(Node *root) {
+        if (root == nullptr) {
+            return 0;
+        }
+        unsigned int leftDepth = depthAux(root->_left);
+        unsigned int rightDepth = depthAux(root->_right);
+        return 1 + ((leftDepth > rightDepth) ? leftDepth : rightDepth);
+    }
+
+    static bool compareAux(Node *r1, Node *r2) {
+        if (r1 == r2) {
+            return true;
+        } else if ((r1 == nullptr) || (r2 == nullptr)) {
+            return false;
+        }
+        return (r1->_elem == r2->_elem) &&
+               compareAux(r1->_left, r2->_left) &&
+               compareAux(r1->_right, r2->_right);
+    }
+
+    static void outputIndented(std::ostream & out, int indent, Node* root){
+        if (root != nullptr) {
+            outputIndented(out, indent + TREE_INDENTATION, root->_right);
+            out << std::setw(indent) << " " << root->_elem << std::endl;
+            outputIndented(out, indent + TREE_INDENTATION, root->_left);
+        }
+    }
+
+    /** Root node; owned by an arena */
+    Node *_root;
+};
+
+/**
+ * Owner of the nodes of ArenaBinTrees. Nodes are carved out of a NodePool's
+ * chunks, and are never freed one by one:
+ *    - release(): frees all nodes, invalidating every tree built in the arena.
+ *          O(chunks) if elements are trivially destructible; otherwise, their
+ *          destructors must also run, in O(n)
+ *    - reserve(n): makes sure that the next n nodes will not allocate memory
+ *    - size(): number of nodes currently in the arena. O(1)
+ *
+ * Trees may combine nodes from several arenas, as long as all of them outlive
+ * the result. Arenas cannot be copied.
+ */
+template <typename T>
+class TreeArena {
+    using Node = typename ArenaBinTree<T>::Node;
+    using Pool = NodePool<Node>;
+
+public:
+
+    /** Constructor; an empty arena does not allocate anything. O(1) */
+    TreeArena() : _size(0) {}
+
+    /** Destructor; releases all nodes */
+    ~TreeArena() {
+        release();
+    }
+
+    /** Frees all nodes; trees built in this arena must no longer be used */
+    void release() {
+        if (Pool::NEEDS_DESTROY) {
+            while ( ! _live.empty()) {
+                _pool.destroy(_live.top());
+                _live.pop();
+            }
+        }
+        _pool.clear();
+        _size = 0;
+    }
+
+    /** Makes room for n more nodes, using a single chunk. O(1) */
+    void reserve(unsigned int n) {
+        _pool.reserve(n);
+        if (Pool::NEEDS_DESTROY) {
+            _live.reserve(_size + n);
+        }
+    }
+
+    /** Number of nodes built since the last release(). O(1) */
+    unsigned int size() const {
+        return _size;
+    }
+
+    // arenas own nodes; they cannot be copied
+    TreeArena(const TreeArena &other) = delete;
+    TreeArena &operator=(const TreeArena &other) = delete;
+
+private:
+    friend class ArenaBinTree<T>;
+
+    /** Builds a node; remembers it, if its element will need destroying. O(1) amortized */
+    template <typename TT>
+    Node *create(Node *left, TT &&elem, Node *right) {
+        Node *node = _pool.create(left, std::forward<TT>(elem), right);
+        if (Pool::NEEDS_DESTROY) {
+            try {
+                _live.push(node);
+            } catch (...) {
+                _pool.destroy(node);
+                throw;
+            }
+        }
+        _size++;
+        return node;
+    }
+
+    /** Chunks with all nodes */
+    Pool _pool;
+
+    /** Nodes to destroy on release(); only used if Pool::NEEDS_DESTROY */
+    Stack<Node *> _live;
+
+    /** Nodes built since last release */
+    unsigned int _size;
+};
+
+#endif // __ARENA_BINTREE_H
@@ -0,0 +1,380 @@
+/**
+ * Implementation of a Queue ADT (and double-ended queue) using a circular array
+ */
+#ifndef __ARRAY_QUEUE_H
+#define __ARRAY_QUEUE_H
+
+#include "Exceptions.h"
+#include <iostream>
+#include <cstdlib>      // malloc, free
+#include <cstring>      // memcpy
+#include <new>          // placement new, bad_alloc
+#include <type_traits>  // is_trivially_copyable
+#include <utility>      // move, forward
+
+/**
+ * Implementation of a Queue ADT using a circular array (ring buffer), with
+ * the same interface as Queue.h. Elements are stored contiguously, so
+ * pushing and popping never allocate (except when the array must grow), and
+ * consecutive elements share cache lines.
+ * Operations are:
+ *   - EmptyQueue: -> Queue. Queue (empty constructor)
+ *   - push_back: Queue, Elem -> Queue. Generator. Also emplace_back(args...), building in place
+ *   - pop_front: Queue -> Queue. Partial modifier
+ *   - front: Queue -> Elem. Partial observer
+ *   - empty: Queue -> Bool. Observer
+ *   - size: Queue -> Int. Observer
+ * And, as a double-ended queue:
+ *   - push_front: Queue, Elem -> Queue. Generator. Also emplace_front(args...)
+ *   - pop_back: Queue -> Queue. Partial modifier
+ *   - back: Queue -> Elem. Partial observer
+ *   - at(i): Queue, Int -> Elem. Partial observer; i-th element from the front
+ *   - reserve(n), capacity(): make room for n elements, and query room
+ *
+ * Capacity is always a power of 2, so that positions wrap around with a
+ * bit-mask instead of a modulo; and doubles each time the array runs out.
+ * As in Stack.h, unused positions are left uninitialized.
+ */
+template <class T>
+class ArrayQueue {
+public:
+
+    /** Capacity allocated by the first push; must be a power of 2. */
+    static const unsigned int INITIAL_CAPACITY = 16;
+
+    /** Largest capacity: the largest power of 2 that fits in an unsigned int */
+    static const unsigned int MAX_CAPACITY = 1u << 31;
+
+    /** Constructor; EmptyQueue operation. Does not allocate anything. O(1) */
+    ArrayQueue() : _data(nullptr), _capacity(0), _head(0), _size(0) {
+    }
+
+    /** Destructor; destroys elements and frees array. O(n) */
+    ~ArrayQueue() {
+        free();
+    }
+
+    /** Pushes an element at back. Generator. O(1) (amortized) */
+    void push_back(const T &_elem) {
+        emplace_back(_elem);
+    }
+
+    /** Pushes an element at back, moving it instead of copying it. Generator. O(1) (amortized) */
+    void push_back(T &&_elem) {
+        emplace_back(std::move(_elem));
+    }
+
+    /** Pushes an element at back, built in place from the given constructor arguments. O(1) (amortized) */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (_size == _capacity) {
+            growAndEmplace(false, std::forward<Args>(args)...);
+        } else {
+            new (_data + index(_size)) T(std::forward<Args>(args)...);
+        }
+        _size++;
+    }
+
+    /** Pushes an element at front. Generator. O(1) (amortized) */
+    void push_front(const T &_elem) {
+        emplace_front(_elem);
+    }
+
+    /** Pushes an element at front, moving it instead of copying it. Generator. O(1) (amortized) */
+    void push_front(T &&_elem) {
+        emplace_front(std::move(_elem));
+    }
+
+    /** Pushes an element at front, built in place from the given constructor arguments. O(1) (amortized) */
+    template <typename... Args>
+    void emplace_front(Args&&... args) {
+        if (_size == _capacity) {
+            growAndEmplace(true, std::forward<Args>(args)...);
+        } else {
+            unsigned int head = (_head - 1) & (_capacity - 1);
+            new (_data + head) T(std::forward<Args>(args)...);
+            _head = head;
+        }
+        _size++;
+    }
+
+    /**
+     * Pops an element (whichever is at the front, and would be returned by front()).
+     * Partial modifier (fails if empty). O(1)
+     */
+    void pop_front() {
+        if (empty()) {
+            throw EmptyQueueException("Cannot pop: Queue is empty");
+        }
+        _data[_head].~T();
+        _head = index(1);
+        --_size;
+    }
+
+    /**
+     * Pops an element (whichever is at the back, and would be returned by back()).
+     * Partial modifier (fails if empty). O(1)
+     */
+    void pop_back() {
+        if (empty()) {
+            throw EmptyQueueException("Cannot pop: Queue is empty");
+        }
+        --_size;
+        _data[index(_size)].~T();
+    }
+
+    /**
+     * Returns element at front (whichever would be popped by pop_front()).
+     * Partial observer (fails if empty). O(1)
+     */
+    const T &front() const {
+        if (empty()) {
+            throw EmptyQueueException("Cannot get front: Queue is empty");
+        }
+        return _data[_head];
+    }
+
+    /**
+     * Returns element at back (whichever would be popped by pop_back()).
+     * Partial observer (fails if empty). O(1)
+     */
+    const T &back() const {
+        if (empty()) {
+            throw EmptyQueueException("Cannot get back: Queue is empty");
+        }
+        return _data[index(_size - 1)];
+    }
+
+    /**
+     * Returns the i-th element, counting from the front (which is at(0)).
+     * Partial observer (fails if i is out of bounds). O(1)
+     */
+    const T &at(int i) const {
+        if (i < 0 || i >= static_cast<int>(_size)) {
+            throw InvalidAccessException("Invalid position in queue");
+        }
+        return _data[index(i)];
+    }
+
+    /** True IFF queue is empty. Observer. O(1) */
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /** Returns number of elements. Observer. O(1) */
+    int size() const {
+        return _size;
+    }
+
+    /** Returns number of elements that fit before the array must grow. Observer. O(1) */
+    int capacity() const {
+        return _capacity;
+    }
+
+    /**
+     * Makes sure that n elements fit without growing again, rounding up
+     * to a power of 2. Mutator. O(size()) if the array must grow, O(1) otherwise
+     */
+    void reserve(unsigned int n) {
+        if (n > _capacity) {
+            unsigned int capacity = roundUp(n);
+            relocate(allocate(capacity), capacity);
+            _head = 0;
+        }
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /** Copy ctor. O(n) */
+    ArrayQueue(const ArrayQueue<T> &other) : _data(nullptr), _capacity(0), _head(0), _size(0) {
+        copy(other);
+    }
+
+    /** Assignment constructor. O(n) */
+    ArrayQueue<T> &operator=(const ArrayQueue<T> &other) {
+        if (this != &other) {
+            free();
+            copy(other);
+        }
+        return *this;
+    }
+
+    /** Move constructor; takes over the array of other, which is left empty. O(1) */
+    ArrayQueue(ArrayQueue<T> &&other) noexcept {
+        moveFrom(other);
+    }
+
+    /** Move assignment; frees current array and takes over that of other. O(n) */
+    ArrayQueue<T> &operator=(ArrayQueue<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    /** Equality operator. O(n) */
+    bool operator==(const ArrayQueue<T> &rhs) const {
+        if (_size != rhs._size)
+            return false;
+        bool same = true;
+        for (unsigned int i = 0; i < _size && same; ++i) {
+            if (_data[index(i)] != rhs._data[rhs.index(i)])
+                same = false;
+        }
+        return same;
+    }
+
+    /** Inequality operator. O(n) */
+    bool operator!=(const ArrayQueue<T> &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /** Outputs to stream using operator <<, from first to last. */
+    void write(std::ostream& sOut) {
+        for (unsigned int i = 0; i < _size; ++i) {
+            sOut << _data[index(i)];
+            if (i + 1 < _size) sOut << " ";
+        }
+    }
+
+protected:
+
+    /** If true, elements can be moved around as raw bytes */
+    static const bool RELOCATE_BY_COPY = std::is_trivially_copyable<T>::value;
+
+    /** array position of the i-th element from the front */
+    unsigned int index(unsigned int i) const {
+        return (_head + i) & (_capacity - 1);
+    }
+
+    /** smallest power of 2 that is >= n, and no smaller than INITIAL_CAPACITY */
+    static unsigned int roundUp(unsigned int n) {
+        unsigned int capacity = INITIAL_CAPACITY;
+        while (capacity < n) {
+            if (capacity == MAX_CAPACITY) {
+                throw InvalidAccessException("Capacity too large for an ArrayQueue");
+            }
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    /** uninitialized room for capacity elements */
+    static T *allocate(unsigned int capacity) {
+        T *data = static_cast<T *>(std::malloc(capacity * sizeof(T)));
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+        return data;
+    }
+
+    /**
+     * Moves all elements to the start of data, which has room for capacity
+     * elements; frees the old array. The caller must then set _head.
+     */
+    void relocate(T *data, unsigned int capacity) {
+        if constexpr (RELOCATE_BY_COPY) {
+            if (_size > 0) {
+                // at most 2 runs: from _head to the end of the array, and from its start
+                unsigned int first = (_head + _size <= _capacity) ? _size : _capacity - _head;
+                std::memcpy(static_cast<void *>(data), _data + _head, first * sizeof(T));
+                std::memcpy(static_cast<void *>(data + first), _data, (_size - first) * sizeof(T));
+            }
+        } else {
+            for (unsigned int i = 0; i < _size; ++i) {
+                T &old = _data[index(i)];
+                new (data + i) T(std::move(old));
+                old.~T();
+            }
+        }
+        std::free(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+
+    /**
+     * Grows a full array, building a new element at its front or back.
+     * The new element is built before old ones are moved out, since
+     * args may refer to them. Caller must increment _size.
+     */
+    template <typename... Args>
+    void growAndEmplace(bool atFront, Args&&... args) {
+        unsigned int capacity = roundUp(_capacity + 1);
+        unsigned int pos = atFront ? capacity - 1 : _size;
+        T *data = allocate(capacity);
+        try {
+            new (data + pos) T(std::forward<Args>(args)...);
+        } catch (...) {
+            std::free(data);
+            throw;
+        }
+        relocate(data, capacity);
+        _head = atFront ? pos : 0;
+    }
+
+    /** destroys all elements, and frees the array */
+    void free() {
+        if constexpr ( ! std::is_trivially_destructible<T>::value) {
+            for (unsigned int i = 0; i < _size; ++i) {
+                _data[index(i)].~T();
+            }
+        }
+        std::free(_data);
+        _data = nullptr;
+        _capacity = _head = _size = 0;
+    }
+
+    /** Takes over the array of other, which is left empty and without array */
+    void moveFrom(ArrayQueue &other) {
+        _data = other._data;
+        _capacity = other._capacity;
+        _head = other._head;
+        _size = other._size;
+        other._data = nullptr;
+        other._capacity = other._head = other._size = 0;
+    }
+
+    /** copies elements of other, unwrapped from the start of a new array */
+    void copy(const ArrayQueue &other) {
+        if (other.empty()) {
+            return;
+        }
+        _capacity = roundUp(other._size);
+        _data = allocate(_capacity);
+        _head = 0;
+        try {
+            for (; _size < other._size; ++_size) {
+                new (_data + _size) T(other._data[other.index(_size)]);
+            }
+        } catch (...) {
+            free();
+            throw;
+        }
+    }
+
+private:
+
+    /** Pointer to data; only the _size positions starting at _head (wrapping around) hold elements */
+    T *_data;
+
+    /** Capacity of array; always 0 or a power of 2 */
+    unsigned int _capacity;
+
+    /** Array position of the front element */
+    unsigned int _head;
+
+    /** Element count */
+    unsigned int _size;
+};
+
+/** Output operator, for use with streams */
+template<class T>
+std::ostream& operator<<(std::ostream& sOut, ArrayQueue<T>& q) {
+    q.write(sOut);
+    return sOut;
+}
+
+#endif // __ARRAY_QUEUE_H
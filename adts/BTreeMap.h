@@ -0,0 +1,897 @@
+/**
+ * Map ADT using a B+ tree
+ * Same interface as TreeMap, but with many keys per node
+ */
+
+#ifndef __BTREEMAP_H
+#define __BTREEMAP_H
+
+#include <iostream>
+#include "Exceptions.h"
+#include "NodePool.h"   // Allocates nodes
+#include <functional>   // less
+#include <utility>      // forward, move
+
+/**
+ * Map using a B+ tree: each node stores up to Order sorted keys in a contiguous
+ *    array, so that a lookup touches one node (a few cache lines) per level instead
+ *    of one node per key comparison. Values are kept only in leaves, and leaves
+ *    are linked in key order, so iterators just walk along them.
+ *    All nodes except the root are kept at least (Order-1)/2 full; all
+ *    operations are O(log n), and the tree is only log_{Order/2}(n) levels deep.
+ *
+ * Requires keys to support a comparison operator: a function object that accepts
+ *    two values of the key type, and which can answer whether 1st < 2nd.
+ *    The < operator is used if present for the key type T.
+ * Requires both keys and values to be default-constructible, since nodes hold
+ *    arrays of them; unused positions hold default-constructed keys and values.
+ * Operations are:
+ *    - BTreeMap constructor: generator
+ *    - insert(key, value): generator, adds a new (key, value) pair to the tree.
+ *          No effect if key already present, as in TreeMap
+ *          Keys and values passed as rvalues are moved instead of copied.
+ *    - try_emplace(key, args...): generator, adds key with a value built from args,
+ *          if the key was not already present. 
+ *    - erase(key): mutator. Removes the key from the tree. No effect if key absent.
+ *    - at(key): observer. Returns value that corresponds to a key.
+ *          Partial: key must exist; use contains() first if unsure.
+ *    - contains(key): observer. Returnes true iff key exists in map
+ *    - empty(): observer. Returns true if no keys present.
+ *    - size(): observer. Returns count of currently-contained keys.
+ */
+template <typename K, typename V, typename Comparator = std::less<K>, unsigned int Order = 32>
+class BTreeMap {
+    static_assert(Order >= 4, "BTreeMap nodes must hold at least 4 keys");
+
+private:
+    /** Min keys in any node but the root; a full node splits into 2 nodes with at least this many */
+    static const unsigned int MIN_KEYS = (Order - 1) / 2;
+
+    /** Common part of both kinds of nodes */
+    class Node {
+    public:
+        Node() : _count(0) {}
+
+        /** Keys in use, in positions [0, _count) */
+        unsigned int _count;
+    };
+
+    /** Leaf node: keys and their values; linked to the next leaf in key order */
+    class Leaf : public Node {
+    public:
+        Leaf() : _next(nullptr) {}
+
+        K _keys[Order];
+        V _values[Order];
+        Leaf *_next;
+    };
+
+    /**
+     * Inner node: _count keys separating _count + 1 children. Keys in the
+     * i-th child are >= _keys[i-1] and < _keys[i]
+     */
+    class Inner : public Node {
+    public:
+        K _keys[Order];
+        Node *_children[Order + 1];
+    };
+
+public:
+
+    /** Constructor; returns an empty BTreeMap. O(1) */
+    BTreeMap() : _root(nullptr), _levels(0), _size(0) {}
+
+    /** Destructor; frees nodes in O(n) */
+    ~BTreeMap() {
+        free();
+    }
+
+    /**
+     * Adds a new key, value pair to the map.
+     * No effect if key already present.
+     * generator, O(log n)
+     */
+    void insert(const K &key, const V &value) {
+        bool inserted;
+        insertAux(key, inserted, value);
+        // note that insertAux increases _size accordingly
+    }
+
+    /**
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(log n)
+     */
+    void insert(K &&key, V &&value) {
+        bool inserted;
+        insertAux(std::move(key), inserted, std::move(value));
+    }
+
+    /**
+     * If key is not present, adds it, with a value built from args.
+     * No effect (and args not used) if key already present.
+     * Since leaves hold arrays of already-built values, the value is
+     * built and then moved into place; never copied.
+     * Returns true IFF the key was added.
+     * generator, O(log n)
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        bool inserted;
+        insertAux(key, inserted, std::forward<Args>(args)...);
+        return inserted;
+    }
+
+    /** Same as try_emplace(key, args...), but moves key if added. */
+    template <typename... Args>
+    bool try_emplace(K &&key, Args&&... args) {
+        bool inserted;
+        insertAux(std::move(key), inserted, std::forward<Args>(args)...);
+        return inserted;
+    }
+
+    /**
+     * Removes a key, value pair from the map.
+     * No effect if key not there in the first place.
+     * mutator, O(log n)
+     */
+    void erase(const K &key) {
+        eraseAux(key);
+        // note that eraseAux decreases _size accordingly
+    }
+
+    /**
+     * Returns value associated to a key.
+     * Partial - if key not present, throws exception. Use contains() if unsure
+     * observer, O(log n)
+     */
+    const V &at(const K &key) const {
+        unsigned int pos;
+        Leaf *leaf = findAux(key, pos);
+        if (leaf == nullptr) {
+            throw BadKeyException();
+        }
+        return leaf->_values[pos];
+    }
+
+    /**
+     * Returns true IFF key in map
+     * observer, O(log n)
+     */
+    bool contains(const K &key) const {
+        unsigned int pos;
+        return findAux(key, pos) != nullptr;
+    }
+
+    /**
+     * Returns true IFF no keys in map
+     * observer, O(1)
+     */
+    bool empty() const {
+        return _root == nullptr;
+    }
+
+    /**
+     * Returns number of keys in map.
+     * observer, O(1)
+     */
+    int size() const {
+        return _size;
+    }
+
+    /**
+     * Overloads the [] operator, to access (and possibly modify) a value given its key.
+     * If the key is not present, inserts a new (default) value for that key.
+     */
+    V &operator[](const K &key) {
+        bool inserted;
+        return insertAux(key, inserted); // default value if new
+    }
+
+    /** Same as operator[](key), but moves key if it must be added. */
+    V &operator[](K &&key) {
+        bool inserted;
+        return insertAux(std::move(key), inserted); // default value if new
+    }
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    friend std::ostream& operator<<(std::ostream& o, const BTreeMap<K, V, Comparator, Order>& t){
+        o << "{";
+        for (ConstIterator it = t.cbegin(); it != t.cend(); ++it) {
+            if (it != t.cbegin()) {
+                o << ", ";
+            }
+            o << it.key() << " -> " << it.value();
+        }
+        o << "}";
+        return o;
+    }
+
+    // //
+    // NON-CONST ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Allows changing values (but not keys)
+     */
+    class Iterator {
+    public:
+        Iterator() : _leaf(nullptr), _pos(0) {}
+
+        /** O(1) */
+        void next() {
+            if (_leaf == nullptr)
+                throw InvalidAccessException();
+            if (++_pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_leaf == nullptr) throw InvalidAccessException();
+            return _leaf->_keys[_pos];
+        }
+
+        /** O(1) */
+        V &value() {
+            if (_leaf == nullptr) throw InvalidAccessException();
+            return _leaf->_values[_pos];
+        }
+
+        /** O(1) */
+        bool operator==(const Iterator &other) const {
+            return _leaf == other._leaf && _pos == other._pos;
+        }
+
+        /** O(1) */
+        bool operator!=(const Iterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        Iterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        Iterator operator++(int) {
+            Iterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class BTreeMap;
+
+        Iterator(Leaf *leaf, unsigned int pos) : _leaf(leaf), _pos(pos) {}
+
+        /** Leaf holding current key, or nullptr if past the end */
+        Leaf *_leaf;
+
+        /** Position of current key within its leaf */
+        unsigned int _pos;
+    };
+
+    /**
+     * Returns an iterator starting from the smallest key.
+     * O(log n)
+     */
+    Iterator begin() {
+        return Iterator(firstLeaf(), 0);
+    }
+
+    /**
+     * Returns an iterator just outside the map, reachable by an iterator
+     * that starts at begin()
+     * O(1)
+     */
+    Iterator end() const {
+        return Iterator();
+    }
+
+    /**
+     * Returns an iterator to the given key, or end() if not found
+     * O(log n)
+     */
+    Iterator find(const K &key) {
+        unsigned int pos;
+        Leaf *leaf = findAux(key, pos);
+        return (leaf == nullptr) ? end() : Iterator(leaf, pos);
+    }
+
+    // //
+    // CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Does not allow any changes
+     */
+    class ConstIterator {
+    public:
+        ConstIterator() : _leaf(nullptr), _pos(0) {}
+
+        /** Converts an Iterator to a ConstIterator  */
+        ConstIterator(const Iterator& it) : _leaf(it._leaf), _pos(it._pos) {}
+
+        /** O(1) */
+        void next() {
+            if (_leaf == nullptr)
+                throw InvalidAccessException();
+            if (++_pos == _leaf->_count) {
+                _leaf = _leaf->_next;
+                _pos = 0;
+            }
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_leaf == nullptr) throw InvalidAccessException();
+            return _leaf->_keys[_pos];
+        }
+
+        /** O(1) */
+        const V &value() const {
+            if (_leaf == nullptr) throw InvalidAccessException();
+            return _leaf->_values[_pos];
+        }
+
+        /** O(1) */
+        bool operator==(const ConstIterator &other) const {
+            return _leaf == other._leaf && _pos == other._pos;
+        }
+
+        /** O(1) */
+        bool operator!=(const ConstIterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        ConstIterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class BTreeMap;
+
+        ConstIterator(Leaf *leaf, unsigned int pos) : _leaf(leaf), _pos(pos) {}
+
+        /** Leaf holding current key, or nullptr if past the end */
+        Leaf *_leaf;
+
+        /** Position of current key within its leaf */
+        unsigned int _pos;
+    };
+
+    /**
+     * Returns a constant iterator starting from the smallest key
+     * O(log n)
+     */
+    ConstIterator cbegin() const {
+        return ConstIterator(firstLeaf(), 0);
+    }
+
+    /**
+     * Returns a constant iterator just outside the map, reachable by an iterator
+     * that starts at cbegin()
+     * O(1)
+     */
+    ConstIterator cend() const {
+        return ConstIterator();
+    }
+
+    /**
+     * Returns a constant iterator to the given key, or cend() if not found
+     * O(log n)
+     */
+    ConstIterator find(const K &key) const {
+        unsigned int pos;
+        Leaf *leaf = findAux(key, pos);
+        return (leaf == nullptr) ? cend() : ConstIterator(leaf, pos);
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /** Copy ctor. O(n) */
+    BTreeMap(const BTreeMap<K, V, Comparator, Order> &other) : _root(nullptr), _levels(0), _size(0) {
+        copy(other);
+    }
+
+    /** Copy assignment operator. O(n) */
+    BTreeMap<K, V, Comparator, Order> &operator=(const BTreeMap<K, V, Comparator, Order> &other) {
+        if (this != &other) {
+            free();
+            copy(other);
+        }
+        return *this;
+    }
+
+    /** Move ctor; takes over all nodes, leaving other empty. O(1) */
+    BTreeMap(BTreeMap<K, V, Comparator, Order> &&other) noexcept : _root(nullptr), _levels(0), _size(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment operator; frees current nodes, and takes over those of other. O(n) */
+    BTreeMap<K, V, Comparator, Order> &operator=(BTreeMap<K, V, Comparator, Order> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+protected:
+
+    /**
+     * Removes all nodes. Nodes only need to be visited if they have
+     * destructors to run; otherwise, both pools are released in one go.
+     */
+    void free() {
+        if (NodePool<Leaf>::NEEDS_DESTROY || NodePool<Inner>::NEEDS_DESTROY) {
+            free(_root, _levels);
+        }
+        _leaves.clear();
+        _inners.clear();
+        _root = nullptr;
+        _levels = 0;
+        _size = 0;
+    }
+
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(BTreeMap &other) {
+        _root = other._root;
+        _levels = other._levels;
+        _size = other._size;
+        _cless = other._cless;
+        _leaves.swap(other._leaves);
+        _inners.swap(other._inners);
+        other._root = nullptr;
+        other._levels = 0;
+        other._size = 0;
+    }
+
+    void copy(const BTreeMap &other) {
+        Leaf *last = nullptr;
+        _root = copyAux(other._root, other._levels, last);
+        _levels = other._levels;
+        _size = other._size;
+        _cless = other._cless;
+    }
+
+private:
+
+    /**
+     * Number of keys in the 1st n positions of an array that are < key: the position
+     * where key is, or would be inserted. Counts instead of branching on each
+     * comparison, which the CPU cannot predict; for small keys, the compiler
+     * can also vectorize the loop.
+     * O(Order)
+     */
+    unsigned int countLess(const K keys[], unsigned int n, const K &key) const {
+        unsigned int pos = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            pos += _cless(keys[i], key);
+        }
+        return pos;
+    }
+
+    /**
+     * Number of keys in the 1st n positions of an array that are <= key: the index
+     * of the child of an inner node that can contain key.
+     * O(Order)
+     */
+    unsigned int countNotGreater(const K keys[], unsigned int n, const K &key) const {
+        unsigned int pos = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            pos += ! _cless(key, keys[i]);
+        }
+        return pos;
+    }
+
+    /**
+     * Deletes the structure recursively. Only called if nodes have destructors.
+     * O(n)
+     */
+    void free(Node *n, int levels) {
+        if (n == nullptr) {
+            return;
+        }
+        if (levels == 1) {
+            _leaves.destroy(static_cast<Leaf*>(n));
+        } else {
+            Inner *inner = static_cast<Inner*>(n);
+            for (unsigned int i = 0; i <= inner->_count; i++) {
+                free(inner->_children[i], levels - 1);
+            }
+            _inners.destroy(inner);
+        }
+    }
+
+    /**
+     * Copies the structure recursively. Leaves are copied in key order,
+     * and each is linked from the one copied before it, kept in last.
+     * O(n)
+     */
+    Node *copyAux(Node *n, int levels, Leaf *&last) {
+        if (n == nullptr) {
+            return nullptr;
+        }
+        if (levels == 1) {
+            Leaf *leaf = static_cast<Leaf*>(n);
+            Leaf *copy = _leaves.create(*leaf);
+            copy->_next = nullptr;
+            if (last != nullptr) {
+                last->_next = copy;
+            }
+            last = copy;
+            return copy;
+        }
+        Inner *inner = static_cast<Inner*>(n);
+        Inner *copy = _inners.create();
+        copy->_count = inner->_count;
+        for (unsigned int i = 0; i < inner->_count; i++) {
+            copy->_keys[i] = inner->_keys[i];
+        }
+        for (unsigned int i = 0; i <= inner->_count; i++) {
+            copy->_children[i] = copyAux(inner->_children[i], levels - 1, last);
+        }
+        return copy;
+    }
+
+    /** Returns the leftmost leaf, or nullptr if empty. O(log n) */
+    Leaf *firstLeaf() const {
+        Node *n = _root;
+        for (int level = _levels; level > 1; level--) {
+            n = static_cast<Inner*>(n)->_children[0];
+        }
+        return static_cast<Leaf*>(n);
+    }
+
+    /**
+     * Finds a key. Returns the leaf that contains it, and its position there
+     * in pos; or nullptr if not found.
+     * O(log n)
+     */
+    Leaf *findAux(const K &key, unsigned int &pos) const {
+        if (_root == nullptr) {
+            return nullptr;
+        }
+        Node *n = _root;
+        for (int level = _levels; level > 1; level--) {
+            Inner *inner = static_cast<Inner*>(n);
+            n = inner->_children[countNotGreater(inner->_keys, inner->_count, key)];
+        }
+        Leaf *leaf = static_cast<Leaf*>(n);
+        pos = countLess(leaf->_keys, leaf->_count, key);
+        if (pos < leaf->_count && ! _cless(key, leaf->_keys[pos])) {
+            return leaf;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Splits the full i-th child of a non-full inner node into 2 nodes,
+     * adding a separator key for the new one to the parent.
+     * If copying the separator throws, nothing has been modified.
+     * O(Order)
+     */
+    void splitChild(Inner *parent, unsigned int i, bool childIsLeaf) {
+        Node *right;
+        K separator;
+        if (childIsLeaf) {
+            Leaf *l = static_cast<Leaf*>(parent->_children[i]);
+            unsigned int half = Order / 2;
+            separator = l->_keys[half]; // copied (leaves keep all keys), before anything moves
+            Leaf *r = _leaves.create();
+            for (unsigned int j = half; j < Order; j++) {
+                r->_keys[j - half] = std::move(l->_keys[j]);
+                r->_values[j - half] = std::move(l->_values[j]);
+            }
+            r->_count = Order - half;
+            l->_count = half;
+            r->_next = l->_next;
+            l->_next = r;
+            right = r;
+        } else {
+            Inner *l = static_cast<Inner*>(parent->_children[i]);
+            Inner *r = _inners.create();
+            unsigned int mid = Order / 2;
+            for (unsigned int j = mid + 1; j < Order; j++) {
+                r->_keys[j - mid - 1] = std::move(l->_keys[j]);
+            }
+            for (unsigned int j = mid + 1; j <= Order; j++) {
+                r->_children[j - mid - 1] = l->_children[j];
+            }
+            r->_count = Order - mid - 1;
+            l->_count = mid;
+            separator = std::move(l->_keys[mid]); // moved up: inner keys are not repeated
+            right = r;
+        }
+        for (unsigned int j = parent->_count; j > i; j--) {
+            parent->_keys[j] = std::move(parent->_keys[j - 1]);
+            parent->_children[j + 1] = parent->_children[j];
+        }
+        parent->_keys[i] = std::move(separator);
+        parent->_children[i + 1] = right;
+        parent->_count++;
+    }
+
+    /**
+     * Inserts a key into the structure, unless already there.
+     * Sets inserted to true if it was not there, building its value from args.
+     * Returns a reference to the value of the key.
+     * Full nodes are split on the way down, so that there is always room
+     * in the parent for the separator of a split child.
+     * O(log n)
+     */
+    template <typename KK, typename... Args>
+    V &insertAux(KK &&key, bool &inserted, Args&&... args) {
+        if (_root == nullptr) {
+            _root = _leaves.create();
+            _levels = 1;
+        }
+        if (_root->_count == Order) { // full root: tree grows 1 level
+            Inner *root = _inners.create();
+            root->_children[0] = _root;
+            try {
+                splitChild(root, 0, _levels == 1);
+            } catch (...) {
+                _inners.destroy(root);
+                throw;
+            }
+            _root = root; // only once the split has succeeded
+            _levels++;
+        }
+        Node *n = _root;
+        for (int level = _levels; level > 1; level--) {
+            Inner *inner = static_cast<Inner*>(n);
+            unsigned int i = countNotGreater(inner->_keys, inner->_count, key);
+            if (inner->_children[i]->_count == Order) {
+                splitChild(inner, i, level == 2);
+                if (! _cless(key, inner->_keys[i])) { // key >= separator
+                    i++;
+                }
+            }
+            n = inner->_children[i];
+        }
+
+        Leaf *leaf = static_cast<Leaf*>(n);
+        unsigned int pos = countLess(leaf->_keys, leaf->_count, key);
+        if (pos < leaf->_count && ! _cless(key, leaf->_keys[pos])) { // already there
+            inserted = false;
+            return leaf->_values[pos];
+        }
+        // built before anything moves, in case they throw
+        K newKey(std::forward<KK>(key));
+        V newValue(std::forward<Args>(args)...);
+        for (unsigned int j = leaf->_count; j > pos; j--) {
+            leaf->_keys[j] = std::move(leaf->_keys[j - 1]);
+            leaf->_values[j] = std::move(leaf->_values[j - 1]);
+        }
+        leaf->_keys[pos] = std::move(newKey);
+        leaf->_values[pos] = std::move(newValue);
+        leaf->_count++;
+        _size++;
+        inserted = true;
+        return leaf->_values[pos];
+    }
+
+    /**
+     * Removes (if found) a key from the structure.
+     * Nodes left with fewer than MIN_KEYS keys borrow one from a sibling,
+     * or are merged with it when the sibling has none to spare; this is
+     * repeated upwards along the path from the root.
+     * O(log n)
+     */
+    void eraseAux(const K &key) {
+        if (_root == nullptr) {
+            return;
+        }
+        Inner *path[MAX_LEVELS];
+        unsigned int childIdx[MAX_LEVELS];
+        int depth = 0;
+        Node *n = _root;
+        for (int level = _levels; level > 1; level--) {
+            Inner *inner = static_cast<Inner*>(n);
+            unsigned int i = countNotGreater(inner->_keys, inner->_count, key);
+            path[depth] = inner;
+            childIdx[depth++] = i;
+            n = inner->_children[i];
+        }
+
+        Leaf *leaf = static_cast<Leaf*>(n);
+        unsigned int pos = countLess(leaf->_keys, leaf->_count, key);
+        if (pos == leaf->_count || _cless(key, leaf->_keys[pos])) { // not found
+            return;
+        }
+        for (unsigned int j = pos + 1; j < leaf->_count; j++) {
+            leaf->_keys[j - 1] = std::move(leaf->_keys[j]);
+            leaf->_values[j - 1] = std::move(leaf->_values[j]);
+        }
+        leaf->_count--;
+        leaf->_keys[leaf->_count] = K();   // releases resources held by removed key
+        leaf->_values[leaf->_count] = V(); // and value
+        _size--;
+
+        // separators may still hold the removed key; they remain valid bounds
+        for (int d = depth - 1; d >= 0 && n->_count < MIN_KEYS; d--) {
+            fixUnderflow(path[d], childIdx[d], d == depth - 1);
+            n = path[d];
+        }
+
+        if (_levels == 1 && _root->_count == 0) { // last key removed
+            _leaves.destroy(static_cast<Leaf*>(_root));
+            _root = nullptr;
+            _levels = 0;
+        } else if (_levels > 1 && _root->_count == 0) { // root has a single child
+            Inner *root = static_cast<Inner*>(_root);
+            _root = root->_children[0];
+            _inners.destroy(root);
+            _levels--;
+        }
+    }
+
+    /**
+     * Refills the i-th child of an inner node, which has fewer than MIN_KEYS keys,
+     * by borrowing a key from a sibling; or merges it with a sibling if neither
+     * can spare one. A merge removes a key from the parent.
+     * O(Order)
+     */
+    void fixUnderflow(Inner *parent, unsigned int i, bool childIsLeaf) {
+        if (i > 0 && parent->_children[i - 1]->_count > MIN_KEYS) {
+            borrowFromLeft(parent, i, childIsLeaf);
+        } else if (i < parent->_count && parent->_children[i + 1]->_count > MIN_KEYS) {
+            borrowFromRight(parent, i, childIsLeaf);
+        } else if (i > 0) {
+            merge(parent, i - 1, childIsLeaf);
+        } else {
+            merge(parent, i, childIsLeaf);
+        }
+    }
+
+    /** Moves the last key of the (i-1)-th child to the start of the i-th. O(Order) */
+    void borrowFromLeft(Inner *parent, unsigned int i, bool childIsLeaf) {
+        if (childIsLeaf) {
+            Leaf *l = static_cast<Leaf*>(parent->_children[i - 1]);
+            Leaf *n = static_cast<Leaf*>(parent->_children[i]);
+            for (unsigned int j = n->_count; j > 0; j--) {
+                n->_keys[j] = std::move(n->_keys[j - 1]);
+                n->_values[j] = std::move(n->_values[j - 1]);
+            }
+            l->_count--;
+            n->_keys[0] = std::move(l->_keys[l->_count]);
+            n->_values[0] = std::move(l->_values[l->_count]);
+            n->_count++;
+            parent->_keys[i - 1] = n->_keys[0];
+        } else {
+            Inner *l = static_cast<Inner*>(parent->_children[i - 1]);
+            Inner *n = static_cast<Inner*>(parent->_children[i]);
+            n->_children[n->_count + 1] = n->_children[n->_count];
+            for (unsigned int j = n->_count; j > 0; j--) {
+                n->_keys[j] = std::move(n->_keys[j - 1]);
+                n->_children[j] = n->_children[j - 1];
+            }
+            n->_keys[0] = std::move(parent->_keys[i - 1]);
+            n->_children[0] = l->_children[l->_count];
+            n->_count++;
+            l->_count--;
+            parent->_keys[i - 1] = std::move(l->_keys[l->_count]);
+        }
+    }
+
+    /** Moves the first key of the (i+1)-th child to the end of the i-th. O(Order) */
+    void borrowFromRight(Inner *parent, unsigned int i, bool childIsLeaf) {
+        if (childIsLeaf) {
+            Leaf *n = static_cast<Leaf*>(parent->_children[i]);
+            Leaf *r = static_cast<Leaf*>(parent->_children[i + 1]);
+            n->_keys[n->_count] = std::move(r->_keys[0]);
+            n->_values[n->_count] = std::move(r->_values[0]);
+            n->_count++;
+            for (unsigned int j = 1; j < r->_count; j++) {
+                r->_keys[j - 1] = std::move(r->_keys[j]);
+                r->_values[j - 1] = std::move(r->_values[j]);
+            }
+            r->_count--;
+            parent->_keys[i] = r->_keys[0];
+        } else {
+            Inner *n = static_cast<Inner*>(parent->_children[i]);
+            Inner *r = static_cast<Inner*>(parent->_children[i + 1]);
+            n->_keys[n->_count] = std::move(parent->_keys[i]);
+            n->_children[n->_count + 1] = r->_children[0];
+            n->_count++;
+            parent->_keys[i] = std::move(r->_keys[0]);
+            for (unsigned int j = 1; j < r->_count; j++) {
+                r->_keys[j - 1] = std::move(r->_keys[j]);
+            }
+            for (unsigned int j = 1; j <= r->_count; j++) {
+                r->_children[j - 1] = r->_children[j];
+            }
+            r->_count--;
+        }
+    }
+
+    /**
+     * Merges the (i+1)-th child into the i-th, and removes it, along with
+     * the key that separated them, from the parent. O(Order)
+     */
+    void merge(Inner *parent, unsigned int i, bool childIsLeaf) {
+        if (childIsLeaf) {
+            Leaf *l = static_cast<Leaf*>(parent->_children[i]);
+            Leaf *r = static_cast<Leaf*>(parent->_children[i + 1]);
+            for (unsigned int j = 0; j < r->_count; j++) {
+                l->_keys[l->_count + j] = std::move(r->_keys[j]);
+                l->_values[l->_count + j] = std::move(r->_values[j]);
+            }
+            l->_count += r->_count;
+            l->_next = r->_next;
+            _leaves.destroy(r);
+        } else {
+            Inner *l = static_cast<Inner*>(parent->_children[i]);
+            Inner *r = static_cast<Inner*>(parent->_children[i + 1]);
+            l->_keys[l->_count] = std::move(parent->_keys[i]);
+            for (unsigned int j = 0; j < r->_count; j++) {
+                l->_keys[l->_count + 1 + j] = std::move(r->_keys[j]);
+            }
+            for (unsigned int j = 0; j <= r->_count; j++) {
+                l->_children[l->_count + 1 + j] = r->_children[j];
+            }
+            l->_count += 1 + r->_count;
+            _inners.destroy(r);
+        }
+        for (unsigned int j = i + 1; j < parent->_count; j++) {
+            parent->_keys[j - 1] = std::move(parent->_keys[j]);
+            parent->_children[j] = parent->_children[j + 1];
+        }
+        parent->_count--;
+    }
+
+    /**
+     * Max levels in the tree. With at least MIN_KEYS + 1 children per inner node,
+     * this is never reached with 32-bit sizes. Bounds the path kept by eraseAux().
+     */
+    static const int MAX_LEVELS = 32;
+
+    /**
+     * Root node; a Leaf if _levels is 1, an Inner otherwise
+     */
+    Node *_root;
+
+    /**
+     * Levels in the tree, counting the leaves; 0 if empty
+     */
+    int _levels;
+
+    /**
+     * Comparator
+     */
+    Comparator _cless;
+
+    /**
+     * Number of keys in the map
+     */
+    int _size;
+
+    /**
+     * Allocators for all leaves and inner nodes of this map
+     */
+    NodePool<Leaf> _leaves;
+    NodePool<Inner> _inners;
+};
+
+#endif // __BTREEMAP_H
@@ -9,9 +9,16 @@
 
 #include "Exceptions.h"
 #include "List.h"    // Returned by traversals
-#include "Queue.h"   // Used for traversal-by-levels
+#include "ArrayQueue.h"   // Used for traversal-by-levels
+#include "BinTreeIterator.h"  // Lazy traversals
+#include "ForkJoin.h"     // Used by parallel operations
 #include <iomanip>   // for setw (precise control of alignment when printing)
 #include <iostream>  // endl 
+#include <memory>    // unique_ptr
+#include <new>       // placement new
+#include <optional>  // results of parallel operations
+#include <type_traits>  // decay
+#include <utility>   // move, forward
 
 /**
  * Dynamic implementation of a binary tree with pointers
@@ -26,10 +33,32 @@
  * - left, right: observers, return left or right children of a tree (also trees!)
  * - elem: observer, returns element at root
  * - empty: observer, returning true IFF a tree is empty
+ * - begin(order), end(), traversal(order): observers, iterate through elements in
+ *      any TraversalOrder (see BinTreeIterator.h), visiting them lazily by reference;
+ *      preOrder(visit), inOrder(visit), postOrder(visit) and levels(visit) call
+ *      visit(elem) on each one. Unlike the list-returning traversals, these do not 
+ *      copy elements or allocate memory per element.
+ * - fold(emptyValue, f): observer, combines results bottom-up, using 
+ *      emptyValue for empty trees and f(leftResult, elem, rightResult) otherwise
+ * - map(f): observer, returns a tree of the same shape with f(elem) as elements
+ *
+ * Traversals, nodeCount, depth, leafCount, fold and map also have a parallel version,
+ * which takes a ParallelOptions (see ForkJoin.h) as its last argument. Since
+ * nodes are never modified once built, threads can safely walk the same tree
+ * (and shared subtrees) at once. Left subtrees are forked as tasks of a 
+ * ForkJoinPool, and idle threads steal them; subtrees with fewer than 
+ * options.cutoff nodes, or deeper than the pool's fork_depth(), are processed 
+ * sequentially, as are whole trees that are below the cutoff.
  */
 
 template <typename T>
 class BinTree {
+protected:
+    class Node; // Forward declaration, for iterators
+
+    // builds trees out of shared nodes; see BinTreeFactory.h
+    template <typename U, typename H> friend class BinTreeFactory;
+
 public:
 
     /** Constructor; returns an empty tree */
@@ -42,12 +71,24 @@ public:
         _root->addRef();
     }
 
+    /** Same as BinTree(iz, elem, dr), but moves elem instead of copying it */
+    BinTree(const BinTree &iz, T &&elem, const BinTree &dr) :
+            _root(new Node(iz._root, std::move(elem), dr._root)) {
+        _root->addRef();
+    }
+
     /** Constructor; returns a tree where the root is a leaf node containing elem  */
     BinTree(const T &elem) :
             _root(new Node(nullptr, elem, nullptr)) {
         _root->addRef();
     }
 
+    /** Same as BinTree(elem), but moves elem instead of copying it */
+    BinTree(T &&elem) :
+            _root(new Node(nullptr, std::move(elem), nullptr)) {
+        _root->addRef();
+    }
+
     /** Destructor; frees nodes (unless used elsewhere) & clears root. */
     ~BinTree() {
         free();
@@ -122,7 +163,7 @@ public:
     List<T>* levels() const {
         List<T>* ret = new List<T>();
         if (!empty()){
-            Queue<Node*> pending;
+            ArrayQueue<Node*> pending;
             pending.push_back(_root);
 
             while (!pending.empty()) {
@@ -138,6 +179,55 @@ public:
         return ret;
     }
 
+    // //
+    // LAZY TRAVERSALS; return references to elements, without copies
+    // //
+
+    /** Iterator over elements, in any TraversalOrder */
+    using ConstIterator = BinTreeIterator<T, Node>;
+
+    /** Returns an iterator at the 1st element in the given order. O(depth) */
+    ConstIterator begin(TraversalOrder order = TraversalOrder::IN_ORDER) const {
+        return ConstIterator(_root, order);
+    }
+
+    /** Returns an iterator past the last element, for any order. O(1) */
+    ConstIterator end() const {
+        return ConstIterator();
+    }
+
+    /** 
+     * Returns a traversal in the given order, for range-based for loops:
+     *     for (const T &e : tree.traversal(TraversalOrder::PRE_ORDER)) ...
+     */
+    BinTreeTraversal<T, Node> traversal(TraversalOrder order) const {
+        return BinTreeTraversal<T, Node>(_root, order);
+    }
+
+    /** Calls visit(e) for each element e, in pre-order. O(n) */
+    template <typename F>
+    void preOrder(F visit) const {
+        visitAll(TraversalOrder::PRE_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, in in-order. O(n) */
+    template <typename F>
+    void inOrder(F visit) const {
+        visitAll(TraversalOrder::IN_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, in post-order. O(n) */
+    template <typename F>
+    void postOrder(F visit) const {
+        visitAll(TraversalOrder::POST_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, by levels. O(n) */
+    template <typename F>
+    void levels(F visit) const {
+        visitAll(TraversalOrder::LEVEL_ORDER, visit);
+    }
+
     // //
     // OTHER OBSERVERS
     // //
@@ -157,6 +247,77 @@ public:
         return leafCountAux(_root);
     }
 
+    /**
+     * Returns emptyValue if the tree is empty, and f(l, elem(), r) otherwise,
+     * where l and r are the results of folding the left and right subtrees.
+     * O(n) calls to f
+     */
+    template <typename R, typename F>
+    R fold(const R &emptyValue, F f) const {
+        return foldAux(_root, emptyValue, f);
+    }
+
+    /** Returns a tree with the same shape, and f(e) for each element e. O(n) calls to f */
+    template <typename F, typename U = typename std::decay<decltype(std::declval<F&>()(std::declval<const T&>()))>::type>
+    BinTree<U> map(F f) const {
+        return fold(BinTree<U>(), [&f](const BinTree<U> &left, const T &elem, const BinTree<U> &right) {
+            return BinTree<U>(left, f(elem), right);
+        });
+    }
+
+    // //
+    // PARALLEL VERSIONS; see ParallelOptions
+    // //
+
+    List<T>* preOrder(const ParallelOptions &options) const {
+        return parallelTraversal(TraversalOrder::PRE_ORDER, options);
+    }
+
+    List<T>* inOrder(const ParallelOptions &options) const {
+        return parallelTraversal(TraversalOrder::IN_ORDER, options);
+    }
+
+    List<T>* postOrder(const ParallelOptions &options) const {
+        return parallelTraversal(TraversalOrder::POST_ORDER, options);
+    }
+
+    unsigned int nodeCount(const ParallelOptions &options) const {
+        return fold(0u, [](unsigned int left, const T &, unsigned int right) {
+            return 1 + left + right;
+        }, options);
+    }
+
+    unsigned int depth(const ParallelOptions &options) const {
+        return fold(0u, [](unsigned int left, const T &, unsigned int right) {
+            return 1 + ((left > right) ? left : right);
+        }, options);
+    }
+
+    unsigned int leafCount(const ParallelOptions &options) const {
+        // non-empty trees always have at least 1 leaf
+        return fold(0u, [](unsigned int left, const T &, unsigned int right) {
+            return (left + right == 0) ? 1 : left + right;
+        }, options);
+    }
+
+    /** Same as fold(emptyValue, f), but f may be called from several threads at once. */
+    template <typename R, typename F>
+    R fold(const R &emptyValue, F f, const ParallelOptions &options) const {
+        std::optional<R> result;
+        runParallel(options, [&](const ParallelContext &context) {
+            result.emplace(parallelFoldAux(_root, 0, emptyValue, f, context));
+        });
+        return std::move(*result);
+    }
+
+    /** Same as map(f), but f may be called from several threads at once. */
+    template <typename F, typename U = typename std::decay<decltype(std::declval<F&>()(std::declval<const T&>()))>::type>
+    BinTree<U> map(F f, const ParallelOptions &options) const {
+        return fold(BinTree<U>(), [&f](const BinTree<U> &left, const T &elem, const BinTree<U> &right) {
+            return BinTree<U>(left, f(elem), right);
+        }, options);
+    }
+
     // //
     // BOILERPLATE C++ CODE 
     // //
@@ -175,6 +336,21 @@ public:
         return *this;
     }
 
+    /** Move ctor; takes over the root (and its reference), leaving other empty. O(1) */
+    BinTree(BinTree<T> &&other) noexcept : _root(other._root) {
+        other._root = nullptr;
+    }
+
+    /** Move assignment operator. O(1), plus freeing nodes no longer used */
+    BinTree<T> &operator=(BinTree<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            _root = other._root;
+            other._root = nullptr;
+        }
+        return *this;
+    }
+
     /** Comparison operators. */
     bool operator==(const BinTree<T> &rhs) const {
         return compareAux(_root, rhs._root);
@@ -211,7 +387,7 @@ public:
         else {
             BinTree<T> hi = fromPreOrderInput(emptyRep);
             BinTree<T> hd = fromPreOrderInput(emptyRep);
-            return BinTree<T>(hi, elem, hd);
+            return BinTree<T>(hi, std::move(elem), hd);
         }
     }
 
@@ -236,7 +412,7 @@ public:
             BinTree<T> right = fromInOrderInput();
             std::cin >> c;
             assert (c == ')');
-            BinTree<T> result(left, elem, right);
+            BinTree<T> result(left, std::move(elem), right);
             return result;
         }
     }
@@ -253,8 +429,9 @@ protected:
     class Node {
     public:
         Node() : _left(nullptr), _right(nullptr), _refs(0) {}
-        Node(Node *left, const T &elem, Node *right) :
-                _elem(elem), _left(left), _right(right), _refs(0) {
+        template <typename TT>
+        Node(Node *left, TT &&elem, Node *right) :
+                _elem(std::forward<TT>(elem)), _left(left), _right(right), _refs(0) {
             if (left != nullptr)
                 left->addRef();
             if (right != nullptr)
@@ -331,6 +508,13 @@ protected:
         }
     }
 
+    template <typename F>
+    void visitAll(TraversalOrder order, F &visit) const {
+        for (ConstIterator it = begin(order); it != end(); ++it) {
+            visit(*it);
+        }
+    }
+
     // //
     // OTHER AUX METHODS
     // //
@@ -367,6 +551,210 @@ protected:
         return leafCountAux(root->_left) + leafCountAux(root->_right);
     }
 
+    template <typename R, typename F>
+    static R foldAux(Node *root, const R &emptyValue, F &f) {
+        if (root == nullptr) {
+            return emptyValue;
+        }
+        return f(foldAux(root->_left, emptyValue, f), root->_elem, 
+                 foldAux(root->_right, emptyValue, f));
+    }
+
+    // //
+    // AUX METHODS FOR PARALLEL OPERATIONS
+    // //
+
+    /** Decides where to fork during a parallel operation */
+    struct ParallelContext {
+        /** Pool to fork tasks in; nullptr if running sequentially */
+        ForkJoinPool *pool;
+        unsigned int cutoff;
+        unsigned int forkDepth;
+
+        /** True IFF work on root should be split between its children */
+        bool forks(Node *root, unsigned int depth) const {
+            return pool != nullptr && root != nullptr && depth < forkDepth && hasAtLeast(root, cutoff);
+        }
+    };
+
+    /**
+     * Node counts of subtrees where a parallel count forked, so that a
+     * parallel fill can later place each subtree's elements without counting again.
+     * Children are nullptr where the count did not fork.
+     */
+    struct ForkCounts {
+        unsigned int count;
+        unsigned int leftCount;
+        std::unique_ptr<ForkCounts> left;
+        std::unique_ptr<ForkCounts> right;
+    };
+
+    /** True IFF the tree at root has at least n nodes; visits at most n of them */
+    static bool hasAtLeast(Node *root, unsigned int n) {
+        unsigned int missing = n;
+        countDown(root, missing);
+        return missing == 0;
+    }
+
+    /** Decrements missing once per node, stopping when it reaches 0 */
+    static void countDown(Node *root, unsigned int &missing) {
+        if (root != nullptr && missing > 0) {
+            missing--;
+            countDown(root->_left, missing);
+            countDown(root->_right, missing);
+        }
+    }
+
+    /**
+     * Calls op with a context to fork in, using a new pool; or, if only
+     * 1 thread is requested or the tree is below the cutoff, with a context 
+     * that never forks.
+     */
+    template <typename Op>
+    void runParallel(const ParallelOptions &options, Op op) const {
+        if (ForkJoinPool::threadCount(options.threads) < 2 || ! hasAtLeast(_root, options.cutoff)) {
+            op(ParallelContext{nullptr, 0, 0});
+        } else {
+            ForkJoinPool pool(options.threads);
+            ParallelContext context{&pool, options.cutoff, pool.fork_depth()};
+            pool.run([&]() { op(context); });
+        }
+    }
+
+    template <typename R, typename F>
+    static R parallelFoldAux(Node *root, unsigned int depth, const R &emptyValue, F &f, 
+            const ParallelContext &context) {
+        if ( ! context.forks(root, depth)) {
+            return foldAux(root, emptyValue, f);
+        }
+        std::optional<R> left, right;
+        context.pool->invoke(
+            [&]() { left.emplace(parallelFoldAux(root->_left, depth + 1, emptyValue, f, context)); },
+            [&]() { right.emplace(parallelFoldAux(root->_right, depth + 1, emptyValue, f, context)); });
+        return f(*left, root->_elem, *right);
+    }
+
+    /** Counts nodes below root in parallel, recording counts wherever it forks */
+    static unsigned int parallelCountAux(Node *root, unsigned int depth, 
+            const ParallelContext &context, std::unique_ptr<ForkCounts> &counts) {
+        if ( ! context.forks(root, depth)) {
+            return nodeCountAux(root);
+        }
+        counts.reset(new ForkCounts());
+        unsigned int leftCount = 0, rightCount = 0;
+        context.pool->invoke(
+            [&]() { leftCount = parallelCountAux(root->_left, depth + 1, context, counts->left); },
+            [&]() { rightCount = parallelCountAux(root->_right, depth + 1, context, counts->right); });
+        counts->leftCount = leftCount;
+        counts->count = 1 + leftCount + rightCount;
+        return counts->count;
+    }
+
+    /** Builds copies of elements below root at pos, in the given order, advancing pos */
+    static void fillAux(Node *root, TraversalOrder order, T *&pos) {
+        if (root != nullptr) {
+            if (order == TraversalOrder::PRE_ORDER) {
+                new (pos) T(root->_elem);
+                ++pos;
+            }
+            fillAux(root->_left, order, pos);
+            if (order == TraversalOrder::IN_ORDER) {
+                new (pos) T(root->_elem);
+                ++pos;
+            }
+            fillAux(root->_right, order, pos);
+            if (order == TraversalOrder::POST_ORDER) {
+                new (pos) T(root->_elem);
+                ++pos;
+            }
+        }
+    }
+
+    /** Destroys elements in [first, last) */
+    static void destroyRange(T *first, T *last) {
+        for (; first != last; ++first) {
+            first->~T();
+        }
+    }
+
+    /** 
+     * Builds copies of elements below root starting at out, forking wherever
+     * parallelCountAux did. If a copy throws, nothing is left built.
+     */
+    static void parallelFillAux(Node *root, const ForkCounts *counts, TraversalOrder order, T *out,
+            const ParallelContext &context) {
+        if (counts == nullptr) {
+            T *pos = out;
+            try {
+                fillAux(root, order, pos);
+            } catch (...) {
+                destroyRange(out, pos);
+                throw;
+            }
+            return;
+        }
+        unsigned int leftCount = counts->leftCount;
+        unsigned int rightCount = counts->count - 1 - leftCount;
+        T *leftOut = (order == TraversalOrder::PRE_ORDER) ? out + 1 : out;
+        T *rightOut = (order == TraversalOrder::POST_ORDER) ? out + leftCount : out + leftCount + 1;
+        T *rootOut = (order == TraversalOrder::PRE_ORDER) ? out :
+                     (order == TraversalOrder::IN_ORDER) ? out + leftCount : out + leftCount + rightCount;
+        bool leftBuilt = false, rightBuilt = false;
+        try {
+            context.pool->invoke(
+                [&]() {
+                    parallelFillAux(root->_left, counts->left.get(), order, leftOut, context);
+                    leftBuilt = true;
+                },
+                [&]() {
+                    parallelFillAux(root->_right, counts->right.get(), order, rightOut, context);
+                    rightBuilt = true;
+                });
+            new (rootOut) T(root->_elem);
+        } catch (...) {
+            if (leftBuilt) {
+                destroyRange(leftOut, leftOut + leftCount);
+            }
+            if (rightBuilt) {
+                destroyRange(rightOut, rightOut + rightCount);
+            }
+            throw;
+        }
+    }
+
+    /**
+     * Traverses in parallel in 2 passes: the 1st counts nodes, and the 2nd
+     * copies elements into their final positions in an array, from
+     * which the list is then built.
+     */
+    List<T>* parallelTraversal(TraversalOrder order, const ParallelOptions &options) const {
+        std::unique_ptr<List<T>> ret(new List<T>());
+        runParallel(options, [&](const ParallelContext &context) {
+            std::unique_ptr<ForkCounts> counts;
+            unsigned int n = parallelCountAux(_root, 0, context, counts);
+            T *elems = static_cast<T *>(::operator new(n * sizeof(T)));
+            try {
+                parallelFillAux(_root, counts.get(), order, elems, context);
+            } catch (...) {
+                ::operator delete(elems); // nothing left built
+                throw;
+            }
+            unsigned int moved = 0;
+            try {
+                for (; moved < n; ++moved) {
+                    ret->push_back(std::move(elems[moved]));
+                    elems[moved].~T();
+                }
+            } catch (...) {
+                destroyRange(elems + moved, elems + n);
+                ::operator delete(elems);
+                throw;
+            }
+            ::operator delete(elems);
+        });
+        return ret.release();
+    }
+
 private:
 
     /**
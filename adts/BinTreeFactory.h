@@ -0,0 +1,268 @@
+/**
+ * Hash-consing factory for BinTrees: structurally equal trees share their nodes
+ * Each distinct (left, elem, right) combination is built only once; asking for
+ * it again returns the very same node.
+ */
+#ifndef __BINTREE_FACTORY_H
+#define __BINTREE_FACTORY_H
+
+#include "BinTree.h"
+#include "HashMap.h"   // Table of unique nodes
+#include "Hash.h"      // Used to combine child addresses into hashes
+#include "Stack.h"     // Pending nodes in collect()
+#include <cstdint>     // uint64_t, uintptr_t
+#include <utility>     // move, forward
+
+/**
+ * Builds BinTrees with maximal sharing ("hash-consing"). The factory keeps a
+ * table of the nodes it has built, keyed on (left child, elem, right child);
+ * since children are themselves unique, two trees built by the same factory
+ * are equal IFF they have the same root node. Trees built by a factory are
+ * ordinary BinTrees, and can be used (and mixed with others) as usual.
+ * Operations are:
+ *    - make(left, elem, right), make(elem): generators. Return the unique tree
+ *          with that root element and children; a node is only built (and elem
+ *          copied) the 1st time. O(1), plus interning any foreign children
+ *    - intern(tree): generator. Returns the unique tree equal to tree. O(1) if
+ *          built by this factory, O(n) otherwise
+ *    - owns(tree): observer. True IFF tree was built (or interned) by this factory. O(1)
+ *    - same(a, b): observer. Structural equality, in O(1), for trees owned by this factory
+ *    - nodeCount(tree), depth(tree): observers. O(1) for owned trees, which have
+ *          both memoized; O(n) otherwise
+ *    - size(): observer. Number of unique nodes in the table
+ *    - collect(): mutator. Frees nodes no longer used by any tree outside the
+ *          factory; returns how many were freed. O(size())
+ *    - clear(): mutator. Forgets all nodes; trees remain valid, but are no
+ *          longer shared with new ones. O(size())
+ *
+ * The factory holds a reference to each node in its table, so nodes outlive
+ * the trees that use them until collect() or clear() is called. Elements must
+ * support == and Hash (by default, the Hash of Hash.h, which calls myhash());
+ * children are hashed by address. Like BinTree, factories
+ * are not thread-safe.
+ */
+template <typename T, typename Hash = ::Hash<T>>
+class BinTreeFactory {
+    using Node = typename BinTree<T>::Node;
+
+public:
+
+    /** Constructor; returns a factory with no nodes. O(1) */
+    BinTreeFactory() {}
+
+    /** Destructor; releases all nodes, which are freed unless in use */
+    ~BinTreeFactory() {
+        clear();
+    }
+
+    /** Returns the unique tree from left + elem + right. O(1) if children are owned */
+    BinTree<T> make(const BinTree<T> &left, const T &elem, const BinTree<T> &right) {
+        BinTree<T> l = intern(left);
+        BinTree<T> r = intern(right);
+        return BinTree<T>(unique(l._root, elem, r._root));
+    }
+
+    /** Same as make(left, elem, right), but moves elem if a node is built */
+    BinTree<T> make(const BinTree<T> &left, T &&elem, const BinTree<T> &right) {
+        BinTree<T> l = intern(left);
+        BinTree<T> r = intern(right);
+        return BinTree<T>(unique(l._root, std::move(elem), r._root));
+    }
+
+    /** Returns the unique leaf with elem. O(1) */
+    BinTree<T> make(const T &elem) {
+        return BinTree<T>(unique(nullptr, elem, nullptr));
+    }
+
+    /** Same as make(elem), but moves elem if a node is built */
+    BinTree<T> make(T &&elem) {
+        return BinTree<T>(unique(nullptr, std::move(elem), nullptr));
+    }
+
+    /** Returns the unique tree equal to tree, interning its nodes. O(1) if owned, O(n) otherwise */
+    BinTree<T> intern(const BinTree<T> &tree) {
+        return BinTree<T>(internAux(tree._root));
+    }
+
+    /** True IFF tree is empty, or was built by this factory. O(1) */
+    bool owns(const BinTree<T> &tree) const {
+        return tree._root == nullptr || entryOf(tree._root) != nullptr;
+    }
+
+    /** True IFF a and b are equal; O(1) if both are owned, O(n) otherwise */
+    bool same(const BinTree<T> &a, const BinTree<T> &b) const {
+        if (owns(a) && owns(b)) {
+            return a._root == b._root;
+        }
+        return a == b;
+    }
+
+    /**
+     * Number of nodes in tree, counting shared nodes once per parent (so, up to
+     * 2^depth - 1, well beyond the number of unique nodes); O(1) if owned
+     */
+    std::uint64_t nodeCount(const BinTree<T> &tree) const {
+        if (tree._root == nullptr) {
+            return 0;
+        }
+        const Entry *entry = entryOf(tree._root);
+        return (entry != nullptr) ? entry->_nodeCount : tree.nodeCount();
+    }
+
+    /** Depth of tree; O(1) if owned */
+    unsigned int depth(const BinTree<T> &tree) const {
+        if (tree._root == nullptr) {
+            return 0;
+        }
+        const Entry *entry = entryOf(tree._root);
+        return (entry != nullptr) ? entry->_depth : tree.depth();
+    }
+
+    /** Number of unique nodes the factory knows about. O(1) */
+    int size() const {
+        return _nodes.size();
+    }
+
+    /**
+     * Frees all nodes that are only referenced by the factory (and by other
+     * such nodes). Returns the number of nodes freed. O(size())
+     */
+    unsigned int collect() {
+        Stack<Node *> unused;
+        for (auto it = _nodes.cbegin(); it != _nodes.cend(); ++it) {
+            if (it.value()._node->_refs == 1) {
+                unused.push(it.value()._node);
+            }
+        }
+        // owned nodes only have owned children, which hold no other references once freed
+        unsigned int freed = 0;
+        while ( ! unused.empty()) {
+            Node *node = unused.top();
+            unused.pop();
+            Node *left = node->_left;
+            Node *right = node->_right;
+            _nodes.erase(keyOf(node));
+            BinTree<T>::free(node);
+            freed++;
+            if (left != nullptr && left->_refs == 1) {
+                unused.push(left);
+            }
+            if (right != nullptr && right != left && right->_refs == 1) {
+                unused.push(right);
+            }
+        }
+        return freed;
+    }
+
+    /** Forgets all nodes, releasing the factory's references. O(size()) */
+    void clear() {
+        Stack<Node *> nodes;
+        for (auto it = _nodes.cbegin(); it != _nodes.cend(); ++it) {
+            nodes.push(it.value()._node);
+        }
+        _nodes = HashMap<Key, Entry, KeyHash>();
+        while ( ! nodes.empty()) {
+            BinTree<T>::free(nodes.top());
+            nodes.pop();
+        }
+    }
+
+    // factories hold references to their nodes; sharing them would double-release
+    BinTreeFactory(const BinTreeFactory &other) = delete;
+    BinTreeFactory &operator=(const BinTreeFactory &other) = delete;
+
+private:
+
+    /**
+     * Identity of a node: its children, by address, and its element. Keys in
+     * the table point to their node's element; lookups point to the candidate
+     * one, which is only copied if no such node exists yet.
+     */
+    struct Key {
+        Node *_left;
+        const T *_elem;
+        Node *_right;
+
+        bool operator==(const Key &other) const {
+            return _left == other._left && _right == other._right
+                && *_elem == *other._elem;
+        }
+    };
+
+    /** Hashes the element, and mixes in the addresses of both children */
+    struct KeyHash {
+        std::uint64_t operator()(const Key &key) const {
+            std::uint64_t h = hash_combine(_hash(*key._elem), (std::uintptr_t)key._left);
+            return hash_combine(h, (std::uintptr_t)key._right);
+        }
+
+        Hash _hash;
+    };
+
+    /** A unique node, with the memoized size & depth of the tree it is the root of */
+    struct Entry {
+        Node *_node;
+        std::uint64_t _nodeCount;
+        unsigned int _depth;
+    };
+
+    static Key keyOf(Node *node) {
+        return Key{node->_left, &node->_elem, node->_right};
+    }
+
+    /** Entry of node, if owned; nullptr otherwise (including lookalike nodes). O(1) */
+    const Entry *entryOf(Node *node) const {
+        auto it = _nodes.find(keyOf(node));
+        if (it == _nodes.cend() || it.value()._node != node) {
+            return nullptr;
+        }
+        return &it.value();
+    }
+
+    /** Returns the unique node for owned children and elem, building it if needed. O(1) */
+    template <typename TT>
+    Node *unique(Node *left, TT &&elem, Node *right) {
+        Key key{left, &elem, right};
+        auto it = _nodes.find(key);
+        if (it != _nodes.end()) {
+            return it.value()._node;
+        }
+        Entry entry{nullptr, 1, 1};
+        if (left != nullptr) {
+            const Entry &l = *entryOf(left);
+            entry._nodeCount += l._nodeCount;
+            entry._depth = 1 + l._depth;
+        }
+        if (right != nullptr) {
+            const Entry &r = *entryOf(right);
+            entry._nodeCount += r._nodeCount;
+            if (1 + r._depth > entry._depth) {
+                entry._depth = 1 + r._depth;
+            }
+        }
+        entry._node = new Node(left, std::forward<TT>(elem), right);
+        entry._node->addRef(); // the factory's own reference
+        try {
+            _nodes.insert(keyOf(entry._node), entry);
+        } catch (...) {
+            BinTree<T>::free(entry._node);
+            throw;
+        }
+        return entry._node;
+    }
+
+    /** Returns the unique node equal to node, interning its descendants first. O(1) if owned */
+    Node *internAux(Node *node) {
+        if (node == nullptr || entryOf(node) != nullptr) {
+            return node;
+        }
+        Node *left = internAux(node->_left);
+        Node *right = internAux(node->_right);
+        return unique(left, node->_elem, right);
+    }
+
+    /** Unique nodes, each with a reference held by the factory */
+    HashMap<Key, Entry, KeyHash> _nodes;
+};
+
+#endif // __BINTREE_FACTORY_H
@@ -0,0 +1,220 @@
+/**
+ * Lazy traversal iterators shared by BinTree and BinTreeSmart
+ * Elements are returned by reference, as the iterator reaches them; no
+ * copies are made, and no memory is allocated per element.
+ */
+#ifndef __BINTREE_ITERATOR_H
+#define __BINTREE_ITERATOR_H
+
+#include "Exceptions.h"
+#include "Stack.h"       // Pending nodes in depth-first orders
+#include "ArrayQueue.h"  // Pending nodes in level order
+
+/** Order in which a tree traversal visits nodes */
+enum class TraversalOrder { PRE_ORDER, IN_ORDER, POST_ORDER, LEVEL_ORDER };
+
+/**
+ * Iterator over the elements of a binary tree, in any TraversalOrder.
+ * Node is the tree's node type, which must have an _elem and _left and _right
+ * children (raw pointers, or smart pointers with a get()).
+ *
+ * Instead of recursion, depth-first orders keep an explicit stack of
+ * pending nodes, as deep as the tree; level order keeps a queue, as wide
+ * as the tree. Both are allocated once, and then grow only as needed;
+ * advancing is O(1) amortized (but O(depth) in the worst case).
+ * Iterators are invalidated if the tree they refer to is destroyed.
+ */
+template <typename T, typename Node>
+class BinTreeIterator {
+public:
+
+    /** Ctor; returns an iterator past the end of any traversal */
+    BinTreeIterator() : _order(TraversalOrder::IN_ORDER), _current(nullptr) {}
+
+    /** Ctor; returns an iterator at the 1st element of a traversal from root */
+    BinTreeIterator(Node *root, TraversalOrder order) : _order(order), _current(nullptr) {
+        if (root == nullptr) {
+            return;
+        }
+        switch (_order) {
+            case TraversalOrder::PRE_ORDER:
+                _pending.push(Step{root, false});
+                break;
+            case TraversalOrder::IN_ORDER:
+                pushLeftmost(root);
+                break;
+            case TraversalOrder::POST_ORDER:
+                pushFirstPostOrder(root);
+                break;
+            case TraversalOrder::LEVEL_ORDER:
+                _levels.push_back(root);
+                break;
+        }
+        updateCurrent();
+    }
+
+    /** O(1) amortized */
+    void next() {
+        if (_current == nullptr) {
+            throw InvalidAccessException();
+        }
+        Node *done = _current;
+        switch (_order) {
+            case TraversalOrder::PRE_ORDER:
+                // children are visited after their parent; left before right
+                _pending.pop();
+                if (done->_right != nullptr)
+                    _pending.push(Step{raw(done->_right), false});
+                if (done->_left != nullptr)
+                    _pending.push(Step{raw(done->_left), false});
+                break;
+            case TraversalOrder::IN_ORDER:
+                // ancestors still pending are those reached from their left
+                _pending.pop();
+                if (done->_right != nullptr)
+                    pushLeftmost(raw(done->_right));
+                break;
+            case TraversalOrder::POST_ORDER:
+                // parent (if any) is next, unless its right subtree is yet to be visited
+                _pending.pop();
+                if ( ! _pending.empty() && ! _pending.top()._rightTaken) {
+                    Node *parent = _pending.top()._node;
+                    if (parent->_right != nullptr) {
+                        _pending.pop();
+                        _pending.push(Step{parent, true});
+                        pushFirstPostOrder(raw(parent->_right));
+                    }
+                }
+                break;
+            case TraversalOrder::LEVEL_ORDER:
+                _levels.pop_front();
+                if (done->_left != nullptr)
+                    _levels.push_back(raw(done->_left));
+                if (done->_right != nullptr)
+                    _levels.push_back(raw(done->_right));
+                break;
+        }
+        updateCurrent();
+    }
+
+    /** O(1) */
+    const T &elem() const {
+        if (_current == nullptr) throw InvalidAccessException();
+        return _current->_elem;
+    }
+
+    /** O(1) */
+    const T &operator*() const {
+        return elem();
+    }
+
+    /** O(1) */
+    const T *operator->() const {
+        return &elem();
+    }
+
+    /** O(1) */
+    bool operator==(const BinTreeIterator &other) const {
+        return _current == other._current;
+    }
+
+    /** O(1) */
+    bool operator!=(const BinTreeIterator &other) const {
+        return !(this->operator==(other));
+    }
+
+    /** O(1) amortized */
+    BinTreeIterator &operator++() {
+        next();
+        return *this;
+    }
+
+    /** O(depth), since the stack or queue is copied */
+    BinTreeIterator operator++(int) {
+        BinTreeIterator ret(*this);
+        operator++();
+        return ret;
+    }
+
+private:
+
+    /**
+     * A pending node. In post-order, _rightTaken tells whether the iterator has
+     * already gone down its right subtree; it is unused by other orders.
+     */
+    struct Step {
+        Node *_node;
+        bool _rightTaken;
+    };
+
+    static Node *raw(Node *node) {
+        return node;
+    }
+
+    template <typename Pointer>
+    static Node *raw(const Pointer &node) {
+        return node.get();
+    }
+
+    /** pushes node and its chain of left descendants; the last one is visited first */
+    void pushLeftmost(Node *node) {
+        while (node != nullptr) {
+            _pending.push(Step{node, false});
+            node = raw(node->_left);
+        }
+    }
+
+    /** pushes the path from node to the 1st node it would visit in post-order: its first leaf */
+    void pushFirstPostOrder(Node *node) {
+        while (node != nullptr) {
+            if (node->_left != nullptr) {
+                _pending.push(Step{node, false});
+                node = raw(node->_left);
+            } else {
+                _pending.push(Step{node, true});
+                node = raw(node->_right);
+            }
+        }
+    }
+
+    void updateCurrent() {
+        if (_order == TraversalOrder::LEVEL_ORDER) {
+            _current = _levels.empty() ? nullptr : _levels.front();
+        } else {
+            _current = _pending.empty() ? nullptr : _pending.top()._node;
+        }
+    }
+
+    /** Order of this traversal */
+    TraversalOrder _order;
+
+    /** Node with the current element; nullptr if past the end */
+    Node *_current;
+
+    /** Pending nodes for depth-first orders; current one at top */
+    Stack<Step> _pending;
+
+    /** Pending nodes for level order; current one at front */
+    ArrayQueue<Node *> _levels;
+};
+
+/** A traversal of a tree in a given order, for use in range-based for loops */
+template <typename T, typename Node>
+class BinTreeTraversal {
+public:
+    BinTreeTraversal(Node *root, TraversalOrder order) : _root(root), _order(order) {}
+
+    BinTreeIterator<T, Node> begin() const {
+        return BinTreeIterator<T, Node>(_root, _order);
+    }
+
+    BinTreeIterator<T, Node> end() const {
+        return BinTreeIterator<T, Node>();
+    }
+
+private:
+    Node *_root;
+    TraversalOrder _order;
+};
+
+#endif // __BINTREE_ITERATOR_H
@@ -9,26 +9,74 @@
 
 #include "Exceptions.h"
 #include "List.h"    // Returned by traversals
-#include "Queue.h"   // Used for traversal-by-levels
+#include "ArrayQueue.h"   // Used for traversal-by-levels
+#include "BinTreeIterator.h"  // Lazy traversals
 #include <iomanip>   // for setw (precise control of alignment when printing)
 #include <iostream>  // endl 
+#include "IntrusivePtr.h"   // Optional, non-atomic reference counting
 #include <memory>    //shared_ptr
+#include <utility>   // move, forward
+
+/**
+ * Reference-counting policies for BinTreeSmart, which choose the smart
+ * pointer type that links nodes:
+ *   - SharedLinks (the default) uses std::shared_ptr. Trees can be shared by
+ *          several threads, at the cost of atomic operations whenever a
+ *          link is copied or destroyed.
+ *   - IntrusiveLinks uses IntrusivePtr: counts are stored in the nodes 
+ *          themselves, and updated with plain (non-atomic) arithmetic. Faster,
+ *          but trees must only be used from a single thread at a time.
+ */
+struct SharedLinks {
+    template <class N> using Link = std::shared_ptr<N>;
+
+    /** Base class for nodes; shared_ptr keeps its own counts */
+    struct NodeBase {};
+
+    template <class N, typename... Args>
+    static Link<N> make(Args&&... args) {
+        return std::make_shared<N>(std::forward<Args>(args)...);
+    }
+};
+
+struct IntrusiveLinks {
+    template <class N> using Link = IntrusivePtr<N>;
+
+    /** Base class for nodes; holds their count */
+    using NodeBase = IntrusiveRefCount;
+
+    template <class N, typename... Args>
+    static Link<N> make(Args&&... args) {
+        return make_intrusive<N>(std::forward<Args>(args)...);
+    }
+};
 
 /**
  * Dynamic implementation of a binary tree with pointers
  * for left & right children.
- * The structure can be shared, using C++ smart shared pointers
- * to only clean up when necessary.
+ * The structure can be shared, using C++ smart pointers
+ * to only clean up when necessary; see SharedLinks and IntrusiveLinks.
  *
  * Operations are:
  * - BinaryTreeSmart constructor: generator
  * - left, right: observers, return left or right children of a tree (also trees!)
  * - elem: observer, returns element at root
  * - empty: observer, returning true IFF a tree is empty
+ * - view: observer, returns a View of the tree, which can walk it (with left(),
+ *      right() and elem()) without copying any smart pointers. Views borrow 
+ *      the nodes of their tree, and must not outlive it.
+ * - begin(order), end(), traversal(order): observers, iterate through elements in
+ *      any TraversalOrder (see BinTreeIterator.h), visiting them lazily by reference;
+ *      preOrder(visit), inOrder(visit), postOrder(visit) and levels(visit) call
+ *      visit(elem) on each one. Unlike the list-returning traversals, these do not 
+ *      copy elements or allocate memory per element.
  */
 
-template <typename T>
+template <typename T, typename Links = SharedLinks>
 class BinTreeSmart {
+protected:
+    class Node; // Forward declaration, for iterators
+
 public:
 
     /** Constructor; returns an empty tree */
@@ -37,11 +85,19 @@ public:
 
     /** Constructor; returns a tree from left + element + right */
     BinTreeSmart(const BinTreeSmart &left, const T &elem, const BinTreeSmart &right) :
-            _root(std::make_shared<Node>(Node(left._root, elem, right._root))) {}
+            _root(Links::template make<Node>(left._root, elem, right._root)) {}
+
+    /** Same as BinTreeSmart(left, elem, right), but moves elem instead of copying it */
+    BinTreeSmart(const BinTreeSmart &left, T &&elem, const BinTreeSmart &right) :
+            _root(Links::template make<Node>(left._root, std::move(elem), right._root)) {}
 
     /** Constructor; returns a tree where the root is a leaf node containing elem  */
     BinTreeSmart(const T &elem) :
-            _root(std::make_shared<Node>(Node(nullptr, elem, nullptr))) {}
+            _root(Links::template make<Node>(nullptr, elem, nullptr)) {}
+
+    /** Same as BinTreeSmart(elem), but moves elem instead of copying it */
+    BinTreeSmart(T &&elem) :
+            _root(Links::template make<Node>(nullptr, std::move(elem), nullptr)) {}
 
     /**
      * Returns element at root.
@@ -109,22 +165,148 @@ public:
     List<T>* levels() const {
         List<T>* ret = new List<T>();
         if (!empty()){
-            Queue<Link> pending;
-            pending.push_back(_root);
+            ArrayQueue<const Node*> pending;
+            pending.push_back(_root.get());
 
             while (!pending.empty()) {
-                Link current = pending.front();
+                const Node *current = pending.front();
                 pending.pop_front();
                 ret->push_back(current->_elem);
                 if (current->_left != nullptr)
-                    pending.push_back(current->_left);
+                    pending.push_back(current->_left.get());
                 if (current->_right != nullptr)
-                    pending.push_back(current->_right);
+                    pending.push_back(current->_right.get());
             }
         }
         return ret;
     }
 
+    // //
+    // LAZY TRAVERSALS; return references to elements, without copies
+    // //
+
+    /** Iterator over elements, in any TraversalOrder */
+    using ConstIterator = BinTreeIterator<T, Node>;
+
+    /** Returns an iterator at the 1st element in the given order. O(depth) */
+    ConstIterator begin(TraversalOrder order = TraversalOrder::IN_ORDER) const {
+        return ConstIterator(_root.get(), order);
+    }
+
+    /** Returns an iterator past the last element, for any order. O(1) */
+    ConstIterator end() const {
+        return ConstIterator();
+    }
+
+    /** 
+     * Returns a traversal in the given order, for range-based for loops:
+     *     for (const T &e : tree.traversal(TraversalOrder::PRE_ORDER)) ...
+     */
+    BinTreeTraversal<T, Node> traversal(TraversalOrder order) const {
+        return BinTreeTraversal<T, Node>(_root.get(), order);
+    }
+
+    /** Calls visit(e) for each element e, in pre-order. O(n) */
+    template <typename F>
+    void preOrder(F visit) const {
+        visitAll(TraversalOrder::PRE_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, in in-order. O(n) */
+    template <typename F>
+    void inOrder(F visit) const {
+        visitAll(TraversalOrder::IN_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, in post-order. O(n) */
+    template <typename F>
+    void postOrder(F visit) const {
+        visitAll(TraversalOrder::POST_ORDER, visit);
+    }
+
+    /** Calls visit(e) for each element e, by levels. O(n) */
+    template <typename F>
+    void levels(F visit) const {
+        visitAll(TraversalOrder::LEVEL_ORDER, visit);
+    }
+
+    // //
+    // BORROWED VIEWS
+    // //
+
+    /**
+     * Read-only view of a tree (or of one of its subtrees), that walks it without
+     * copying any smart pointer, and therefore without updating any reference
+     * count. Views borrow the nodes of the tree they were taken from,
+     * and must not outlive it.
+     */
+    class View {
+    public:
+        /** Ctor; returns a view of an empty tree */
+        View() : _node(nullptr) {}
+
+        /** True IFF viewed tree is empty. O(1) */
+        bool empty() const {
+            return _node == nullptr;
+        }
+
+        /** Returns element at root. Partial observer, O(1) */
+        const T &elem() const {
+            if (empty()) {
+                throw EmptyTreeException();
+            }
+            return _node->_elem;
+        }
+
+        /** Returns a view of the left subtree. Partial observer, O(1) */
+        View left() const {
+            if (empty()) {
+                throw EmptyTreeException();
+            }
+            return View(_node->_left.get());
+        }
+
+        /** Returns a view of the right subtree. Partial observer, O(1) */
+        View right() const {
+            if (empty()) {
+                throw EmptyTreeException();
+            }
+            return View(_node->_right.get());
+        }
+
+        /** Returns an iterator at the 1st element in the given order. O(depth) */
+        ConstIterator begin(TraversalOrder order = TraversalOrder::IN_ORDER) const {
+            return ConstIterator(_node, order);
+        }
+
+        /** Returns an iterator past the last element, for any order. O(1) */
+        ConstIterator end() const {
+            return ConstIterator();
+        }
+
+        /** True IFF both view the very same nodes. O(1) */
+        bool operator==(const View &other) const {
+            return _node == other._node;
+        }
+
+        bool operator!=(const View &other) const {
+            return _node != other._node;
+        }
+
+    private:
+        friend class BinTreeSmart;
+
+        explicit View(Node *node) : _node(node) {}
+
+        /** Root of the viewed tree; nullptr if empty */
+        Node *_node;
+    };
+
+    /** Returns a view of this tree; see View. O(1) */
+    View view() const {
+        return View(_root.get());
+    }
+
     // //
     // OTHER OBSERVERS
     // //
@@ -150,11 +332,11 @@ public:
     // //
 
     /** Comparison operators. */
-    bool operator==(const BinTreeSmart<T> &rhs) const {
+    bool operator==(const BinTreeSmart &rhs) const {
         return compareAux(_root, rhs._root);
     }
 
-    bool operator!=(const BinTreeSmart<T> &rhs) const {
+    bool operator!=(const BinTreeSmart &rhs) const {
         return !(*this == rhs);
     }
 
@@ -162,7 +344,7 @@ public:
      *  Output, adapted from "ADTs, DataStructures, and Problem Solving with C++", 
      *  Larry Nyhoff, Person, 2015
      */
-    friend std::ostream& operator<<(std::ostream& o, const BinTreeSmart<T>& t){
+    friend std::ostream& operator<<(std::ostream& o, const BinTreeSmart& t){
         o  << "==== Tree =====" << std::endl;
         outputIndented(o, 0, t._root);
         o << "===============" << std::endl;
@@ -177,15 +359,15 @@ public:
      *   2   3
      *  X X X X
      */
-    static BinTreeSmart<T> fromPreOrderInput(const T& emptyRep) {
+    static BinTreeSmart fromPreOrderInput(const T& emptyRep) {
         T elem;
         std::cin >> elem;
         if (elem == emptyRep)
-            return BinTreeSmart<T>();
+            return BinTreeSmart();
         else {
-            BinTreeSmart<T> hi = fromPreOrderInput(emptyRep);
-            BinTreeSmart<T> hd = fromPreOrderInput(emptyRep);
-            return BinTreeSmart<T>(hi, elem, hd);
+            BinTreeSmart hi = fromPreOrderInput(emptyRep);
+            BinTreeSmart hd = fromPreOrderInput(emptyRep);
+            return BinTreeSmart(hi, elem, hd);
         }
     }
 
@@ -197,20 +379,20 @@ public:
      *   2   3
      *  X X X X
       */
-    static BinTreeSmart<T> fromInOrderInput() {
+    static BinTreeSmart fromInOrderInput() {
         char c;
         std::cin >> c;
         if (c == '.')
-            return BinTreeSmart<T>(); 
+            return BinTreeSmart(); 
         else {
             assert (c == '(');
-            BinTreeSmart<T> left = fromInOrderInput();
+            BinTreeSmart left = fromInOrderInput();
             T elem;
             std::cin >> elem;
-            BinTreeSmart<T> right = fromInOrderInput();
+            BinTreeSmart right = fromInOrderInput();
             std::cin >> c;
             assert (c == ')');
-            BinTreeSmart<T> result(left, elem, right);
+            BinTreeSmart result(left, elem, right);
             return result;
         }
     }
@@ -224,14 +406,14 @@ protected:
     /**
      * Internal node class
      */
-    class Node; // Forward declaration so that next line compiles
-    using Link = std::shared_ptr<Node>; // Type alias; avoids lots of typing
+    using Link = typename Links::template Link<Node>; // Type alias; avoids lots of typing
 
-    class Node {
+    class Node : public Links::NodeBase {
     public:
         Node() : _left(nullptr), _right(nullptr) {}
-        Node(Link left, const T &elem, Link right) : 
-            _elem(elem), _left(left), _right(right) {}
+        template <typename TT>
+        Node(const Link &left, TT &&elem, const Link &right) : 
+            _elem(std::forward<TT>(elem)), _left(left), _right(right) {}
 
         T _elem;
         Link _left;
@@ -240,7 +422,7 @@ protected:
 
     /**
      * Protected constructor, which builds a tree from an existing root node.
-     * Using std::shared_ptr takes care of references for us
+     * Using smart pointers takes care of references for us
      */
     BinTreeSmart(Link raiz) : _root(raiz) {}
 
@@ -248,7 +430,7 @@ protected:
     // AUX METHODS FOR TRAVERSAL
     // //
     
-    static void preOrderAux(Link root, List<T> &acc) {
+    static void preOrderAux(const Link &root, List<T> &acc) {
         if (root != nullptr){
             acc.push_back(root->_elem);
             preOrderAux(root->_left, acc);
@@ -256,7 +438,7 @@ protected:
         }
     }
 
-    static void inOrderAux(Link root, List<T> &acc) {
+    static void inOrderAux(const Link &root, List<T> &acc) {
         if (root != nullptr) {
             inOrderAux(root->_left, acc);
             acc.push_back(root->_elem);
@@ -264,7 +446,7 @@ protected:
         }
     }
 
-    static void postOrderAux(Link root, List<T> &acc) {
+    static void postOrderAux(const Link &root, List<T> &acc) {
         if (root != nullptr) {
             postOrderAux(root->_left, acc);
             postOrderAux(root->_right, acc);
@@ -272,7 +454,7 @@ protected:
         }
     }
 
-    static void outputIndented(std::ostream & out, int indent, Link root){
+    static void outputIndented(std::ostream & out, int indent, const Link &root){
         if (root != nullptr) {
             outputIndented(out, indent + TREE_INDENTATION, root->_right);
             out << std::setw(indent) << " " << root->_elem << std::endl;
@@ -280,18 +462,25 @@ protected:
         }
     }
 
+    template <typename F>
+    void visitAll(TraversalOrder order, F &visit) const {
+        for (ConstIterator it = begin(order); it != end(); ++it) {
+            visit(*it);
+        }
+    }
+
     // //
     // OTHER AUX METHODS
     // //
 
-    static unsigned int nodeCountAux(Link root) {
+    static unsigned int nodeCountAux(const Link &root) {
         if (root == nullptr) {
             return 0;
         }
         return 1 + nodeCountAux(root->_left) + nodeCountAux(root->_right);
     }
 
-    static unsigned int depthAux(Link root) {
+    static unsigned int depthAux(const Link &root) {
         if (root == nullptr) {
             return 0;
         }
@@ -304,7 +493,7 @@ protected:
         }
     }
 
-    static unsigned int leafCountAux(Link root) {
+    static unsigned int leafCountAux(const Link &root) {
         if (root == nullptr) {
             return 0;
         }
@@ -321,7 +510,7 @@ private:
     /**
      * Compares two nodes and their children for equality
      */
-    static bool compareAux(Link r1, Link r2) {
+    static bool compareAux(const Link &r1, const Link &r2) {
         if (r1 == r2)
             // Note that this covers "both are null"
             return true;
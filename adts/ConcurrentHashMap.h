@@ -0,0 +1,234 @@
+/**
+ * Map ADT for concurrent use, sharding keys among several HashMaps
+ * Each shard has its own lock, so that threads working on different shards
+ * never wait for each other.
+ */
+#ifndef __CONCURRENT_HASHMAP_H
+#define __CONCURRENT_HASHMAP_H
+
+#include "Exceptions.h"
+#include "Hash.h"             // Used to mix hashes into shard indices
+#include "HashMap.h"          // Each shard is a HashMap
+#include "ConcurrentQueue.h"  // concurrent_detail::CACHE_LINE_SIZE
+#include <cstdint>            // uint64_t
+#include <mutex>              // unique_lock
+#include <shared_mutex>       // shared_mutex, shared_lock
+#include <utility>            // move, forward
+
+/**
+ * Map that can be shared among threads, splitting its keys among Shards
+ * independent HashMaps (Shards must be a power of 2). Each shard is guarded
+ * by a readers-writer lock: any number of threads may read a shard at the
+ * same time; writers get it for themselves.
+ *
+ * Since another thread may erase or change a value at any time, no
+ * references to values are ever returned: observers return copies, and
+ * compound operations take a function that runs while the shard is locked.
+ * Operations are (all thread-safe):
+ *    - insert(key, value): generator. Adds or replaces the value of key.
+ *    - try_emplace(key, args...): generator. Adds key with a value built from
+ *          args, unless already present. Returns true IFF added.
+ *    - compute_if_absent(key, f): generator. Returns the value of key; if
+ *          absent, first adds it with value f(key). Atomic: f is called at most
+ *          once per key, even if many threads ask for the same key at once.
+ *    - compute(key, f): mutator. Calls f(value) on the value of key (added
+ *          default-constructed if absent), as a single atomic update.
+ *    - erase(key): mutator. Returns true IFF key was present.
+ *    - get(key, out): observer. Copies value of key into out, if present;
+ *          returns true IFF present.
+ *    - at(key): observer. Returns a copy of the value of key; partial, fails if absent.
+ *    - contains(key): observer. True IFF key present.
+ *    - size(), empty(): observers. Lock shards one at a time, so results may
+ *          be stale if other threads are changing the map.
+ *    - reserve(n): mutator. Makes room for n keys, spread over all shards.
+ *    - for_each(f): observer. Calls f(key, value) for each entry, locking one shard at a time.
+ *
+ * Each shard grows on its own, when its own load factor is exceeded, and blocks
+ * only the threads that use that shard. Shards are chosen using the high bits
+ * of the mixed hash, since each HashMap uses low bits to choose bins. Functions
+ * passed to compute and compute_if_absent must not use the map.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, unsigned int Shards = 16>
+class ConcurrentHashMap {
+public:
+
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0,
+        "ConcurrentHashMap requires a power-of-2 number of shards");
+
+    /** Constructor; returns an empty map. O(Shards) */
+    ConcurrentHashMap() {}
+
+    /** Adds a key, value pair; if key already present, replaces its value. O(1) amortized */
+    void insert(const K &key, const V &value) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        shard._map.insert(key, value);
+    }
+
+    /** Same as insert(key, value), but moves key & value instead of copying them. */
+    void insert(K &&key, V &&value) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        shard._map.insert(std::move(key), std::move(value));
+    }
+
+    /**
+     * If key is not present, adds it, with a value built in place from args.
+     * Returns true IFF the key was added. O(1) amortized
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        return shard._map.try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Returns the value of key. If absent, first adds key with value f(key).
+     * Present keys are looked up with a shared lock, and only absent ones need
+     * an exclusive lock (and a second look, as another thread may have added it
+     * in between). O(1) amortized, plus the cost of f
+     */
+    template <typename F>
+    V compute_if_absent(const K &key, F f) {
+        Shard &shard = shardFor(key);
+        {
+            std::shared_lock<std::shared_mutex> lock(shard._mutex);
+            if (shard._map.contains(key)) {
+                return shard._map.at(key);
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        if ( ! shard._map.contains(key)) {
+            shard._map.try_emplace(key, f(key));
+        }
+        return shard._map.at(key);
+    }
+
+    /**
+     * Calls f(value) on the value of key, adding key with a default value if
+     * absent; no other thread sees the value until f returns. Returns whatever f returns.
+     * O(1) amortized, plus the cost of f
+     */
+    template <typename F>
+    auto compute(const K &key, F f) -> decltype(f(std::declval<V&>())) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        return f(shard._map[key]);
+    }
+
+    /** Removes key, returning true IFF it was present. O(1) */
+    bool erase(const K &key) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+        if ( ! shard._map.contains(key)) {
+            return false;
+        }
+        shard._map.erase(key);
+        return true;
+    }
+
+    /** Copies the value of key into out, and returns true; returns false if absent. O(1) */
+    bool get(const K &key, V &out) const {
+        const Shard &shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard._mutex);
+        if ( ! shard._map.contains(key)) {
+            return false;
+        }
+        out = shard._map.at(key);
+        return true;
+    }
+
+    /**
+     * Returns a copy of the value of key.
+     * Partial - if key not present, throws exception. Use get() if unsure. O(1)
+     */
+    V at(const K &key) const {
+        const Shard &shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard._mutex);
+        return shard._map.at(key);
+    }
+
+    /** Returns true IFF key present. O(1) */
+    bool contains(const K &key) const {
+        const Shard &shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard._mutex);
+        return shard._map.contains(key);
+    }
+
+    /** Returns number of keys in map, adding up all shards. O(Shards) */
+    int size() const {
+        int total = 0;
+        for (const Shard &shard : _shards) {
+            std::shared_lock<std::shared_mutex> lock(shard._mutex);
+            total += shard._map.size();
+        }
+        return total;
+    }
+
+    /** Returns true IFF no keys in map. O(Shards) */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /** Makes room for n keys, assuming they spread evenly over shards. O(n + bins) */
+    void reserve(unsigned int n) {
+        for (Shard &shard : _shards) {
+            std::unique_lock<std::shared_mutex> lock(shard._mutex);
+            shard._map.reserve(n / Shards + 1);
+        }
+    }
+
+    /**
+     * Calls f(key, value) for all entries, one shard at a time; that
+     * shard cannot be changed while f runs on its entries. O(n + bins)
+     */
+    template <typename F>
+    void for_each(F f) const {
+        for (const Shard &shard : _shards) {
+            std::shared_lock<std::shared_mutex> lock(shard._mutex);
+            for (auto it = shard._map.cbegin(); it != shard._map.cend(); ++it) {
+                f(it.key(), it.value());
+            }
+        }
+    }
+
+    // locks cannot be copied, and concurrent maps are shared by address
+    ConcurrentHashMap(const ConcurrentHashMap &other) = delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &other) = delete;
+
+private:
+
+    /** A HashMap and its lock; kept on separate cache lines, so that shards do not slow each other down */
+    struct alignas(concurrent_detail::CACHE_LINE_SIZE) Shard {
+        mutable std::shared_mutex _mutex;
+        HashMap<K, V, Hash> _map;
+    };
+
+    /** Returns the shard for a key. O(1) */
+    Shard &shardFor(const K &key) {
+        return _shards[shardIndex(key)];
+    }
+
+    /** Returns the shard for a key. O(1) */
+    const Shard &shardFor(const K &key) const {
+        return _shards[shardIndex(key)];
+    }
+
+    /**
+     * High bits of the mixed hash: the top 32 bits, scaled to [0, Shards).
+     * For a power-of-2 Shards, these are exactly its top log2(Shards) bits.
+     */
+    unsigned int shardIndex(const K &key) const {
+        std::uint64_t high = mixhash(_hash(key)) >> 32;
+        return (unsigned int)((high * Shards) >> 32);
+    }
+
+    /** Shards; keys never move from one to another */
+    Shard _shards[Shards];
+
+    /** Hash function, to choose shards */
+    Hash _hash;
+};
+
+#endif // __CONCURRENT_HASHMAP_H
@@ -0,0 +1,347 @@
+/**
+ * Bounded lock-free queues, to pass elements between threads
+ * Two flavours: SPSCQueue (a single producer thread and a single consumer
+ * thread) and MPMCQueue (any number of each).
+ */
+#ifndef __CONCURRENT_QUEUE_H
+#define __CONCURRENT_QUEUE_H
+
+#include "Exceptions.h"
+#include <atomic>
+#include <cstddef>      // size_t
+#include <cstdint>      // intptr_t
+#include <new>          // placement new
+#include <type_traits>  // is_nothrow_constructible, is_nothrow_move_assignable
+#include <utility>      // move, forward
+
+namespace concurrent_detail {
+
+    /**
+     * Size of a cache line, so that indices written by different threads can be
+     * kept apart: two threads writing to the same line would keep stealing it
+     * from each other ("false sharing") even though they touch different fields.
+     * Aligning the last index also pads the whole queue to a multiple of this size,
+     * so nothing that follows it in memory shares that index's line.
+     * Not std::hardware_destructive_interference_size: its value may change with
+     * compiler flags, which would change the layout of these classes between
+     * translation units (GCC warns about using it in headers for this reason).
+     */
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+}
+
+/**
+ * Bounded queue for exactly one producer thread and one consumer thread.
+ * Elements are kept in a circular array, as in ArrayQueue.h, but it never grows.
+ * Operations are (producer-only and consumer-only, respectively):
+ *   - try_push: Queue, Elem -> Bool. Also try_emplace(args...), building in place.
+ *          Returns false, and does nothing, if the queue is full. O(1)
+ *   - try_pop: Queue, Elem& -> Bool. Moves the front element into the argument
+ *          and removes it; returns false, and does nothing, if empty. O(1)
+ * And, from any thread (results may already be stale when they are returned):
+ *   - empty, size: observers
+ *   - capacity: observer. Max elements; fixed at construction
+ *
+ * Each index is only written by one thread. The producer owns _tail, and the
+ * consumer owns _head; each keeps a cached copy of the other's index, and only
+ * re-reads the real one (which costs a cache miss) when its copy says that
+ * the queue is full (or empty).
+ */
+template <class T>
+class SPSCQueue {
+public:
+
+    /** Constructor; capacity is rounded up to a power of 2, and must be > 0. */
+    explicit SPSCQueue(std::size_t capacity) :
+            _capacity(roundUp(capacity)), _mask(_capacity - 1),
+            _slots(new Slot[_capacity]),
+            _head(0), _cachedTail(0), _tail(0), _cachedHead(0) {
+    }
+
+    /** Destructor; destroys elements left in the queue. Not thread-safe. O(n) */
+    ~SPSCQueue() {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        for (std::size_t i = _head.load(std::memory_order_relaxed); i != tail; ++i) {
+            elem(i).~T();
+        }
+        delete[] _slots;
+    }
+
+    /** Pushes an element at back, unless full. Producer only. O(1) */
+    bool try_push(const T &_elem) {
+        return try_emplace(_elem);
+    }
+
+    /** Pushes an element at back, moving it, unless full. Producer only. O(1) */
+    bool try_push(T &&_elem) {
+        return try_emplace(std::move(_elem));
+    }
+
+    /** Pushes an element built from the given arguments, unless full. Producer only. O(1) */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cachedHead == _capacity) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            if (tail - _cachedHead == _capacity) {
+                return false;
+            }
+        }
+        new (_slots[tail & _mask]._elem) T(std::forward<Args>(args)...);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Pops the front element into out, unless empty. Consumer only. O(1) */
+    bool try_pop(T &out) {
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _cachedTail) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head == _cachedTail) {
+                return false;
+            }
+        }
+        T &front = elem(head);
+        out = std::move(front);
+        front.~T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** True IFF queue is empty. Observer. O(1) */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /** Returns number of elements. Observer. O(1) */
+    std::size_t size() const {
+        std::size_t head = _head.load(std::memory_order_acquire);
+        return _tail.load(std::memory_order_acquire) - head;
+    }
+
+    /** Returns max number of elements. Observer. O(1) */
+    std::size_t capacity() const {
+        return _capacity;
+    }
+
+    // concurrent queues are shared by address; they cannot be copied or moved
+    SPSCQueue(const SPSCQueue &other) = delete;
+    SPSCQueue &operator=(const SPSCQueue &other) = delete;
+
+private:
+
+    /** Raw memory for one element */
+    struct Slot {
+        alignas(T) unsigned char _elem[sizeof(T)];
+    };
+
+    /** smallest power of 2 that is >= n; fails if n is 0 */
+    static std::size_t roundUp(std::size_t n) {
+        if (n == 0) {
+            throw InvalidAccessException("Capacity must be positive");
+        }
+        std::size_t capacity = 1;
+        while (capacity < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    /** element at (unwrapped) index i, which must be built */
+    T &elem(std::size_t i) {
+        return *reinterpret_cast<T *>(_slots[i & _mask]._elem);
+    }
+
+    // read-only after construction; shared by both threads
+    const std::size_t _capacity;
+    const std::size_t _mask;
+    Slot *const _slots;
+
+    /** Next index to pop; written by the consumer */
+    alignas(concurrent_detail::CACHE_LINE_SIZE) std::atomic<std::size_t> _head;
+
+    /** Consumer's copy of _tail */
+    std::size_t _cachedTail;
+
+    /** Next index to push; written by the producer */
+    alignas(concurrent_detail::CACHE_LINE_SIZE) std::atomic<std::size_t> _tail;
+
+    /** Producer's copy of _head */
+    std::size_t _cachedHead;
+};
+
+/**
+ * Bounded queue for any number of producer and consumer threads, with the
+ * same interface as SPSCQueue; try_push and try_pop may be called from any thread.
+ *
+ * Uses Dmitry Vyukov's algorithm: each slot has a sequence number that says
+ * whether it is ready to be pushed into (seq == index) or popped from
+ * (seq == index + 1) by whoever claims that index. Threads claim indices with
+ * a compare-and-swap on _enqueuePos or _dequeuePos; they never wait on each
+ * other's locks, and a full or empty queue is reported instead of waited on.
+ *
+ * T's move constructor and move assignment must not throw: once a thread
+ * has claimed a slot, it must fill (or empty) it, or every thread would stop
+ * at it forever; producers move elements into slots, and consumers move them
+ * out by assignment. Elements whose construction from args may throw are
+ * built before claiming a slot.
+ */
+template <class T>
+class MPMCQueue {
+public:
+
+    static_assert(std::is_nothrow_move_constructible<T>::value
+                  && std::is_nothrow_move_assignable<T>::value,
+        "MPMCQueue requires elements with a non-throwing move constructor and move assignment");
+
+    /** Constructor; capacity is rounded up to a power of 2, and must be > 1. */
+    explicit MPMCQueue(std::size_t capacity) :
+            _capacity(roundUp(capacity)), _mask(_capacity - 1),
+            _cells(new Cell[_capacity]),
+            _enqueuePos(0), _dequeuePos(0) {
+        for (std::size_t i = 0; i < _capacity; ++i) {
+            _cells[i]._seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** Destructor; destroys elements left in the queue. Not thread-safe. O(n) */
+    ~MPMCQueue() {
+        std::size_t end = _enqueuePos.load(std::memory_order_relaxed);
+        for (std::size_t i = _dequeuePos.load(std::memory_order_relaxed); i != end; ++i) {
+            elem(_cells[i & _mask]).~T();
+        }
+        delete[] _cells;
+    }
+
+    /** Pushes an element at back, unless full. O(1), plus retries under contention */
+    bool try_push(const T &_elem) {
+        return try_emplace(_elem);
+    }
+
+    /** Pushes an element at back, moving it, unless full. O(1), plus retries under contention */
+    bool try_push(T &&_elem) {
+        return try_emplace(std::move(_elem));
+    }
+
+    /**
+     * Pushes an element built from the given arguments, unless full.
+     * If building it may throw, it is built first, and then moved in place.
+     * O(1), plus retries under contention
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        if constexpr ( ! std::is_nothrow_constructible<T, Args&&...>::value) {
+            T built(std::forward<Args>(args)...);
+            return try_emplace(std::move(built));
+        } else {
+            std::size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true) {
+                cell = &_cells[pos & _mask];
+                std::size_t seq = cell->_seq.load(std::memory_order_acquire);
+                std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    // free slot; claim it, unless another producer got there first
+                    if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // slot still holds an element from a full lap ago
+                } else {
+                    pos = _enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            new (cell->_elem) T(std::forward<Args>(args)...);
+            cell->_seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+    }
+
+    /** Pops the front element into out, unless empty. O(1), plus retries under contention */
+    bool try_pop(T &out) {
+        std::size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &_cells[pos & _mask];
+            std::size_t seq = cell->_seq.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                // filled slot; claim it, unless another consumer got there first
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // slot not yet filled
+            } else {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T &front = elem(*cell);
+        out = std::move(front);
+        front.~T();
+        // ready to be pushed into by whoever claims this slot in the next lap
+        cell->_seq.store(pos + _capacity, std::memory_order_release);
+        return true;
+    }
+
+    /** True IFF queue is empty. Observer. O(1) */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /** Returns number of claimed elements (including some not yet fully pushed or popped). O(1) */
+    std::size_t size() const {
+        std::size_t dequeued = _dequeuePos.load(std::memory_order_acquire);
+        std::size_t enqueued = _enqueuePos.load(std::memory_order_acquire);
+        return (enqueued > dequeued) ? enqueued - dequeued : 0;
+    }
+
+    /** Returns max number of elements. Observer. O(1) */
+    std::size_t capacity() const {
+        return _capacity;
+    }
+
+    // concurrent queues are shared by address; they cannot be copied or moved
+    MPMCQueue(const MPMCQueue &other) = delete;
+    MPMCQueue &operator=(const MPMCQueue &other) = delete;
+
+private:
+
+    /** Raw memory for one element, with its sequence number */
+    struct Cell {
+        std::atomic<std::size_t> _seq;
+        alignas(T) unsigned char _elem[sizeof(T)];
+    };
+
+    /**
+     * smallest power of 2 that is >= n; fails if n < 2, since sequence
+     * numbers of a 1-slot queue could not tell "full" from "empty"
+     */
+    static std::size_t roundUp(std::size_t n) {
+        if (n < 2) {
+            throw InvalidAccessException("Capacity must be at least 2");
+        }
+        std::size_t capacity = 2;
+        while (capacity < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    /** element in cell, which must be built */
+    static T &elem(Cell &cell) {
+        return *reinterpret_cast<T *>(cell._elem);
+    }
+
+    // read-only after construction; shared by all threads
+    const std::size_t _capacity;
+    const std::size_t _mask;
+    Cell *const _cells;
+
+    /** Next index to push into; shared by producers */
+    alignas(concurrent_detail::CACHE_LINE_SIZE) std::atomic<std::size_t> _enqueuePos;
+
+    /** Next index to pop from; shared by consumers */
+    alignas(concurrent_detail::CACHE_LINE_SIZE) std::atomic<std::size_t> _dequeuePos;
+};
+
+#endif // __CONCURRENT_QUEUE_H
@@ -69,4 +69,7 @@ DECLARE_EXCEPTION(EmptyTreeException);
 /** Invalid key passed to certain tree and hashmap operations. */
 DECLARE_EXCEPTION(BadKeyException);
 
+/** Snapshot data that is truncated, corrupt, or of another kind, version or machine. */
+DECLARE_EXCEPTION(BadSnapshotException);
+
 #endif // __EXCEPTIONS_H
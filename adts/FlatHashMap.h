@@ -0,0 +1,717 @@
+/**
+ * Map ADT using a flat (open-addressing) hash table
+ * Same interface as HashMap.h, but keys and values live inline in a single
+ * contiguous array of slots instead of in per-entry heap nodes.
+ */
+
+#ifndef __FLATHASHMAP_H
+#define __FLATHASHMAP_H
+
+#include <iostream>
+#include <cstdint>
+#include <new>      // placement new
+#include <utility>
+#include "Exceptions.h"
+
+/**
+ * Map using an open-addressing hash table with Robin Hood linear probing
+ *
+ * Each slot stores its distance from the bin its key hashes to ("home" bin).
+ * On insertion, an entry that is further from home than the one occupying a
+ * slot takes that slot, and the displaced entry continues probing. This keeps
+ * probe sequences short, and allows lookups to stop as soon as they reach a
+ * slot whose entry is closer to home than the searched-for key would be.
+ * Erasing shifts the following entries of the cluster one slot back, so that
+ * no tombstones are ever left behind.
+ *
+ * Requires keys to support a hash function (see HashMap.h) and operator==.
+ * Operations are:
+ *    - FlatHashMap constructor: generator
+ *    - insert(key, value): generator, adds a new (key, value) pair to the map.
+ *          If the key was already present, replaces its value with the new one.
+ *          Keys and values passed as rvalues are moved instead of copied.
+ *    - try_emplace(key, args...): generator, adds key with a value built from args,
+ *          if the key was not already present.
+ *    - erase(key): mutator. Removes the key from the map. No effect if key absent.
+ *    - at(key): observer. Returns value that corresponds to a key.
+ *          Partial: key must exist; use contains() first if unsure.
+ *    - contains(key): observer. Returnes true iff key exists in map
+ *    - empty(): observer. Returns true if no keys present.
+ *    - size(): observer. Returns count of currently-contained keys.
+ *
+ * Unlike HashMap, inserting or erasing moves other entries around; any
+ * iterator or reference to a value becomes invalid after either operation.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatHashMap {
+private:
+    /**
+     * A key-value pair, as stored in the table
+     */
+    class Entry {
+    public:
+        template <typename KK, typename VV>
+        Entry(KK &&key, VV &&value) : _key(std::forward<KK>(key)), _value(std::forward<VV>(value)) {}
+
+        K _key;
+        V _value;
+    };
+
+    /**
+     * A table slot. _dist is 0 for empty slots; otherwise, it is
+     * 1 + the distance from the entry's home bin. The entry is only
+     * constructed while the slot is in use.
+     */
+    class Slot {
+    public:
+        Slot() : _dist(0) {}
+        ~Slot() {}
+
+        unsigned int _dist;
+        union {
+            Entry _entry;
+        };
+    };
+
+public:
+
+    /** Initial table size (number of slots). Must be a power of 2 */
+    static const int INITIAL_CAPACITY = 16;
+
+    /** Largest table size: the largest power of 2 that fits in an unsigned int */
+    static const unsigned int MAX_CAPACITY = 1u << 31;
+
+    /** Constructor; returns an empty FlatHashMap. O(1) */
+    FlatHashMap() : _entryCount(0) {
+        init(INITIAL_CAPACITY);
+    }
+
+    /** Destructor; destroys entries in O(capacity) */
+    ~FlatHashMap() {
+        free();
+    }
+
+    /**
+     * Adds a new key, value pair to the map. If key
+     * already present, replaces old value with new one.
+     * generator, O(1) amortized cost.
+     */
+    void insert(const K &key, const V &value) {
+        unsigned int idx = findSlot(key);
+        if (idx != _capacity) { // key exists: overwrite value
+            _slots[idx]._entry._value = value;
+        } else {
+            insertNew(key, value);
+        }
+    }
+
+    /**
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(1) amortized cost.
+     */
+    void insert(K &&key, V &&value) {
+        unsigned int idx = findSlot(key);
+        if (idx != _capacity) { // key exists: overwrite value
+            _slots[idx]._entry._value = std::move(value);
+        } else {
+            insertNew(std::move(key), std::move(value));
+        }
+    }
+
+    /**
+     * If key is not present, adds it, with a value built from args.
+     * No effect (and args not used) if key already present.
+     * Since entries move around as they are placed, the value is built
+     * once and then moved; never copied.
+     * Returns true IFF the key was added.
+     * generator, O(1) amortized cost.
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        if (findSlot(key) != _capacity) {
+            return false;
+        }
+        insertNew(key, V(std::forward<Args>(args)...));
+        return true;
+    }
+
+    /** Same as try_emplace(key, args...), but moves key if added. */
+    template <typename... Args>
+    bool try_emplace(K &&key, Args&&... args) {
+        if (findSlot(key) != _capacity) {
+            return false;
+        }
+        insertNew(std::move(key), V(std::forward<Args>(args)...));
+        return true;
+    }
+
+    /**
+     * Removes a key, value pair from the map.
+     * No effect if key not there in the first place.
+     * mutator, O(1)
+     */
+    void erase(const K &key) {
+        unsigned int idx = findSlot(key);
+        if (idx == _capacity) {
+            return;
+        }
+        _slots[idx]._entry.~Entry();
+        // Backward shift: pull later entries of the cluster one slot closer
+        // to home, until an empty slot or an entry already at home is found
+        unsigned int next = (idx + 1) & _mask;
+        while (_slots[next]._dist > 1) {
+            new (&_slots[idx]._entry) Entry(std::move(_slots[next]._entry));
+            _slots[idx]._dist = _slots[next]._dist - 1;
+            _slots[next]._entry.~Entry();
+            idx = next;
+            next = (next + 1) & _mask;
+        }
+        _slots[idx]._dist = 0;
+        _entryCount--;
+    }
+
+    /**
+     * Returns value associated to a key.
+     * Partial - if key not present, throws exception. Use contains() if unsure
+     * observer, O(1)
+     */
+    const V &at(const K &key) const {
+        unsigned int idx = findSlot(key);
+        if (idx == _capacity) {
+            throw BadKeyException();
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    /**
+     * Returns true IFF key in map
+     * observer, O(1)
+     */
+    bool contains(const K &key) const {
+        return findSlot(key) != _capacity;
+    }
+
+    /**
+     * Returns true IFF no elements in map
+     * observer, O(1)
+     */
+    bool empty() const {
+        return _entryCount == 0;
+    }
+
+    /**
+     * Returns number of keys in map.
+     * observer, O(1)
+     */
+    int size() const {
+        return _entryCount;
+    }
+
+    /**
+     * Overloads the [] operator, to access (and possibly modify) a value given its key.
+     * If the key is not present, inserts a new (default) value for that key.
+     */
+    V &operator[](const K &key) {
+        unsigned int idx = findSlot(key);
+        if (idx == _capacity) { // Not there, must add
+            idx = insertNew(key, V());
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    /** Same as operator[](key), but moves key if it must be added. */
+    V &operator[](K &&key) {
+        unsigned int idx = findSlot(key);
+        if (idx == _capacity) { // Not there, must add
+            idx = insertNew(std::move(key), V());
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    // //
+    // NON-CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Allows changing values (but not keys)
+     */
+    class Iterator {
+    public:
+        Iterator() : _table(nullptr), _idx(0) {}
+
+        /** O(1) amortized. */
+        void next() {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            _idx = _table->nextUsed(_idx + 1);
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._key;
+        }
+
+        /** O(1) */
+        V &value() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._value;
+        }
+
+        /** O(1) */
+        bool operator==(const Iterator &other) const {
+            return _idx == other._idx;
+        }
+
+        /** O(1) */
+        bool operator!=(const Iterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        Iterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        Iterator operator++(int) {
+            Iterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class FlatHashMap;
+        friend class ConstIterator;
+
+        Iterator(const FlatHashMap *table, unsigned int idx)
+            : _table(table), _idx(idx) { }
+
+        /** Pointer to hash table being iterated */
+        const FlatHashMap *_table;
+
+        /** Current slot index; _table->_capacity when at end */
+        unsigned int _idx;
+    };
+
+    /**
+     * Returns a non-constant map iterator starting at the "first" element.
+     * Note that hash tables are not really ordered.
+     * O(capacity) worst-case
+     */
+    Iterator begin() const {
+        return Iterator(this, nextUsed(0));
+    }
+
+    /**
+     * Returns a non-constant map iterator just outside the map, reachable by an iterator
+     * that starts at begin()
+     * O(1)
+     */
+    Iterator end() const {
+        return Iterator(this, _capacity);
+    }
+
+    /**
+     * Returns an iterator to a the location of a key.
+     * If key not found, returns end().
+     */
+    Iterator find(const K &key) {
+        return Iterator(this, findSlot(key));
+    }
+
+    // //
+    // CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Does not allow any changes
+     */
+    class ConstIterator {
+    public:
+        ConstIterator() : _table(nullptr), _idx(0) {}
+
+        /** Converts an Iterator to a ConstIterator */
+        ConstIterator(const Iterator& it) : _table(it._table), _idx(it._idx) {}
+
+        /** O(1) amortized. */
+        void next() {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            _idx = _table->nextUsed(_idx + 1);
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._key;
+        }
+
+        /** O(1) */
+        const V &value() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._value;
+        }
+
+        /** O(1) */
+        bool operator==(const ConstIterator &other) const {
+            return _idx == other._idx;
+        }
+
+        /** O(1) */
+        bool operator!=(const ConstIterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        ConstIterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class FlatHashMap;
+
+        ConstIterator(const FlatHashMap *table, unsigned int idx)
+            : _table(table), _idx(idx) { }
+
+        /** Pointer to hash table being iterated */
+        const FlatHashMap *_table;
+
+        /** Current slot index; _table->_capacity when at end */
+        unsigned int _idx;
+    };
+
+    /**
+     * Returns a constant map iterator starting at the "first" element.
+     * Note that hash tables are not really ordered.
+     * O(capacity) worst-case
+     */
+    ConstIterator cbegin() const {
+        return ConstIterator(this, nextUsed(0));
+    }
+
+    /**
+     * Returns a constant map iterator just outside the map, reachable by an iterator
+     * that starts at cbegin()
+     * O(1)
+     */
+    ConstIterator cend() const {
+        return ConstIterator(this, _capacity);
+    }
+
+    /**
+     * Returns an iterator to a the location of a key.
+     * If key not found, returns cend().
+     */
+    ConstIterator find(const K &key) const {
+        return ConstIterator(this, findSlot(key));
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    friend std::ostream& operator<<(std::ostream& o, const FlatHashMap& t){
+        o<<"{";
+        t.show(o);
+        o<<"}";
+        return o;
+    }
+
+    /** Copy ctor. O(capacity) */
+    FlatHashMap(const FlatHashMap<K, V, Hash> &other) {
+        copy(other);
+    }
+
+    /** Assignment operator. O(capacity) */
+    FlatHashMap<K, V, Hash> &operator=(const FlatHashMap<K, V, Hash> &other) {
+        if (this != &other) {
+            free();
+            copy(other);
+        }
+        return *this;
+    }
+
+    /**
+     * Move ctor; takes over all slots, leaving other empty
+     * (sharing a single empty slot until it is next inserted into). O(1)
+     */
+    FlatHashMap(FlatHashMap<K, V, Hash> &&other) noexcept {
+        moveFrom(other);
+    }
+
+    /** Move assignment operator; frees current contents, and takes over those of other. O(capacity) */
+    FlatHashMap<K, V, Hash> &operator=(FlatHashMap<K, V, Hash> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+private:
+
+    /** Allocates an empty table with a given capacity (a power of 2) */
+    void init(unsigned int capacity) {
+        _slots = new Slot[capacity];
+        _capacity = capacity;
+        _mask = capacity - 1;
+        _shift = 64;
+        while (capacity > 1) {
+            capacity >>= 1;
+            _shift--;
+        }
+        _maxEntries = (unsigned int)(((std::uint64_t)_capacity * MAX_OCCUPATION) / 100);
+    }
+
+    /** Destroys all entries, and frees the slot array. */
+    void free() {
+        if (_slots != nullptr) {
+            for (unsigned int i = 0; i < _capacity; i++) {
+                if (_slots[i]._dist != 0) {
+                    _slots[i]._entry.~Entry();
+                }
+            }
+            if (_slots != emptySlots()) {
+                delete[] _slots;
+            }
+            _slots = nullptr;
+        }
+    }
+
+    /**
+     * Leaves this table without slots of its own: it shares emptySlots(), and
+     * allocates a real table on its next insertion (see grow()). O(1)
+     */
+    void initEmpty() noexcept {
+        _slots = emptySlots();
+        _capacity = 1;
+        _mask = 0;
+        _shift = 63; // home() is always 0; 64 would be an undefined shift
+        _maxEntries = 0;
+        _entryCount = 0;
+    }
+
+    /**
+     * Single slot shared by all tables in their moved-from state. Lookups read it,
+     * but it is never written: since their _maxEntries is 0, inserting grows first.
+     */
+    static Slot *emptySlots() noexcept {
+        static Slot empty;
+        return &empty;
+    }
+
+    /**
+     * Takes over the slots of other, leaving it empty, sharing emptySlots();
+     * allocates nothing, and so never throws.
+     * Before calling this, you should have freed any memory from this table
+     */
+    void moveFrom(FlatHashMap<K, V, Hash> &other) {
+        _slots = other._slots;
+        _hash = other._hash;
+        _capacity = other._capacity;
+        _mask = other._mask;
+        _shift = other._shift;
+        _maxEntries = other._maxEntries;
+        _entryCount = other._entryCount;
+        other.initEmpty();
+    }
+
+    /**
+     * Copies a table received as a parameter.
+     * Since capacity (and therefore home bins) are the same, entries
+     * keep their original positions.
+     * Before calling this, you should have freed any memory from this table
+     */
+    void copy(const FlatHashMap<K, V, Hash> &other) {
+        if (other._slots == emptySlots()) {
+            initEmpty();
+            return;
+        }
+        init(other._capacity);
+        _entryCount = other._entryCount;
+        for (unsigned int i = 0; i < _capacity; i++) {
+            if (other._slots[i]._dist != 0) {
+                new (&_slots[i]._entry) Entry(other._slots[i]._entry._key, other._slots[i]._entry._value);
+                _slots[i]._dist = other._slots[i]._dist;
+            }
+        }
+    }
+
+    /**
+     * Returns home bin of a key. Uses "Fibonacci hashing": multiplying
+     * by 2^64 / golden ratio and keeping the top bits mixes all bits of the
+     * hash into the index, so that identity hashes do not form long clusters.
+     */
+    unsigned int home(const K &key) const {
+        std::uint64_t h = (std::uint64_t)_hash(key);
+        return (unsigned int)((h * 11400714819323198485ull) >> _shift) & _mask;
+    }
+
+    /**
+     * Finds the slot holding a key. Returns _capacity if not found.
+     * Stops as soon as the entries found are closer to their home
+     * than the searched-for key would be.
+     * O(1) expected
+     */
+    unsigned int findSlot(const K &key) const {
+        unsigned int idx = home(key);
+        unsigned int dist = 1;
+        while (_slots[idx]._dist >= dist) {
+            if (_slots[idx]._entry._key == key) {
+                return idx;
+            }
+            idx = (idx + 1) & _mask;
+            dist++;
+        }
+        return _capacity;
+    }
+
+    /**
+     * Inserts a key which is known not to be in the table.
+     * Returns the slot where the new entry ended up.
+     * Throws, leaving the table as it was, if the entry cannot be built or
+     * the table cannot grow to fit it.
+     */
+    template <typename KK, typename VV>
+    unsigned int insertNew(KK &&key, VV &&value) {
+        if (_entryCount >= _maxEntries) {
+            grow();
+        }
+        unsigned int idx = home(key); // before key is moved into entry
+        Entry entry(std::forward<KK>(key), std::forward<VV>(value));
+        unsigned int slot = place(std::move(entry), idx, 1);
+        _entryCount++; // only once the entry is in
+        return slot;
+    }
+
+    /**
+     * Robin Hood placement, starting from slot idx at distance dist.
+     * Entries that are closer to their home than the one being placed are
+     * displaced, and placement continues with them.
+     * Returns the slot where the original entry was stored.
+     */
+    unsigned int place(Entry &&entry, unsigned int idx, unsigned int dist) {
+        unsigned int placed = _capacity;
+        Entry current(std::move(entry));
+        while (true) {
+            Slot &s = _slots[idx];
+            if (s._dist == 0) {
+                new (&s._entry) Entry(std::move(current));
+                s._dist = dist;
+                return (placed == _capacity) ? idx : placed;
+            } else if (s._dist < dist) {
+                std::swap(current, s._entry);
+                std::swap(dist, s._dist);
+                if (placed == _capacity) {
+                    placed = idx;
+                }
+            }
+            idx = (idx + 1) & _mask;
+            dist++;
+        }
+    }
+
+    /**
+     * Grows the table: doubles the number of slots, re-placing all entries
+     * (or, if moved-from, allocates an initial-size table).
+     * Throws if it already has MAX_CAPACITY slots: unlike chained tables, an
+     * open-addressing one cannot hold more entries than slots. O(n)
+     */
+    void grow() {
+        Slot *oldSlots = _slots;
+        unsigned int oldCapacity = _capacity;
+        if (oldSlots == emptySlots()) {
+            init(INITIAL_CAPACITY);
+            return;
+        }
+        if (oldCapacity == MAX_CAPACITY) {
+            throw InvalidAccessException("Too many entries for a FlatHashMap");
+        }
+        init(_capacity * 2);
+        for (unsigned int i = 0; i < oldCapacity; i++) {
+            if (oldSlots[i]._dist != 0) {
+                Entry &e = oldSlots[i]._entry;
+                place(std::move(e), home(e._key), 1);
+                e.~Entry();
+            }
+        }
+        delete[] oldSlots;
+    }
+
+    /** Returns index of first used slot at or after i; _capacity if none */
+    unsigned int nextUsed(unsigned int i) const {
+        while (i < _capacity && _slots[i]._dist == 0) {
+            i++;
+        }
+        return i;
+    }
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    void show(std::ostream &out) const {
+        bool first = true;
+        for (unsigned int i = 0; i < _capacity; i++) {
+            if (_slots[i]._dist != 0) {
+                out << (first ? "" : ", ");
+                first = false;
+                out << _slots[i]._entry._key << " -> " << _slots[i]._entry._value;
+            }
+        }
+    }
+
+    /**
+     * Max percentage full before triggering growth.
+     */
+    static const unsigned int MAX_OCCUPATION = 80;
+
+    /** Array of slots */
+    Slot *_slots;
+
+    /** Chosen hash function */
+    Hash _hash;
+
+    /** Number of slots in _slots (a power of 2) */
+    unsigned int _capacity;
+
+    /** _capacity - 1; used to wrap around */
+    unsigned int _mask;
+
+    /** 64 - log2(_capacity); used to select high bits in home() */
+    unsigned int _shift;
+
+    /** Number of entries that triggers growth on next insertion */
+    unsigned int _maxEntries;
+
+    /** Number of entries in the table */
+    unsigned int _entryCount;
+};
+
+#endif // __FLATHASHMAP_H
@@ -0,0 +1,305 @@
+/**
+ * Fork-join thread pool with work stealing, for divide-and-conquer algorithms
+ * Used by the parallel operations of BinTree.
+ */
+#ifndef __FORK_JOIN_H
+#define __FORK_JOIN_H
+
+#include "ArrayQueue.h"       // Per-worker task deques
+#include "ConcurrentQueue.h"  // concurrent_detail::CACHE_LINE_SIZE
+#include <atomic>
+#include <condition_variable>
+#include <exception>          // exception_ptr
+#include <functional>         // function
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Tuning for parallel operations.
+ *   - threads: number of threads to use, including the calling one;
+ *          0 (the default) uses one per hardware thread
+ *   - cutoff: inputs (subtrees, in the case of BinTree) with fewer elements
+ *          than this are processed sequentially, since splitting them up
+ *          would cost more than it saves
+ */
+struct ParallelOptions {
+    /** Default cutoff; large enough to hide the cost of a fork */
+    static const unsigned int DEFAULT_CUTOFF = 4096;
+
+    ParallelOptions(unsigned int threads = 0, unsigned int cutoff = DEFAULT_CUTOFF) :
+            threads(threads), cutoff(cutoff) {}
+
+    unsigned int threads;
+    unsigned int cutoff;
+};
+
+/**
+ * Pool of threads that run tasks forked from a single computation, started
+ * with run(). Tasks may fork other tasks, and wait for them with join().
+ *   - run(f): runs f in the calling thread, with the pool helping out
+ *          with any tasks that f (and its tasks) fork.
+ *   - fork(task): makes task available to other threads. O(1)
+ *   - join(task): waits until task has been run (by this thread, if no other
+ *          thread picked it up), rethrowing any exception it threw. While
+ *          waiting, runs other pending tasks.
+ *   - invoke(a, b): forks a, runs b, and joins a; the usual way to split
+ *          work in two.
+ *
+ * Each thread keeps its forked tasks in its own deque. It takes them back
+ * from the newest end, which holds the smallest and most recently-touched
+ * pieces of work; idle threads steal from the oldest end of someone else's
+ * deque, which holds the largest pieces. Since threads mostly use their own
+ * deque, locks are seldom contended.
+ *
+ * Workers that find nothing to run yield a few times, then sleep until a task
+ * is forked (or the pool is destroyed); so that a pool between (or during
+ * sequential stretches of) computations does not keep its cores busy.
+ */
+class ForkJoinPool {
+public:
+
+    /** A piece of work; must stay alive (and in place) until joined */
+    class Task {
+    public:
+        template <typename F>
+        explicit Task(F f) : _work(std::move(f)), _done(false) {}
+
+        Task(const Task &other) = delete;
+        Task &operator=(const Task &other) = delete;
+
+    private:
+        friend class ForkJoinPool;
+
+        std::function<void()> _work;
+        std::atomic<bool> _done;
+        std::exception_ptr _error;
+    };
+
+    /** Times an idle worker looks for tasks, yielding in between, before it sleeps */
+    static const unsigned int IDLE_SPINS = 64;
+
+    /** Starts threads - 1 workers (0 means one per hardware thread). */
+    explicit ForkJoinPool(unsigned int threads = 0) :
+            _workers(threadCount(threads)), _stop(false), _forks(0), _sleepers(0) {
+        // workers[0] is for whoever calls run()
+        for (unsigned int i = 1; i < _workers.size(); ++i) {
+            _threads.emplace_back([this, i]() { workLoop(&_workers[i]); });
+        }
+    }
+
+    /** Stops and joins all workers. */
+    ~ForkJoinPool() {
+        _stop.store(true, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _wakeUp.notify_all();
+        }
+        for (std::thread &thread : _threads) {
+            thread.join();
+        }
+    }
+
+    /** Number of threads to use, given a requested number (0 means one per hardware thread) */
+    static unsigned int threadCount(unsigned int threads) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        return (threads > 0) ? threads : 1;
+    }
+
+    /** Returns number of threads, including the one that calls run(). */
+    unsigned int threads() const {
+        return _workers.size();
+    }
+
+    /**
+     * Forking stops at this recursion depth in balanced divide-and-conquer: by
+     * then there are about 16 tasks per thread, enough to balance uneven ones.
+     */
+    unsigned int fork_depth() const {
+        unsigned int depth = 4;
+        for (unsigned int n = 1; n < _workers.size(); n *= 2) {
+            depth++;
+        }
+        return depth;
+    }
+
+    /** Runs f in the calling thread, as worker 0; f can fork and join tasks. */
+    template <typename F>
+    void run(F f) {
+        Worker *&current = currentWorker();
+        Worker *previous = current;
+        current = &_workers[0];
+        try {
+            f();
+        } catch (...) {
+            current = previous;
+            throw;
+        }
+        current = previous;
+    }
+
+    /** Makes task available to other threads; only from within run(). O(1) */
+    void fork(Task &task) {
+        Worker *self = currentWorker();
+        {
+            std::lock_guard<std::mutex> lock(self->_mutex);
+            self->_tasks.push_back(&task);
+        }
+        // after the push: a worker that saw the old count will see the task
+        _forks.fetch_add(1, std::memory_order_seq_cst);
+        if (_sleepers.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _wakeUp.notify_one();
+        }
+    }
+
+    /** Waits for task, running other tasks meanwhile; rethrows its exception, if any. */
+    void join(Task &task) {
+        wait(task);
+        if (task._error) {
+            std::rethrow_exception(task._error);
+        }
+    }
+
+    /**
+     * Runs a and b, maybe in parallel: a is forked, and b runs in this thread.
+     * Returns once both are done; if any threw, rethrows (b's exception, if both did).
+     * Only from within run().
+     */
+    template <typename A, typename B>
+    void invoke(A a, B b) {
+        Task task(std::move(a));
+        fork(task);
+        try {
+            b();
+        } catch (...) {
+            wait(task); // task refers to locals of callers; must finish before they unwind
+            throw;
+        }
+        join(task);
+    }
+
+    // pools own threads; they cannot be copied
+    ForkJoinPool(const ForkJoinPool &other) = delete;
+    ForkJoinPool &operator=(const ForkJoinPool &other) = delete;
+
+private:
+
+    /** A thread's deque of forked tasks; on its own cache line */
+    struct alignas(concurrent_detail::CACHE_LINE_SIZE) Worker {
+        std::mutex _mutex;
+        ArrayQueue<Task *> _tasks;
+    };
+
+    /** Worker of the calling thread; nullptr outside of pools */
+    static Worker *&currentWorker() {
+        static thread_local Worker *current = nullptr;
+        return current;
+    }
+
+    /** Waits for task to be done, running other tasks meanwhile */
+    void wait(Task &task) {
+        while ( ! task._done.load(std::memory_order_acquire)) {
+            Task *other = take(currentWorker());
+            if (other != nullptr) {
+                execute(*other);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /** Loop run by each thread other than the caller of run()  */
+    void workLoop(Worker *self) {
+        currentWorker() = self;
+        unsigned int idle = 0;
+        unsigned long forks = _forks.load(std::memory_order_seq_cst);
+        while ( ! _stop.load(std::memory_order_acquire)) {
+            Task *task = take(self);
+            if (task != nullptr) {
+                execute(*task);
+                idle = 0;
+            } else if (++idle < IDLE_SPINS) {
+                std::this_thread::yield();
+            } else {
+                sleep(forks);
+                idle = 0;
+            }
+            forks = _forks.load(std::memory_order_seq_cst); // before the next look for tasks
+        }
+    }
+
+    /**
+     * Sleeps until a task is forked or the pool stops, unless either happened
+     * since forks was read (before the last, failed, look for tasks).
+     * fork() bumps _forks and then reads _sleepers; this bumps _sleepers and
+     * then reads _forks. So either fork() sees a sleeper to wake, or this
+     * sees the new count; a fork is never missed.
+     */
+    void sleep(unsigned long forks) {
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        _wakeUp.wait(lock, [this, forks]() {
+            return _stop.load(std::memory_order_seq_cst)
+                || _forks.load(std::memory_order_seq_cst) != forks;
+        });
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /** Runs a task, recording any exception, and marks it as done */
+    static void execute(Task &task) {
+        try {
+            task._work();
+        } catch (...) {
+            task._error = std::current_exception();
+        }
+        task._done.store(true, std::memory_order_release);
+    }
+
+    /** Newest task of self or, failing that, oldest task of another worker; or nullptr */
+    Task *take(Worker *self) {
+        {
+            std::lock_guard<std::mutex> lock(self->_mutex);
+            if ( ! self->_tasks.empty()) {
+                Task *task = self->_tasks.back();
+                self->_tasks.pop_back();
+                return task;
+            }
+        }
+        unsigned int n = _workers.size();
+        unsigned int start = self - &_workers[0];
+        for (unsigned int i = 1; i < n; ++i) {
+            Worker &victim = _workers[(start + i) % n];
+            std::lock_guard<std::mutex> lock(victim._mutex);
+            if ( ! victim._tasks.empty()) {
+                Task *task = victim._tasks.front();
+                victim._tasks.pop_front();
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    /** Deques, one per thread; never resized once threads start */
+    std::vector<Worker> _workers;
+
+    /** All threads except the caller of run() */
+    std::vector<std::thread> _threads;
+
+    /** Set to stop workers */
+    std::atomic<bool> _stop;
+
+    /** Tasks forked so far; sleeping workers wake up when it changes */
+    std::atomic<unsigned long> _forks;
+
+    /** Workers that are (about to start) sleeping */
+    std::atomic<unsigned int> _sleepers;
+
+    /** Sleeping workers wait on _wakeUp, with _sleepMutex */
+    std::mutex _sleepMutex;
+    std::condition_variable _wakeUp;
+};
+
+#endif // __FORK_JOIN_H
@@ -9,6 +9,12 @@
 #define __HASH_H
 
 #include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>      // memcpy
+#include <tuple>
+#include <utility>      // pair, index_sequence
 
 // ----------------------------------------------------
 //
@@ -17,20 +23,130 @@
 // ----------------------------------------------------
 
 
-inline unsigned int myhash(unsigned int key) {
+inline std::uint64_t myhash(unsigned int key) {
     return key;
 }
 
-inline unsigned int myhash(int key) {
+inline std::uint64_t myhash(int key) {
     return (unsigned int)key;
 }
 
-inline unsigned int hash(char key) {
-    return key;
+inline std::uint64_t myhash(char key) {
+    return (unsigned char)key;
+}
+
+/**
+ * Wide-word hashing of byte strings, adapted from wyhash (final version 4,
+ * by Wang Yi; public domain). Reads 8 bytes at a time (48 per round for long
+ * inputs), and mixes them with 64x64 -> 128-bit multiplications. Results
+ * depend on byte order, so they should not be stored or sent between machines.
+ */
+namespace hash_detail {
+
+    inline constexpr std::uint64_t SECRET[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+    };
+
+    /** Full 128-bit product of a and b: low half into a, high half into b */
+    inline void mum(std::uint64_t &a, std::uint64_t &b) {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t r = (__uint128_t)a * b;
+        a = (std::uint64_t)r;
+        b = (std::uint64_t)(r >> 64);
+#else
+        std::uint64_t ha = a >> 32, hb = b >> 32, la = (std::uint32_t)a, lb = (std::uint32_t)b;
+        std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        std::uint64_t t = rl + (rm0 << 32);
+        std::uint64_t c = t < rl;
+        std::uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+    }
+
+    /** Mixes a and b, via the xor of both halves of their product */
+    inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    /** Unaligned reads; memcpy compiles down to single loads */
+    inline std::uint64_t read8(const unsigned char *p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline std::uint64_t read4(const unsigned char *p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    /** Reads 1 to 3 bytes: the 1st, the middle and the last one */
+    inline std::uint64_t read3(const unsigned char *p, std::size_t k) {
+        return (((std::uint64_t)p[0]) << 16) | (((std::uint64_t)p[k >> 1]) << 8) | p[k - 1];
+    }
+}
+
+/** Hashes len bytes starting at data. O(len), reading up to 48 bytes per step */
+inline std::uint64_t hash_bytes(const void *data, std::size_t len, std::uint64_t seed = 0) {
+    using namespace hash_detail;
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+    std::uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            // two overlapping pairs of 4-byte reads cover all lengths from 4 to 16
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+        if (i > 48) {
+            // 3 independent lanes, so that multiplications can overlap
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        // last 16 bytes, which may overlap those already read
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= SECRET[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
+
+/** Strings (and string literals, via string_view) are hashed without copying them. O(length) */
+inline std::uint64_t myhash(std::string_view key) {
+    return hash_bytes(key.data(), key.size());
 }
 
-// Fowler/Noll/Vo (FNV) -- adapted from http://bretmulvey.com/hash/6.html 
-inline unsigned int myhash(std::string key) {
+/**
+ * Fowler/Noll/Vo (FNV) -- adapted from http://bretmulvey.com/hash/6.html
+ * The previous string hash; reads one byte at a time. Kept for comparison.
+ */
+inline unsigned int fnv_hash(std::string_view key) {
     const unsigned int p = 16777619; // large prime
     unsigned int hash = 2166136261;  // initial value
     for (unsigned int i=0; i<key.size(); i++)
@@ -45,16 +161,87 @@ inline unsigned int myhash(std::string key) {
 }
 
 /**
- * Object-function to hash a given key type
+ * Finalizer: mixes all bits of a hash into all bits of the result, so that
+ * tables which only keep the low bits of a hash (as a bit-mask
+ * over a power-of-2 number of bins) do not cluster weak hashes
+ * such as the identity for ints. This is the splitmix64 finalizer
+ * (Stafford's "Mix13" variant of MurmurHash3's fmix64).
+ * Keys that used to fall into consecutive bins (such as sequential ints
+ * with the identity hash) are scattered too, and lose the locality they had.
+ */
+inline std::uint64_t mixhash(std::uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * Combines the hash of a field, h, into the hash of a compound key so far, seed.
+ * Order matters: combining (a, b) and (b, a) gives different results. For a struct,
+ *     inline std::uint64_t myhash(const Point &p) {
+ *         return hash_combine(myhash(p.x), myhash(p.y));
+ *     }
+ * makes Hash<Point> (and therefore HashMap<Point, V, Hash<Point>>) work.
+ */
+inline std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t h) {
+    return hash_detail::mix(seed ^ hash_detail::SECRET[0], h ^ hash_detail::SECRET[1]);
+}
+
+/**
+ * Object-function to hash a given key type, with the myhash() overload for that type.
+ * Usable as the Hash parameter of HashMap and the other hash-based ADTs.
  */
 template<class C>
 class Hash{
 public:
-    int operator()(const C& c)  const{
+    std::size_t operator()(const C& c)  const{
         return myhash(c);
     }
 
 };
 
+/**
+ * Strings are hashed as string_views. Transparent: hash-based ADTs using it can
+ * look up string_views and const char*s directly, without building a std::string.
+ */
+template<>
+class Hash<std::string>{
+public:
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view s)  const{
+        return myhash(s);
+    }
+};
+
+/** Pairs are hashed by combining the hashes of both members */
+template<class A, class B>
+class Hash<std::pair<A, B>>{
+public:
+    std::size_t operator()(const std::pair<A, B>& p)  const{
+        return hash_combine(Hash<A>()(p.first), Hash<B>()(p.second));
+    }
+};
+
+/** Tuples are hashed by combining the hashes of all members, in order */
+template<class... Ts>
+class Hash<std::tuple<Ts...>>{
+public:
+    std::size_t operator()(const std::tuple<Ts...>& t)  const{
+        return combine(t, std::index_sequence_for<Ts...>());
+    }
+
+private:
+    template <std::size_t... Is>
+    static std::uint64_t combine(const std::tuple<Ts...>& t, std::index_sequence<Is...>) {
+        std::uint64_t h = 0;
+        ((h = hash_combine(h, Hash<Ts>()(std::get<Is>(t)))), ...);
+        return h;
+    }
+};
+
 
 #endif // __HASH_H
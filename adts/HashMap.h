@@ -10,6 +10,10 @@
 
 #include <iostream>
 #include "Exceptions.h"
+#include "Hash.h"       // Used to mix hashes into bin indices
+#include "NodePool.h"   // Allocates nodes
+#include "Stats.h"      // Optional counters, see stats()
+#include <utility>      // move, forward, swap
 
 /**
  * Map using an open HashTable
@@ -17,16 +21,49 @@
  * Requires keys to support a hash function: a function that accepts a single
  *        argument of the key type, and which consistently returns the same unsigned int outputs
  *     for its inputs, and ideally spreads the output values to that collisions are rare.
+ *     Hashes are passed through mixhash() before use, so weak hash functions 
+ *     (such as the identity) are also fine.
  * Operations are:
  *    - HashMap constructor: generator
  *    - insert(key, value): generator, adds a new (key, value) pair to the tree.
  *          If the key was already present, replaces its value with the new one.
+ *          Keys and values passed as rvalues are moved instead of copied.
+ *    - try_emplace(key, args...): generator, adds key with a value built in place
+ *          from args, if the key was not already present. 
  *    - erase(key): mutator. Removes the key from the tree. No effect if key absent.
  *    - at(key): observer. Returns value that corresponds to a key. 
  *          Partial: key must exist; use contains() first if unsure.
  *    - contains(key): observer. Returnes true iff key exists in map
+ *    - contains_batch(keys, n, out), find_batch(keys, n, out): observers. Look up
+ *          n keys at once, overlapping their cache misses (see below).
  *    - empty(): observer. Returns true if no keys present.
  *    - size(): observer. Returns count of currently-contained keys.
+ *    - reserve(n), rehash(bins): mutators. Resize the table in advance, to avoid
+ *          repeated growth when the number of keys to insert is known.
+ *    - load_factor(), max_load_factor(): observers. Entries per bin, currently and
+ *          before the table grows; max_load_factor(f) sets the latter.
+ *    - incremental_rehash(b): mutator. When enabled, growth no longer moves all
+ *          entries at once (see below). Disabled by default.
+ *    - stats(): observer, only with ADT_STATS. Chain lengths, probes per lookup,
+ *          growth and allocations, as a HashMapStats (see Stats.h). O(n + bins)
+ *
+ * If Hash is transparent (has an is_transparent member type, as Hash<std::string>
+ * does), at, contains and find also accept any type that Hash can hash and that 
+ * compares with == to keys, such as std::string_view or const char* for std::string 
+ * keys. These look keys up as they are, without first building a K; both hashes 
+ * must agree for equal keys.
+ *
+ * Batched lookups process keys in groups of BATCH_SIZE: first they compute the bins
+ * of all keys in a group and prefetch them, then prefetch the first node of each of
+ * those bins, and only then compare keys. Each single lookup in a large table waits
+ * for 2 cache misses (bin, node); a group waits for about as long as one lookup does.
+ *
+ * In incremental-rehash mode, growing keeps the old bin array alongside the new one,
+ * and each mutating operation (insert, erase, operator[]) moves a few old bins
+ * (MIGRATION_STEP) to the new array. Lookups and iterators consult both arrays while
+ * this migration is in progress. This bounds the cost of any single operation, at the 
+ * price of slightly slower lookups while migrating. Note that in both modes, mutating
+ * operations may move entries between bins, and invalidate ongoing iterations.
  */
 template <typename K, typename V, typename Hash = std::hash<K>>
 class HashMap {
@@ -36,12 +73,10 @@ private:
      */
     class Node {
     public:
-        /* Ctors. */
-        Node(const K &key, const V &value) :
-                _key(key), _value(value), _next(nullptr) {};
-        
-        Node(const K &key, const V &value, Node *next) :
-                _key(key), _value(value), _next(next) {};
+        /** Ctor; the value is built from args */
+        template <typename KK, typename... Args>
+        Node(Node *next, KK &&key, Args&&... args) :
+                _key(std::forward<KK>(key)), _value(std::forward<Args>(args)...), _next(next) {};
 
         K _key;
         V _value;
@@ -50,13 +85,27 @@ private:
     
 public:
     
-    /** Initial table size (number of bins). */
+    /** Initial table size (number of bins). Must be a power of 2 */
     static const int INITIAL_BIN_COUNT = 8;    
+
+    /** Largest table size: the largest power of 2 that fits in an unsigned int */
+    static const unsigned int MAX_BIN_COUNT = 1u << 31;
+
+    /** Default max load factor (entries per bin) before triggering growth. */
+    static constexpr float DEFAULT_MAX_LOAD_FACTOR = 0.8f;
+
+    /** Old bins moved per mutating operation in incremental-rehash mode. */
+    static const unsigned int MIGRATION_STEP = 8;
+
+    /** Keys whose memory accesses are overlapped by batched lookups */
+    static const unsigned int BATCH_SIZE = 16;
     
     /** Constructor; returns an empty HashMap. O(1) */
-    HashMap() : _bins(new Node*[INITIAL_BIN_COUNT]), _binCount(INITIAL_BIN_COUNT), _entryCount(0) {
-        for (unsigned int i=0; i < _binCount; ++i)
-            _bins[i] = nullptr;
+    HashMap() : _bins(nullptr), _binCount(INITIAL_BIN_COUNT), _entryCount(0),
+            _maxLoadFactor(DEFAULT_MAX_LOAD_FACTOR), 
+            _oldBins(nullptr), _oldBinCount(0), _migrated(0), _incremental(false) {
+        _bins = newBins(_binCount); // in the body: stats counters are built after _bins
+        updateMaxEntries();
     }
     
     /** Destructor; frees nodes in O(n) */
@@ -71,22 +120,50 @@ public:
      * generator, O(1) amortized cost. 
      */
     void insert(const K &key, const V &value) {        
-        // If occupation very high, grow table
-        float occupation = 100 * ((float) _entryCount) / _binCount;
-        if (occupation > MAX_OCCUPATION) {            
-            grow();
-        }
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
+        migrateStep();
+        // Look for key in its bin
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
         if (n != nullptr) { // key exists in bin: overwrite value
             n->_value = value;
         } else { // new key: insert new node
-            _bins[idx] = new Node(key, value, _bins[idx]);
-            _entryCount++;
+            insertNew(key, value);
+        }
+    }
+
+    /** 
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(1) amortized cost. 
+     */
+    void insert(K &&key, V &&value) {        
+        migrateStep();
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
+        if (n != nullptr) { // key exists in bin: overwrite value
+            n->_value = std::move(value);
+        } else { // new key: insert new node
+            insertNew(std::move(key), std::move(value));
         }
     }
+
+    /** 
+     * If key is not present, adds it, with a value built in place from args.
+     * No effect (and args not used) if key already present.
+     * Returns true IFF the key was added.
+     * generator, O(1) amortized cost. 
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        return tryEmplaceAux(key, std::forward<Args>(args)...);
+    }
+
+    /** Same as try_emplace(key, args...), but moves key if added. */
+    template <typename... Args>
+    bool try_emplace(K &&key, Args&&... args) {
+        return tryEmplaceAux(std::move(key), std::forward<Args>(args)...);
+    }
     
     /**
      * Removes a key, value pair from the map. 
@@ -94,10 +171,15 @@ public:
      * mutator, O(1)
      */
     void erase(const K &key) {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
+        migrateStep();
+        // Locate bin (in old or new bins, if migrating)
+        Node **bins;
+        unsigned int idx;
+        if (locate(key, bins, idx) == nullptr) {
+            return;
+        }
         // Find node with key; and if present, also previous node
-        Node *n = _bins[idx];
+        Node *n = bins[idx];
         Node *prev = nullptr;
         findWithPrevious(key, n, prev);
         if (n != nullptr) { // found!
@@ -105,10 +187,10 @@ public:
             if (prev != nullptr) {
                 prev->_next = n->_next;
             } else {
-                _bins[idx] = n->_next;
+                bins[idx] = n->_next;
             }
             // And now, delete it
-            delete n;
+            _pool.destroy(n);
             _entryCount--;
         }        
     }
@@ -119,14 +201,13 @@ public:
      * observer, O(1)
      */
     const V &at(const K &key) const {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
-        if (n == nullptr) {
-            throw BadKeyException();            
-        }
-        return n->_value;
+        return atAux(key);
+    }
+
+    /** Same as at(key), for other key types; only if Hash is transparent. O(1) */
+    template <typename KK, typename H = Hash, typename = typename H::is_transparent>
+    const V &at(const KK &key) const {
+        return atAux(key);
     }
     
     /** 
@@ -134,11 +215,31 @@ public:
      * observer, O(1)
      */
     bool contains(const K &key) const {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
-        return n != nullptr;
+        return containsAux(key);
+    }
+
+    /** Same as contains(key), for other key types; only if Hash is transparent. O(1) */
+    template <typename KK, typename H = Hash, typename = typename H::is_transparent>
+    bool contains(const KK &key) const {
+        return containsAux(key);
+    }
+
+    /**
+     * Looks up n keys; out[i] becomes true IFF keys[i] is in the map.
+     * Same results as n calls to contains(), but with their memory accesses overlapped.
+     * observer, O(n)
+     */
+    void contains_batch(const K *keys, unsigned int n, bool *out) const {
+        Node *found[BATCH_SIZE];
+        Node **bins[BATCH_SIZE];
+        unsigned int idx[BATCH_SIZE];
+        for (unsigned int i = 0; i < n; i += BATCH_SIZE) {
+            unsigned int m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+            locateBatch(keys + i, m, found, bins, idx);
+            for (unsigned int j = 0; j < m; j++) {
+                out[i + j] = found[j] != nullptr;
+            }
+        }
     }
     
     /** 
@@ -156,25 +257,122 @@ public:
     int size() const {
         return _entryCount;
     }
+
+    /** 
+     * Returns number of bins in the table. 
+     * observer, O(1) 
+     */
+    unsigned int bin_count() const {
+        return _binCount;
+    }
+
+    /** 
+     * Returns current load factor: average number of entries per bin.
+     * observer, O(1) 
+     */
+    float load_factor() const {
+        return ((float) _entryCount) / _binCount;
+    }
+
+    /** 
+     * Returns max load factor: the table grows when an insertion would exceed it.
+     * observer, O(1) 
+     */
+    float max_load_factor() const {
+        return _maxLoadFactor;
+    }
+
+    /** 
+     * Changes max load factor. Grows the table right away if the current 
+     * load factor is already above the new max. Must be at least
+     * 1 / INITIAL_BIN_COUNT, so that even the smallest table has room for an entry.
+     * mutator, O(1), or O(n) if the table has to grow
+     */
+    void max_load_factor(float f) {
+        if ( ! (f * INITIAL_BIN_COUNT >= 1)) {
+            throw InvalidAccessException("Max load factor must be at least 1 / INITIAL_BIN_COUNT");
+        }
+        _maxLoadFactor = f;
+        updateMaxEntries();
+        rehash(_binCount);
+    }
+
+    /** 
+     * Sets the number of bins to at least the given count (rounded up to a 
+     * power of 2), and at least enough to hold all current entries without
+     * exceeding the max load factor. Can both grow and shrink the table.  
+     * Throws if that would take more than MAX_BIN_COUNT bins.
+     * mutator, O(n + bins)
+     */
+    void rehash(unsigned int bins) {
+        unsigned int needed = binCountFor(bins, _entryCount);
+        if (needed != _binCount) {
+            resize(needed);
+        }
+    }
+
+    /** 
+     * Makes room for at least n entries, so that no growth will be triggered 
+     * until more than n entries are present. Never shrinks the table.
+     * Does not use incremental rehashing, even if enabled. 
+     * Throws if that would take more than MAX_BIN_COUNT bins.
+     * mutator, O(n + bins)
+     */
+    void reserve(unsigned int n) {
+        unsigned int needed = binCountFor(_binCount, n);
+        if (needed != _binCount) {
+            resize(needed);
+        }
+    }
     
     /**
      * Overloads the [] operator, to access (and possibly modify) a value given its key.
      * If the key is not present, inserts a new (default) value for that key.
      */
     V &operator[](const K &key) {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
+        migrateStep();
+        // Look for key in its bin
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
         if (n == nullptr) { // Not there, must add
-            insert(key, V());
-            // NOTE: idx may have changed due to growth!
-            idx = _hash(key) % _binCount;
-            n = findNode(key, _bins[idx]);
+            n = insertNew(key); // default value
         }        
         return n->_value;
     }
 
+    /** Same as operator[](key), but moves key if it must be added. */
+    V &operator[](K &&key) {
+        migrateStep();
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
+        if (n == nullptr) { // Not there, must add
+            n = insertNew(std::move(key)); // default value
+        }        
+        return n->_value;
+    }
+
+    /** 
+     * Enables or disables incremental rehashing. Disabling it
+     * finishes any migration in progress.
+     * mutator, O(1), or O(n) if a migration must be finished
+     */
+    void incremental_rehash(bool enabled) {
+        _incremental = enabled;
+        if ( ! enabled) {
+            finishMigration();
+        }
+    }
+
+    /** 
+     * Returns true IFF incremental rehashing is enabled.
+     * observer, O(1)
+     */
+    bool incremental_rehash() const {
+        return _incremental;
+    }
+
     // //
     // NON-CONSTANT ITERATOR
     // //
@@ -196,9 +394,9 @@ public:
             // return next node in current bin
             _current = _current->_next;
             // if bin exhausted, return 1st node in next non-empty bin
-            while ((_current == nullptr) && (_idx < _table->_binCount - 1)) {
+            while ((_current == nullptr) && (_idx < _table->totalBinCount() - 1)) {
                 ++_idx;
-                _current = _table->_bins[_idx];
+                _current = _table->binAt(_idx);
             }
         }
 
@@ -253,7 +451,7 @@ public:
         /** Pointer to current node in current bin */
         Node* _current;
 
-        /** Current bin index */
+        /** Current bin index; old bins, if any, come before current ones */
         unsigned int _idx;
     };
 
@@ -264,10 +462,10 @@ public:
      */
     Iterator begin() const {
         unsigned int idx = 0;
-        Node *n = _bins[0];
-        while (idx < _binCount - 1 && n == nullptr) {
+        Node *n = binAt(0);
+        while (idx < totalBinCount() - 1 && n == nullptr) {
             idx++;
-            n = _bins[idx];
+            n = binAt(idx);
         }
         return Iterator(this, n, idx);
     }
@@ -286,11 +484,22 @@ public:
      * If key not found, returns end().
      */
     Iterator find(const K &key) {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
-        return Iterator(this, n, idx); // if nullptr, returns end()
+        return findAux<Iterator>(key);
+    }
+
+    /** Same as find(key), for other key types; only if Hash is transparent. O(1) */
+    template <typename KK, typename H = Hash, typename = typename H::is_transparent>
+    Iterator find(const KK &key) {
+        return findAux<Iterator>(key);
+    }
+
+    /**
+     * Looks up n keys; out[i] becomes find(keys[i]), which is end() if not found.
+     * Same results as n calls to find(), but with their memory accesses overlapped.
+     * O(n)
+     */
+    void find_batch(const K *keys, unsigned int n, Iterator *out) {
+        findBatchAux(keys, n, out);
     }
 
     
@@ -322,9 +531,9 @@ public:
             // return next node in current bin
             _current = _current->_next;
             // if bin exhausted, return 1st node in next non-empty bin
-            while ((_current == nullptr) && (_idx < _table->_binCount - 1)) {
+            while ((_current == nullptr) && (_idx < _table->totalBinCount() - 1)) {
                 ++_idx;
-                _current = _table->_bins[_idx];
+                _current = _table->binAt(_idx);
             }
         }
         
@@ -379,7 +588,7 @@ public:
         /** Pointer to current node in current bin */
         Node* _current;
 
-        /** Current bin index */
+        /** Current bin index; old bins, if any, come before current ones */
         unsigned int _idx;
     };
     
@@ -390,10 +599,10 @@ public:
      */
     ConstIterator cbegin() const {
         unsigned int idx = 0;
-        Node *n = _bins[0];
-        while (idx < _binCount - 1 && n == nullptr) {
+        Node *n = binAt(0);
+        while (idx < totalBinCount() - 1 && n == nullptr) {
             idx++;
-            n = _bins[idx];
+            n = binAt(idx);
         }
         return ConstIterator(this, n, idx);
     }
@@ -412,11 +621,18 @@ public:
      * If key not found, returns cend().
      */
     ConstIterator find(const K &key) const {
-        // Locate bin index
-        unsigned int idx = _hash(key) % _binCount;
-        // Look for key in bin
-        Node *n = findNode(key, _bins[idx]);
-        return ConstIterator(this, n, idx); // if nullptr, returns cend()
+        return findAux<ConstIterator>(key);
+    }
+
+    /** Same as find(key), for other key types; only if Hash is transparent. O(1) */
+    template <typename KK, typename H = Hash, typename = typename H::is_transparent>
+    ConstIterator find(const KK &key) const {
+        return findAux<ConstIterator>(key);
+    }
+
+    /** Constant version of find_batch(). O(n) */
+    void find_batch(const K *keys, unsigned int n, ConstIterator *out) const {
+        findBatchAux(keys, n, out);
     }
 
     
@@ -448,64 +664,266 @@ public:
         }
         return *this;
     }
+
+    /** 
+     * Move ctor; takes over all bins and nodes, leaving other empty 
+     * (sharing a single empty bin until it is next inserted into). O(1) 
+     */
+    HashMap(HashMap<K, V, Hash> &&other) noexcept {
+        moveFrom(other);
+    }
+    
+    /** Move assignment operator; frees current contents, and takes over those of other. O(n) */
+    HashMap<K, V, Hash> &operator=(HashMap<K, V, Hash> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
     
 private:
     
-    /** Frees all memory allocated in this table. */
+    /** 
+     * Frees all memory allocated in this table. Nodes only need to be visited 
+     * if they have destructors to run; otherwise, the whole pool is released in one go.
+     */
     void free() {
         // Frees all node lists
-        for (unsigned int i=0; i < _binCount; i++) {
-            freeNodes(_bins[i]);
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            for (unsigned int i=0; i < _binCount; i++) {
+                freeNodes(_bins[i]);
+            }
+            for (unsigned int i=_migrated; i < _oldBinCount; i++) {
+                freeNodes(_oldBins[i]);
+            }
         }
+        _pool.clear();
         // Frees the array of pointers to nodes.
-        if (_bins != nullptr) {
+        if (_bins != nullptr && _bins != emptyBins()) {
             delete[] _bins;
             _bins = nullptr;
         }
+        // Same for old bins, if a migration was in progress
+        if (_oldBins != nullptr) {
+            delete[] _oldBins;
+            _oldBins = nullptr;
+        }
     }
     
     /** Frees nodes in a linked list. O(n), where n is length of list */
-    static void freeNodes(Node *n) {
+    void freeNodes(Node *n) {
         while (n != nullptr) {
             Node *aux = n;
             n = n->_next;
-            delete aux;
+            _pool.destroy(aux);
         }       
     }
     
     /**
-     * Copies a table received as a parameter.
+     * Takes over the bins and nodes of other, leaving it empty, sharing
+     * emptyBins(); allocates nothing, and so never throws.
+     * Before calling this, you should have freed any memory from this table
+     */
+    void moveFrom(HashMap<K, V, Hash> &other) {
+        _bins = other._bins;
+        _hash = other._hash;
+        _binCount = other._binCount;
+        _entryCount = other._entryCount;
+        _maxLoadFactor = other._maxLoadFactor;
+        _maxEntries = other._maxEntries;
+        _oldBins = other._oldBins;
+        _oldBinCount = other._oldBinCount;
+        _migrated = other._migrated;
+        _incremental = other._incremental;
+        _pool.swap(other._pool);
+        other.initEmpty();
+    }
+
+    /**
+     * Leaves this table without bins of its own: it shares emptyBins(), and
+     * allocates real ones on its next insertion (see grow()).
+     * Any nodes or bins it had must have been freed or taken over. O(1)
+     */
+    void initEmpty() noexcept {
+        _bins = emptyBins();
+        _binCount = 1;
+        _entryCount = 0;
+        _oldBins = nullptr;
+        _oldBinCount = 0;
+        _migrated = 0;
+        _maxEntries = 0;
+    }
+
+    /** 
+     * Single bin shared by all tables in their moved-from state. Lookups read it,
+     * but it is never written: since their _maxEntries is 0, inserting grows first.
+     */
+    static Node **emptyBins() noexcept {
+        static Node *empty[1] = { nullptr };
+        return empty;
+    }
+
+    /**
+     * Copies a table received as a parameter. If other was migrating, 
+     * the copy places all nodes in their final bins.
      * Before calling this, you should have freed any memory from this table
      */
     void copy(const HashMap<K, V, Hash> &other) {
+        if (other._bins == emptyBins()) {
+            _maxLoadFactor = other._maxLoadFactor;
+            _incremental = other._incremental;
+            initEmpty();
+            return;
+        }
         _binCount = other._binCount;
         _entryCount = other._entryCount;
+        _maxLoadFactor = other._maxLoadFactor;
+        _maxEntries = other._maxEntries;
+        _incremental = other._incremental;
+        _oldBins = nullptr;
+        _oldBinCount = 0;
+        _migrated = 0;
         // Allocate bin array
-        _bins = new Node*[_binCount];
-        for (unsigned int i=0; i < _binCount; ++i) {
-            _bins[i] = nullptr;
-            // Copy node bin; reverses bin order, but this is generally not visible
-            Node *n = other._bins[i];
-            while (n != nullptr) {
-                _bins[i] = new Node(n->_key, n->_value, _bins[i]);
-                n = n->_next;
+        _bins = newBins(_binCount);
+        if (other._oldBins == nullptr) {
+            for (unsigned int i=0; i < _binCount; ++i) {
+                // Copy node bin; reverses bin order, but this is generally not visible
+                Node *n = other._bins[i];
+                while (n != nullptr) {
+                    _bins[i] = _pool.create(_bins[i], n->_key, n->_value);
+                    n = n->_next;
+                }
+            }
+        } else {
+            // Nodes may be in either array; all go to their (final) bin
+            for (unsigned int i=0; i < other.totalBinCount(); ++i) {
+                Node *n = other.binAt(i);
+                while (n != nullptr) {
+                    unsigned int idx = binIndex(n->_key);
+                    _bins[idx] = _pool.create(_bins[idx], n->_key, n->_value);
+                    n = n->_next;
+                }
             }
         }
     }
+
+    /**
+     * Inserts a key which is known to not be present, growing if necessary.
+     * Its value is built in place from args (default-constructed if none). 
+     * Returns the new node.
+     */
+    template <typename KK, typename... Args>
+    Node *insertNew(KK &&key, Args&&... args) {
+        // If occupation very high, grow table
+        if (_entryCount >= _maxEntries) {            
+            grow();
+        }
+        unsigned int idx = binIndex(key); // before key is moved into node
+        _bins[idx] = _pool.create(_bins[idx], std::forward<KK>(key), std::forward<Args>(args)...);
+        _entryCount++;
+        return _bins[idx];
+    }
+
+    /** Implements both try_emplace() variants */
+    template <typename KK, typename... Args>
+    bool tryEmplaceAux(KK &&key, Args&&... args) {
+        migrateStep();
+        Node **bins;
+        unsigned int idx;
+        if (locate(key, bins, idx) != nullptr) {
+            return false;
+        }
+        insertNew(std::forward<KK>(key), std::forward<Args>(args)...);
+        return true;
+    }
     
     /** 
-     * Grows the table: doubles the number of bins. O(n) 
+     * Grows the table: doubles the number of bins. 
+     * O(n), or O(bins) to allocate the new bins in incremental-rehash mode.
      */
     void grow() {
+        if (_binCount == MAX_BIN_COUNT) {
+            // cannot double again: stop growing, and let bins get longer
+            _maxEntries = ~0u;
+            return;
+        }
+        if (_bins == emptyBins()) {
+            // moved-from: gets a table of its own, of the initial size
+            _bins = newBins(INITIAL_BIN_COUNT);
+            _binCount = INITIAL_BIN_COUNT;
+            updateMaxEntries();
+            return;
+        }
+        ADT_STAT(auto start = std::chrono::steady_clock::now());
+        if ( ! _incremental) {
+            resize(_binCount * 2);
+        } else {
+            // Migration should be long finished; but if not, finish it now 
+            finishMigration();
+            _oldBins = _bins;
+            _oldBinCount = _binCount;
+            _migrated = 0;
+            _binCount *= 2;
+            _bins = newBins(_binCount);
+            updateMaxEntries();
+        }
+        ADT_STAT(_grows.add(); _growNanos.add(stat_nanos_since(start)));
+    }
+
+    /** 
+     * If migrating, moves up to MIGRATION_STEP old bins to the current bins. 
+     * Frees old bins once they are all empty.
+     * O(1) amortized 
+     */
+    void migrateStep() {
+        if (_oldBins == nullptr) {
+            return;
+        }
+        unsigned int end = _migrated + MIGRATION_STEP;
+        if (end > _oldBinCount) {
+            end = _oldBinCount;
+        }
+        for (/**/; _migrated < end; ++_migrated) {
+            Node *n = _oldBins[_migrated];
+            _oldBins[_migrated] = nullptr;
+            while (n != nullptr) {
+                Node *aux = n;
+                n = n->_next;
+                unsigned int idx = binIndex(aux->_key); // new index
+                aux->_next = _bins[idx];
+                _bins[idx] = aux;
+            }
+        }
+        if (_migrated == _oldBinCount) {
+            delete[] _oldBins;
+            _oldBins = nullptr;
+            _oldBinCount = 0;
+            _migrated = 0;
+        }
+    }
+
+    /** 
+     * Finishes any migration in progress. O(n)
+     */
+    void finishMigration() {
+        while (_oldBins != nullptr) {
+            migrateStep();
+        }
+    }
+
+    /** 
+     * Moves all nodes to a new array of bins. O(n + newBinCount)
+     * newBinCount must be a power of 2.
+     */
+    void resize(unsigned int newBinCount) {
+        finishMigration();
         // Keep a pointer to the old bins, and also keep a copy of their size.
         Node **oldBins = _bins;
         unsigned int oldBinCount = _binCount;
-        // Allocate a new bin array, of double the size
-        _binCount *= 2;
-        _bins = new Node*[_binCount];
-        for (unsigned int i=0; i < _binCount; ++i) {
-            _bins[i] = nullptr;
-        }
+        // Allocate a new bin array, of the new size
+        _binCount = newBinCount;
+        _bins = newBins(_binCount);
         
         // Iterate the original array
         for (unsigned int i=0; i<oldBinCount; ++i) {
@@ -516,21 +934,185 @@ private:
             while (n != nullptr) {
                 Node *aux = n;
                 n = n->_next;
-                unsigned int idx = _hash(aux->_key) % _binCount; // new index
+                unsigned int idx = binIndex(aux->_key); // new index
                 aux->_next = _bins[idx];
                 _bins[idx] = aux;
             }
         }
         // Borramos el array antiguo (ya no contiene ningún nodo).
-        delete[] oldBins;
+        if (oldBins != emptyBins()) {
+            delete[] oldBins;
+        }
+        updateMaxEntries();
+    }
+
+    /** 
+     * Recomputes the entry count that triggers growth, so that each insertion only 
+     * needs to compare two integers. O(1)
+     */
+    void updateMaxEntries() {
+        if (_bins == emptyBins()) {
+            _maxEntries = 0; // so that the shared bin is never inserted into
+            return;
+        }
+        double max = (double)_binCount * _maxLoadFactor;
+        _maxEntries = (max < ~0u) ? (unsigned int)max : ~0u;
+    }
+
+    /**
+     * Smallest power-of-2 bin count, at least INITIAL_BIN_COUNT, that is >= bins and
+     * holds entries without exceeding the max load factor. Throws if that would
+     * take more than MAX_BIN_COUNT bins. O(log bins)
+     */
+    unsigned int binCountFor(unsigned int bins, unsigned int entries) const {
+        unsigned int needed = INITIAL_BIN_COUNT;
+        while (needed < bins || (double)needed * _maxLoadFactor < entries) {
+            if (needed == MAX_BIN_COUNT) {
+                throw InvalidAccessException("Too many bins for a HashMap");
+            }
+            needed *= 2;
+        }
+        return needed;
     }
     
+    /**
+     * Returns bin index for a key. Since _binCount is always a power of 2,
+     * a bit-mask replaces the (much slower) modulo operation; mixhash() ensures
+     * that all bits of the hash affect the result.
+     * O(1)
+     */
+    unsigned int binIndex(const K &key) const {
+        return (unsigned int)(mixhash(_hash(key)) & (_binCount - 1));
+    }
+
+    /** Value of key (a K, or anything comparable to one); throws if absent. O(1) */
+    template <typename KK>
+    const V &atAux(const KK &key) const {
+        // Look for key in its bin
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
+        if (n == nullptr) {
+            throw BadKeyException();            
+        }
+        return n->_value;
+    }
+
+    template <typename KK>
+    bool containsAux(const KK &key) const {
+        // Look for key in its bin
+        Node **bins;
+        unsigned int idx;
+        return locate(key, bins, idx) != nullptr;
+    }
+
+    /** Iterator (an Iterator or a ConstIterator) at key; at the end if absent. O(1) */
+    template <typename It, typename KK>
+    It findAux(const KK &key) const {
+        // Look for key in its bin
+        Node **bins;
+        unsigned int idx;
+        Node *n = locate(key, bins, idx);
+        return It(this, n, iterationIndex(bins, idx)); // if nullptr, returns end()
+    }
+
+    /** Implements both find_batch() variants; It is an Iterator or a ConstIterator */
+    template <typename It>
+    void findBatchAux(const K *keys, unsigned int n, It *out) const {
+        Node *found[BATCH_SIZE];
+        Node **bins[BATCH_SIZE];
+        unsigned int idx[BATCH_SIZE];
+        for (unsigned int i = 0; i < n; i += BATCH_SIZE) {
+            unsigned int m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+            locateBatch(keys + i, m, found, bins, idx);
+            for (unsigned int j = 0; j < m; j++) {
+                out[i + j] = It(this, found[j], iterationIndex(bins[j], idx[j]));
+            }
+        }
+    }
+
+    /**
+     * Same as calling locate() for each of the m <= BATCH_SIZE keys, storing its
+     * results in found[j], bins[j] and idx[j]. Loads are issued in stages (all bins,
+     * then the first node of each bin, then the rest) so that their misses overlap.
+     * If migrating, keys not found in the current bins are looked up with locate().
+     * O(m)
+     */
+    void locateBatch(const K *keys, unsigned int m, Node **found, Node **bins[], unsigned int *idx) const {
+        for (unsigned int j = 0; j < m; j++) {
+            idx[j] = (unsigned int)(mixhash(_hash(keys[j])) & (_binCount - 1));
+            prefetch(_bins + idx[j]);
+        }
+        for (unsigned int j = 0; j < m; j++) {
+            found[j] = _bins[idx[j]];
+            if (found[j] != nullptr) {
+                prefetch(found[j]);
+            }
+        }
+        for (unsigned int j = 0; j < m; j++) {
+            bins[j] = _bins;
+            found[j] = findNode(keys[j], found[j]);
+            if (found[j] == nullptr && _oldBins != nullptr) {
+                found[j] = locate(keys[j], bins[j], idx[j]);
+            }
+        }
+    }
+
+    /**
+     * Finds the node for a key, returning nullptr if not found.
+     * Also returns the bin array (current or, if migrating, old) 
+     * and index within that array where it was found; when not found, 
+     * these point to where it should be inserted.
+     * O(1)
+     */
+    template <typename KK>
+    Node *locate(const KK &key, Node **&bins, unsigned int &idx) const {
+        std::uint64_t h = mixhash(_hash(key));
+        bins = _bins;
+        idx = (unsigned int)(h & (_binCount - 1));
+        Node *n = findNode(key, _bins[idx]);
+        if (n == nullptr && _oldBins != nullptr) {
+            // old bins before _migrated are already empty
+            unsigned int oldIdx = (unsigned int)(h & (_oldBinCount - 1));
+            if (oldIdx >= _migrated) {
+                n = findNode(key, _oldBins[oldIdx]);
+                if (n != nullptr) {
+                    bins = _oldBins;
+                    idx = oldIdx;
+                }
+            }
+        }
+        return n;
+    }
+
+    /** 
+     * Number of bins visited by iterators: old (if migrating) + current. O(1)
+     */
+    unsigned int totalBinCount() const {
+        return _oldBinCount + _binCount;
+    }
+
+    /** 
+     * Returns i-th bin in iteration order: old bins (if migrating), then current ones. O(1)
+     */
+    Node *binAt(unsigned int i) const {
+        return (i < _oldBinCount) ? _oldBins[i] : _bins[i - _oldBinCount];
+    }
+
+    /** 
+     * Converts a bin array + index, as returned by locate(), into the index used by binAt(). O(1)
+     */
+    unsigned int iterationIndex(Node **bins, unsigned int idx) const {
+        return (bins == _oldBins) ? idx : _oldBinCount + idx;
+    }
+
     /**
      * Finds a node in a linked list. If found, will store in current, and parent in 
      * prev. If not, current will be set to nullptr.
      * O(k), where k is the length of the linked list
      */
-    static void findWithPrevious(const K &key, Node* &current, Node* &prev) {
+    template <typename KK>
+    static void findWithPrevious(const KK &key, Node* &current, Node* &prev) {
         prev = nullptr;
         bool found = false;
         while ((current != nullptr) && !found) {
@@ -546,23 +1128,40 @@ private:
     
     /**
      * Finds a node in a linked list. If found, returns it. Otherwise, returns nullptr.
+     * All lookups go through here, and are counted in stats mode.
      * O(k), where k is the length of the linked list
      */
-    static Node* findNode(const K &key, Node* n) {
-        Node *current = n;
-        Node *next = nullptr;
-        findWithPrevious(key, current, next);
-        return current;
+    template <typename KK>
+    Node* findNode(const KK &key, Node* n) const {
+        ADT_STAT(_lookups.add());
+        while (n != nullptr) {
+            ADT_STAT(_probes.add());
+            if (n->_key == key) {
+                return n;
+            }
+            n = n->_next;
+        }
+        return nullptr;
+    }
+
+    /** Allocates an array of count empty bins. O(count) */
+    Node **newBins(unsigned int count) {
+        Node **bins = new Node*[count];
+        for (unsigned int i=0; i < count; ++i) {
+            bins[i] = nullptr;
+        }
+        ADT_STAT(_binAllocs.add(); _binBytes.add(count * sizeof(Node*)));
+        return bins;
     }
 
     /** 
      * Pretty-printing of map. Only for debugging. 
      * observer, O(n)
      */    
-    void muestra(std::ostream &out) const {
+    void show(std::ostream &out) const {
         bool first = true;
-        for (int i = 0; i < _binCount; i++) {
-            Node *n = _bins[i];
+        for (unsigned int i = 0; i < totalBinCount(); i++) {
+            Node *n = binAt(i);
             while(n != nullptr){ // if bin not empty, iterates contents
                 out << (first ? "" : ", ");
                 first = false;
@@ -573,11 +1172,6 @@ private:
     }
 
     
-    /**
-     * Max percentage full before triggering growth.
-     */
-    static const unsigned int MAX_OCCUPATION = 80;
-
     /** Array of node pointers / bins */
     Node **_bins;
 
@@ -589,6 +1183,68 @@ private:
 
     /** Number of entries in the table */
     unsigned int _entryCount;
+
+    /** Max load factor (entries per bin) before growing */
+    float _maxLoadFactor;
+
+    /** Entry count that will trigger growth on next insert: _binCount * _maxLoadFactor */
+    unsigned int _maxEntries;
+
+    /** Bins being migrated, in incremental-rehash mode; nullptr if not migrating */
+    Node **_oldBins;
+
+    /** Number of bins in _oldBins; 0 if not migrating */
+    unsigned int _oldBinCount;
+
+    /** Old bins below this index have already been migrated (and are empty) */
+    unsigned int _migrated;
+
+    /** True IFF incremental-rehash mode is enabled */
+    bool _incremental;
+
+    /** Allocator for all nodes in this table */
+    NodePool<Node> _pool;
+
+#ifdef ADT_STATS
+    /** Bins searched by lookups, and keys compared while doing so */
+    mutable StatCounter _lookups, _probes;
+
+    /** Calls to grow(), and time spent in them */
+    StatCounter _grows, _growNanos;
+
+    /** Bin arrays allocated, and their total size in bytes */
+    StatCounter _binAllocs, _binBytes;
+
+public:
+
+    /**
+     * Snapshot of stats counters, plus a histogram of chain lengths (old bins
+     * that are still to be migrated count as bins). O(n + bins)
+     */
+    HashMapStats stats() const {
+        HashMapStats s;
+        s.bins = _binCount + _oldBinCount - _migrated;
+        s.entries = _entryCount;
+        for (unsigned int i = 0; i < totalBinCount(); i++) {
+            if (i < _oldBinCount && i < _migrated) {
+                continue;
+            }
+            unsigned int length = 0;
+            for (Node *n = binAt(i); n != nullptr; n = n->_next) {
+                length++;
+            }
+            stats_detail::count(s.chainLengths, length);
+        }
+        s.lookups = _lookups.get();
+        s.probes = _probes.get();
+        s.grows = _grows.get();
+        s.growSeconds = _growNanos.get() / 1e9;
+        s.alloc = _pool.alloc_stats();
+        s.alloc.allocations += _binAllocs.get();
+        s.alloc.bytes += _binBytes.get();
+        return s;
+    }
+#endif
 };
 
 #endif // __HASHMAP_H
@@ -0,0 +1,151 @@
+/**
+ * Smart pointer with an intrusive, non-atomic reference count
+ * A lighter alternative to std::shared_ptr for data that is only used from a
+ * single thread: the count lives inside the object itself, and is updated
+ * with plain increments and decrements instead of atomic operations.
+ */
+#ifndef __INTRUSIVE_PTR_H
+#define __INTRUSIVE_PTR_H
+
+#include <cstddef>   // nullptr_t
+#include <utility>   // forward, swap
+
+/**
+ * Base class for objects pointed to by IntrusivePtr; holds their reference count.
+ * Counts are NOT thread-safe: objects (and all IntrusivePtrs to them) must be
+ * used from a single thread at a time.
+ */
+class IntrusiveRefCount {
+public:
+    IntrusiveRefCount() : _refs(0) {}
+
+    // each object has its own count, which is never copied along with it
+    IntrusiveRefCount(const IntrusiveRefCount &) : _refs(0) {}
+    IntrusiveRefCount &operator=(const IntrusiveRefCount &) { return *this; }
+
+    /** Number of IntrusivePtrs to this object */
+    unsigned int refs() const {
+        return _refs;
+    }
+
+private:
+    template <class N> friend class IntrusivePtr;
+
+    unsigned int _refs;
+};
+
+/**
+ * Pointer that shares ownership of an N, which must derive from IntrusiveRefCount;
+ * deletes it when the last IntrusivePtr to it is destroyed or reset.
+ * Same interface as the parts of std::shared_ptr used in this library.
+ * Since exceptions can only occur while building the object (see make_intrusive),
+ * counts stay correct even when exceptions are thrown.
+ */
+template <class N>
+class IntrusivePtr {
+public:
+
+    /** Null pointer. O(1) */
+    IntrusivePtr() : _p(nullptr) {}
+
+    /** Null pointer. O(1) */
+    IntrusivePtr(std::nullptr_t) : _p(nullptr) {}
+
+    /** Takes (shared) ownership of p, which may already be owned by other IntrusivePtrs. O(1) */
+    explicit IntrusivePtr(N *p) : _p(p) {
+        addRef();
+    }
+
+    /** Copy ctor; one more owner. O(1) */
+    IntrusivePtr(const IntrusivePtr &other) : _p(other._p) {
+        addRef();
+    }
+
+    /** Move ctor; takes over other's reference, which becomes null. O(1) */
+    IntrusivePtr(IntrusivePtr &&other) noexcept : _p(other._p) {
+        other._p = nullptr;
+    }
+
+    /** Dtor; deletes the object if this was its last owner. */
+    ~IntrusivePtr() {
+        release();
+    }
+
+    /** Copy assignment; safe for self-assignment. O(1), plus deleting the old object */
+    IntrusivePtr &operator=(const IntrusivePtr &other) {
+        IntrusivePtr(other).swap(*this);
+        return *this;
+    }
+
+    /** Move assignment. O(1), plus deleting the old object */
+    IntrusivePtr &operator=(IntrusivePtr &&other) noexcept {
+        IntrusivePtr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    /** Becomes null. O(1), plus deleting the old object */
+    void reset() {
+        IntrusivePtr().swap(*this);
+    }
+
+    void swap(IntrusivePtr &other) noexcept {
+        std::swap(_p, other._p);
+    }
+
+    N *get() const {
+        return _p;
+    }
+
+    N &operator*() const {
+        return *_p;
+    }
+
+    N *operator->() const {
+        return _p;
+    }
+
+    explicit operator bool() const {
+        return _p != nullptr;
+    }
+
+    bool operator==(const IntrusivePtr &other) const {
+        return _p == other._p;
+    }
+
+    bool operator!=(const IntrusivePtr &other) const {
+        return _p != other._p;
+    }
+
+    bool operator==(std::nullptr_t) const {
+        return _p == nullptr;
+    }
+
+    bool operator!=(std::nullptr_t) const {
+        return _p != nullptr;
+    }
+
+private:
+
+    void addRef() {
+        if (_p != nullptr) {
+            _p->IntrusiveRefCount::_refs++;
+        }
+    }
+
+    void release() {
+        if (_p != nullptr && --(_p->IntrusiveRefCount::_refs) == 0) {
+            delete _p;
+        }
+        _p = nullptr;
+    }
+
+    N *_p;
+};
+
+/** Builds an N in place from args, owned by the returned pointer; same as std::make_shared */
+template <class N, typename... Args>
+IntrusivePtr<N> make_intrusive(Args&&... args) {
+    return IntrusivePtr<N>(new N(std::forward<Args>(args)...));
+}
+
+#endif // __INTRUSIVE_PTR_H
@@ -8,14 +8,16 @@
 #define __LL_STACK_H
 
 #include "Exceptions.h"
+#include "NodePool.h"   // Allocates nodes
 #include <iostream>
 #include <iomanip>
+#include <utility>      // move, forward
 
 /**
  * Implementation of a Stack ADT using a linked list of nodes.
  * Operations are:
  *   - EmptyStack: -> Stack. Generator (empty constructor)
- *   - push: Stack, Elem -> Stack. Generator
+ *   - push: Stack, Elem -> Stack. Generator. Also emplace(args...), building in place
  *   - pop: Stack -> Stack. Partial modifier
  *   - top: Stack -> Elem. Partial observer
  *   - empty: Stack -> Bool. Observer
@@ -37,7 +39,18 @@ public:
 
     /** Pushes an element. Generator. O(1) */
     void push(const T &_elem) {
-        _top = new Node(_elem, _top);
+        emplace(_elem);
+    }
+
+    /** Pushes an element, moving it instead of copying it. Generator. O(1) */
+    void push(T &&_elem) {
+        emplace(std::move(_elem));
+    }
+
+    /** Pushes an element built in place from the given constructor arguments. O(1) */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        _top = _pool.create(_top, std::forward<Args>(args)...);
         _size++;
     }
     
@@ -51,7 +64,7 @@ public:
         }
         Node *toRemove = _top;
         _top = _top->_next;
-        delete toRemove;
+        _pool.destroy(toRemove);
         --_size;
     }
 
@@ -94,6 +107,20 @@ public:
         return *this;
     }
 
+    /** Move constructor; takes over all nodes, leaving other empty. O(1) */
+    LinkedListStack(LinkedListStack<T> &&other) noexcept : _top(nullptr), _size(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment; frees current nodes and takes over those of other. O(n) */
+    LinkedListStack<T> &operator=(LinkedListStack<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
     /** Equality operator. O(n) */
     bool operator==(const LinkedListStack<T> &rhs) const {
         if (_size != rhs._size)
@@ -133,6 +160,15 @@ protected:
         free(_top);
     }
 
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(LinkedListStack &other) {
+        _top = other._top;
+        _size = other._size;
+        _pool.swap(other._pool);
+        other._top = nullptr;
+        other._size = 0;
+    }
+
     void copy(const LinkedListStack &other) {
         if (other.empty()) {
             _top = nullptr;
@@ -140,11 +176,11 @@ protected:
         } else {
             Node *_current = other._top;
             Node *_prev;
-            _top = new Node(_current->_elem);
+            _top = _pool.create(_current->_elem);
             _prev = _top;
             while (_current->_next != nullptr) {
                 _current = _current->_next;
-                _prev->_next = new Node(_current->_elem);
+                _prev->_next = _pool.create(_current->_elem);
                 _prev = _prev->_next;
             }
             _size = other._size;
@@ -161,7 +197,8 @@ private:
     public:
         Node() : _next(nullptr) {}
         Node(const T &_elem) : _elem(_elem), _next(nullptr) {}
-        Node(const T &_elem, Node *_next) : _elem(_elem), _next(_next) {}
+        template <typename... Args>
+        Node(Node *_next, Args&&... args) : _elem(std::forward<Args>(args)...), _next(_next) {}
 
         T _elem;
         Node *_next;
@@ -171,13 +208,18 @@ private:
      * Removes all nodes from list. 
      * Passing nullptr is ok - nothing to free then. 
      * If argument is non-nullptr, must be 1st element in list.
+     * Nodes only need to be visited if they have destructors to run; 
+     * otherwise, the whole pool is released in one go.
      */
-    static void free(Node *n) {
-        while (n != nullptr) {
-            Node *aux = n;
-            n = n->_next;
-            delete aux;
+    void free(Node *n) {
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            while (n != nullptr) {
+                Node *aux = n;
+                n = n->_next;
+                _pool.destroy(aux);
+            }
         }
+        _pool.clear();
     }
 
     /** Pointer to 1st element */
@@ -185,6 +227,9 @@ private:
 
     /** Element count */
     int _size;
+
+    /** Allocator for all nodes in this stack */
+    NodePool<Node> _pool;
 };
 
 /** Output operator, for use with streams */
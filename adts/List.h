@@ -8,21 +8,33 @@
 #define __LIST_H
 
 #include "Exceptions.h"
+#include "NodePool.h"   // Allocates nodes
 #include <cassert>
+#include <functional>   // less
+#include <utility>      // move, forward
 
 /**
  * Implementation of the List ADT, with a doubly-linked list
  * Operations:
  *    - EmptyList: -> List. Generator (as empty constructor)
- *    - push_front: List, Elem -> List. Generator.
- *    - push_back: List, Elem -> List. Mutator.
+ *    - push_front: List, Elem -> List. Generator. Also emplace_front(args...), building in place
+ *    - push_back: List, Elem -> List. Mutator. Also emplace_back(args...), building in place
  *    - front: List - -> Elem. Observer, partial
  *    - pop_front: List - -> List. Mutator, partial
  *    - back: List - -> Elem. Observer, partial
  *    - pop_back: List - -> List. Mutator, partial
  *    - empty: List -> Bool. Observer
  *    - size: List -> Int. Observer
- *    - at: List, Int - -> Elem. Observer, partial.
+ *    - at: List, Int - -> Elem. Observer, partial. Remembers the last position
+ *          accessed, so that walking a list by index is O(1) per step
+ *    - splice(it, other[, first, last]): Mutator. Moves elements of other
+ *          before it, by relinking their nodes
+ *    - merge(other): Mutator. Merges sorted other into this (sorted) list, by relinking
+ *    - insert(it, first, last): Mutator. Inserts copies of a range before it
+ *    - sort(): Mutator. Stable in-place merge sort, relinking nodes. O(n log n)
+ *
+ * Since at() updates its position cache, even const lists must not be
+ * accessed by index from several threads at once.
  */
 template <class T>
 class List {
@@ -35,7 +47,9 @@ private:
     public:
         Node() : _next(nullptr), _prev(nullptr) {}
         Node(const T &_elem) : _elem(_elem), _next(nullptr), _prev(nullptr) {}
-        Node(Node *_prev, const T &_elem, Node *_next) : _elem(_elem), _next(_next), _prev(_prev) {}
+        template <typename... Args>
+        Node(Node *_prev, Node *_next, Args&&... args) 
+            : _elem(std::forward<Args>(args)...), _next(_next), _prev(_prev) {}
 
         T _elem;
         Node *_next;
@@ -45,7 +59,7 @@ private:
 public:
 
     /** Constructor; EmptyList. O(1) */
-    List() : _first(nullptr), _last(nullptr), _size(0) {}
+    List() : _first(nullptr), _last(nullptr), _size(0), _cachedNode(nullptr), _cachedIdx(0) {}
 
     /** Destructor; frees list. O(n) */
     ~List() {
@@ -54,15 +68,40 @@ public:
 
     /** Adds an an element at the front. O(1) */
     void push_front(const T &_elem) {
-        _first = insertElem(_elem, nullptr, _first);
+        emplace_front(_elem);
+    }
+
+    /** Adds an an element at the front, moving it instead of copying it. O(1) */
+    void push_front(T &&_elem) {
+        emplace_front(std::move(_elem));
+    }
+
+    /** Adds an element at the front, built in place from the given constructor arguments. O(1) */
+    template <typename... Args>
+    void emplace_front(Args&&... args) {
+        _first = insertElem(nullptr, _first, std::forward<Args>(args)...);
         if (_last == nullptr) {
             _last = _first;    // list was empty; last is also 1st element
         }
+        if (_cachedNode != nullptr) {
+            _cachedIdx++;      // cached node is now one further from the start
+        }
     }
 
     /** Adds an element at the back. O(1) */
     void push_back(const T &_elem) {
-        _last = insertElem(_elem, _last, nullptr);
+        emplace_back(_elem);
+    }
+
+    /** Adds an element at the back, moving it instead of copying it. O(1) */
+    void push_back(T &&_elem) {
+        emplace_back(std::move(_elem));
+    }
+
+    /** Adds an element at the back, built in place from the given constructor arguments. O(1) */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        _last = insertElem(_last, nullptr, std::forward<Args>(args)...);
         if (_first == nullptr) {
             _first = _last;    // list was empty; 1st is also last element
         }
@@ -98,6 +137,9 @@ public:
         Node *aBorrar = _first;
         _first = _first->_next;
         deleteElem(aBorrar);
+        if (_cachedNode != nullptr) {
+            _cachedIdx--;      // cached node, if still there, is now one closer to the start
+        }
         if (_first == nullptr) // if empty, must also update last
             _last = nullptr;
     }
@@ -130,15 +172,13 @@ public:
      * Devuelve el elemento i-ésimo de la lista, teniendo en cuenta que el primer elemento (first())
      * es el elemento 0 y el último es size()-1, es decir idx está en [0..size()-1].
      * Operación Observer partial que puede fallar si se da un índice incorrecto.
-     * O(n)
+     * Walks from the 1st node, the last one, or the last one accessed, whichever is 
+     * closest: O(1) for neighbours of the previous idx, or near either end; O(n) worst case
     */
     const T &at(unsigned int idx) const {
         if (idx >= _size)
             throw InvalidAccessException("Cannot get specified element. Invalid index");
-        Node *aux = _first;
-        for (int i = 0; i < idx; ++i)
-            aux = aux->_next;
-        return aux->_elem;
+        return nodeAt(idx)->_elem;
     }
 
     // //
@@ -305,6 +345,7 @@ public:
             // Not a special case
             Node *_next = it._current->_next;
             deleteElem(it._current);
+            forgetIndex();
             return Iterator(_next);
         }
     }
@@ -316,25 +357,175 @@ public:
      * O(1).
      */
     void insert(const T &_elem, const Iterator &it) {
+        emplace(it, _elem);
+    }
+
+    /** Inserts at current location, moving the element instead of copying it. O(1) */
+    void insert(T &&_elem, const Iterator &it) {
+        emplace(it, std::move(_elem));
+    }
+
+    /** 
+     * Inserts just before current location an element built in place from
+     * the given constructor arguments. O(1) 
+     */
+    template <typename... Args>
+    void emplace(const Iterator &it, Args&&... args) {
         if (_first == it._current) {
             // Special case: insert at start
-            push_front(_elem);
+            emplace_front(std::forward<Args>(args)...);
         } else
         if (it._current == nullptr) {
             // Special case: insert at end
-            push_back(_elem);
+            emplace_back(std::forward<Args>(args)...);
         } else {
             // Normal case
-            insertElem(_elem, it._current->_prev, it._current);
+            insertElem(it._current->_prev, it._current, std::forward<Args>(args)...);
+            forgetIndex();
         }
     }
 
+    /**
+     * Inserts copies of the elements in [first, last) just before it, in the same order.
+     * If a copy fails, the list is left unchanged. O(k) for k elements
+     */
+    template <typename InputIt>
+    void insert(const Iterator &it, InputIt first, InputIt last) {
+        List<T> copies;
+        for (; first != last; ++first) {
+            copies.push_back(*first);
+        }
+        splice(it, copies);
+    }
+
+    // //
+    // SPLICING & SORTING; relink nodes instead of copying elements
+    // //
+
+    /**
+     * Moves all elements of other just before it, leaving other empty.
+     * Nodes are relinked, and their memory is taken over from other. 
+     * O(1), plus O(log n) to take over other's chunks of nodes
+     */
+    void splice(const Iterator &it, List<T> &other) {
+        if (&other == this || other.empty()) {
+            return;
+        }
+        linkChain(it._current, other._first, other._last, other._size);
+        _pool.adopt(other._pool);
+        other._first = other._last = nullptr;
+        other._size = 0;
+        other.forgetIndex();
+    }
+
+    /** Moves the element at otherIt from other to just before it. See splice(it, other, first, last) */
+    void splice(const Iterator &it, List<T> &other, const Iterator &otherIt) {
+        if (otherIt._current == nullptr)
+            throw InvalidAccessException("Cannot splice specified element. Iterator pointing to nullptr");
+        splice(it, other, otherIt, Iterator(otherIt._current->_next));
+    }
+
+    /**
+     * Moves elements [first, last) of other to just before it, in the same order.
+     * Within a single list (other is this list; it must not be in [first, last)),
+     * and when moving all of other, nodes are just relinked, in O(1). Nodes of 
+     * a different list belong to its pool, so moving only some of them moves 
+     * each element into a new node instead: O(k), but elements are never copied.
+     */
+    void splice(const Iterator &it, List<T> &other, Iterator first, const Iterator &last) {
+        if (first == last) {
+            return;
+        }
+        if (&other == this) {
+            if (it == first) {
+                return; // already in place
+            }
+            Node *tail = (last._current != nullptr) ? last._current->_prev : _last;
+            // size is unchanged
+            unlinkChain(first._current, tail, 0);
+            linkChain(it._current, first._current, tail, 0);
+        } else if (first._current == other._first && last._current == nullptr) {
+            splice(it, other);
+        } else {
+            while (first != last) {
+                emplace(it, std::move(*first));
+                first = other.erase(first);
+            }
+        }
+    }
+
+    /**
+     * Merges other into this list; both must be sorted by less. Relinks all
+     * nodes of other into place, leaving it empty. Stable: equivalent elements of 
+     * this list stay before those of other. If less throws, the elements of other
+     * not merged yet are appended to this list, and other is still left empty. O(n + m)
+     */
+    template <typename Less = std::less<T>>
+    void merge(List<T> &other, Less less = Less()) {
+        if (&other == this || other.empty()) {
+            return;
+        }
+        // from here on, all nodes of other are in this list's pool
+        _pool.adopt(other._pool);
+        Node *pos = _first;
+        try {
+            while (other._first != nullptr) {
+                Node *next = other._first;
+                if (pos == nullptr || less(next->_elem, pos->_elem)) {
+                    other.unlinkChain(next, next, 1);
+                    linkChain(pos, next, next, 1);
+                } else {
+                    pos = pos->_next;
+                }
+            }
+        } catch (...) {
+            // nodes still in other belong to this pool: they must end up here
+            splice(end(), other);
+            throw;
+        }
+    }
+
+    /**
+     * Sorts elements by less, relinking nodes; iterators remain valid, and keep 
+     * pointing to the same elements. Stable, bottom-up merge sort: O(n log n) comparisons, 
+     * with no extra memory. If less throws, the list is left in its original order
+     */
+    template <typename Less = std::less<T>>
+    void sort(Less less = Less()) {
+        if (_size < 2) {
+            return;
+        }
+        Node *head = _first;
+        try {
+            for (unsigned int width = 1; width < _size; width *= 2) {
+                head = mergePasses(head, width, less);
+            }
+        } catch (...) {
+            // passes only change _next links; _prev ones still hold the original order
+            Node *next = nullptr;
+            for (Node *n = _last; n != nullptr; n = n->_prev) {
+                n->_next = next;
+                next = n;
+            }
+            throw;
+        }
+        // passes only maintained _next; rebuild _prev, and find last
+        _first = head;
+        Node *prev = nullptr;
+        for (Node *n = _first; n != nullptr; n = n->_next) {
+            n->_prev = prev;
+            prev = n;
+        }
+        _last = prev;
+        forgetIndex();
+    }
+
     // //
     // C++ Boilerplate code to make class more useful
     // //
 
     /** Copy ctor. O(n) */
-    List(const List<T> &other) : _first(nullptr), _last(nullptr) {
+    List(const List<T> &other) : _first(nullptr), _last(nullptr), _cachedNode(nullptr), _cachedIdx(0) {
         copy(other);
     }
 
@@ -347,6 +538,20 @@ public:
         return *this;
     }
 
+    /** Move ctor; takes over all nodes, leaving other empty. O(1) */
+    List(List<T> &&other) noexcept : _first(nullptr), _last(nullptr), _size(0), _cachedNode(nullptr), _cachedIdx(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment op; frees current nodes and takes over those of other. O(n) */
+    List<T> &operator=(List<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
     /** Equality op. O(n) */
     bool operator==(const List<T> &rhs) const {
         if (_size != rhs._size) {
@@ -376,6 +581,19 @@ protected:
         free(_first);
         _first = nullptr;
         _last = nullptr;
+        forgetIndex();
+    }
+
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(List<T> &other) {
+        _first = other._first;
+        _last = other._last;
+        _size = other._size;
+        _pool.swap(other._pool);
+        other._first = other._last = nullptr;
+        other._size = 0;
+        forgetIndex();
+        other.forgetIndex();
     }
 
     /** Copies via push_back */
@@ -392,14 +610,16 @@ protected:
 private:
 
     /** 
-     * Inserts an element between node1 & node2. Returns a pointer to new node. O(1)
+     * Inserts an element, built from args, between node1 & node2. 
+     * Returns a pointer to new node. O(1)
      * General case: both exist.
      *   node1->_next == node2
      *   node2->_prev == node1
      * Special cases: one or both is nullptr
     */
-    Node *insertElem(const T &e, Node *node1, Node *node2) {
-        Node *new_node = new Node(node1, e, node2);
+    template <typename... Args>
+    Node *insertElem(Node *node1, Node *node2, Args&&... args) {
+        Node *new_node = _pool.create(node1, node2, std::forward<Args>(args)...);
         if (node1 != nullptr)
             node1->_next = new_node;
         if (node2 != nullptr)
@@ -424,22 +644,137 @@ private:
             pnext->_prev = pprev; // update next, if any
         }
         _size --;
-        delete n;
+        if (n == _cachedNode) {
+            forgetIndex();
+        }
+        _pool.destroy(n);
+    }
+
+    /** Empties the position cache of at() */
+    void forgetIndex() const {
+        _cachedNode = nullptr;
+        _cachedIdx = 0;
+    }
+
+    /** Node at idx, which must be valid, starting from the closest known position. O(distance) */
+    Node *nodeAt(unsigned int idx) const {
+        Node *node = _first;
+        unsigned int pos = 0;
+        if (_size - 1 - idx < idx) {
+            node = _last;
+            pos = _size - 1;
+        }
+        if (_cachedNode != nullptr && distance(_cachedIdx, idx) < distance(pos, idx)) {
+            node = _cachedNode;
+            pos = _cachedIdx;
+        }
+        for (; pos < idx; ++pos)
+            node = node->_next;
+        for (; pos > idx; --pos)
+            node = node->_prev;
+        _cachedNode = node;
+        _cachedIdx = idx;
+        return node;
+    }
+
+    static unsigned int distance(unsigned int a, unsigned int b) {
+        return (a < b) ? b - a : a - b;
+    }
+
+    /**
+     * Unlinks nodes first to last (both included, and in this order) from the list;
+     * they stay linked among themselves. count is the number of nodes. O(1)
+     */
+    void unlinkChain(Node *first, Node *last, unsigned int count) {
+        if (first->_prev != nullptr)
+            first->_prev->_next = last->_next;
+        else
+            _first = last->_next;
+        if (last->_next != nullptr)
+            last->_next->_prev = first->_prev;
+        else
+            _last = first->_prev;
+        _size -= count;
+        forgetIndex();
+    }
+
+    /** Links nodes first to last just before pos (nullptr for the end). count as in unlinkChain. O(1) */
+    void linkChain(Node *pos, Node *first, Node *last, unsigned int count) {
+        Node *prev = (pos != nullptr) ? pos->_prev : _last;
+        first->_prev = prev;
+        last->_next = pos;
+        if (prev != nullptr)
+            prev->_next = first;
+        else
+            _first = first;
+        if (pos != nullptr)
+            pos->_prev = last;
+        else
+            _last = last;
+        _size += count;
+        forgetIndex();
+    }
+
+    /**
+     * One pass of bottom-up merge sort: merges each pair of consecutive
+     * sorted runs of width nodes, starting at head, and returns the new head. 
+     * Only _next links are kept up to date. O(n)
+     */
+    template <typename Less>
+    static Node *mergePasses(Node *head, unsigned int width, Less &less) {
+        Node *result = nullptr;
+        Node *tail = nullptr;
+        Node *p = head;
+        while (p != nullptr) {
+            Node *q = p;
+            unsigned int pSize = 0;
+            while (pSize < width && q != nullptr) {
+                q = q->_next;
+                pSize++;
+            }
+            unsigned int qSize = width;
+            while (pSize > 0 || (qSize > 0 && q != nullptr)) {
+                Node *next;
+                // take from the 1st run unless the 2nd has a strictly smaller element
+                if (pSize > 0 && (qSize == 0 || q == nullptr || ! less(q->_elem, p->_elem))) {
+                    next = p;
+                    p = p->_next;
+                    pSize--;
+                } else {
+                    next = q;
+                    q = q->_next;
+                    qSize--;
+                }
+                if (tail != nullptr)
+                    tail->_next = next;
+                else
+                    result = next;
+                tail = next;
+            }
+            p = q;
+        }
+        tail->_next = nullptr;
+        return result;
     }
 
     /**
      * Removes all nodes from list. 
      * Passing nullptr is ok - nothing to free then. 
      * If argument is non-nullptr, must be 1st element in list.
+     * Nodes only need to be visited if they have destructors to run; 
+     * otherwise, the whole pool is released in one go.
      */
-    static void free(Node *n) {
+    void free(Node *n) {
         // test for nullptr or 1st-element
         assert(!n || !n->_prev);
-        while (n != nullptr) {
-            Node *aux = n;
-            n = n->_next;
-            delete aux;
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            while (n != nullptr) {
+                Node *aux = n;
+                n = n->_next;
+                _pool.destroy(aux);
+            }
         }
+        _pool.clear();
     }
 
     // Pointers to 1st and last elements. May be both nullptr (empty list), or the same one (_size == 1)!
@@ -447,6 +782,13 @@ private:
 
     // Element count
     unsigned int _size;
+
+    // Last node accessed by index (nullptr if unknown), and its index
+    mutable Node *_cachedNode;
+    mutable unsigned int _cachedIdx;
+
+    // Allocator for all nodes in this list
+    NodePool<Node> _pool;
 };
 
 #endif // __LIST_H
@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <utility>
 
 template<typename T>
 class ListLinkedSingle {
@@ -53,16 +54,53 @@ public:
         return *this;
     }
 
+    /**
+     * Move constructor; other is left empty. O(1)
+     * Not noexcept: this list must allocate a phantom node of its own.
+     */
+    ListLinkedSingle(ListLinkedSingle &&other) {
+        _head = new Node;
+        _head->_next = nullptr;
+        _tail = _head;
+        take_nodes(other);
+    }
+
+    /** Move assignment; frees current nodes, other is left empty. O(n) */
+    ListLinkedSingle<T> &operator=(ListLinkedSingle<T> &&other) noexcept {
+        if (this != &other) {
+            delete_list(_head->_next);
+            take_nodes(other);
+        }
+        return *this;
+    }
+
     /** O(1)*/
     void push_front(const T &_elem) {
-        Node *new_node = new Node { _elem, _head->_next };
-        _head->_next = new_node;
-        if(_tail == _head) //si la lista era unitaria
-             _tail = new_node;
+        emplace_front(_elem);
+    }
+
+    /** moves instead of copying O(1)*/
+    void push_front(T &&_elem) {
+        emplace_front(std::move(_elem));
     }
 
+    /** builds element in place from constructor arguments O(1)*/
+    template <typename... Args>
+    void emplace_front(Args&&... args);
+
     /** O(1)*/
-    void push_back(const T &_elem);
+    void push_back(const T &_elem) {
+        emplace_back(_elem);
+    }
+
+    /** moves instead of copying O(1)*/
+    void push_back(T &&_elem) {
+        emplace_back(std::move(_elem));
+    }
+
+    /** builds element in place from constructor arguments O(1)*/
+    template <typename... Args>
+    void emplace_back(Args&&... args);
 
     /** O(1) */
     void pop_front() {
@@ -141,6 +179,7 @@ private:
     void delete_list(Node *start_node);
     Node *nth_node(int n) const;
     Node *copy_nodes(Node *start_node) const;
+    void take_nodes(ListLinkedSingle &other);
 
 };
 
@@ -164,8 +203,27 @@ void ListLinkedSingle<T>::delete_list(Node *start_node) {
 }
 
 template <typename T>
-void ListLinkedSingle<T>::push_back(const T &_elem) {
-  Node *new_node = new Node { _elem, nullptr };
+void ListLinkedSingle<T>::take_nodes(ListLinkedSingle &other) {
+  // nodes after the phantom one change hands; each list keeps its own phantom
+  _head->_next = other._head->_next;
+  _tail = (other._tail == other._head) ? _head : other._tail;
+  other._head->_next = nullptr;
+  other._tail = other._head;
+}
+
+template <typename T>
+template <typename... Args>
+void ListLinkedSingle<T>::emplace_front(Args&&... args) {
+  Node *new_node = new Node { T(std::forward<Args>(args)...), _head->_next };
+  _head->_next = new_node;
+  if(_tail == _head) //si la lista era unitaria
+       _tail = new_node;
+}
+
+template <typename T>
+template <typename... Args>
+void ListLinkedSingle<T>::emplace_back(Args&&... args) {
+  Node *new_node = new Node { T(std::forward<Args>(args)...), nullptr };
   _tail->_next = new_node;
   _tail = _tail->_next;
 }
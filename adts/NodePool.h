@@ -0,0 +1,231 @@
+/**
+ * Node pool: a slab allocator with a free-list, used by node-based ADTs
+ * Nodes are carved out of large chunks instead of being allocated one by one
+ * with new, and freed nodes are recycled by later allocations.
+ */
+#ifndef __NODEPOOL_H
+#define __NODEPOOL_H
+
+#include <new>          // placement new
+#include <type_traits>  // is_trivially_destructible
+#include <utility>      // forward, swap
+
+#include "Stats.h"      // optional allocation counters
+
+/**
+ * Hints the CPU to start loading the cache line at p, so that a later access to it
+ * does not stall. Never faults, even on invalid addresses; a no-op where unsupported.
+ * Used by batched lookups, which prefetch the nodes of several keys before visiting any.
+ */
+inline void prefetch(const void *p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+/**
+ * Pool of nodes of type N. Each container owns one pool, and creates and
+ * destroys all of its nodes through it:
+ *    - create(args...): builds a new node, passing args to its constructor. O(1)
+ *    - destroy(node): destroys a node, keeping its memory for later create() calls. O(1)
+ *    - clear(): returns all chunks to the system, _without_ running node destructors.
+ *          O(number of chunks), which is O(log n) for n nodes.
+ *    - reserve(n): makes sure that the next n calls to create() will not
+ *          allocate, using a single chunk for whatever is missing
+ *    - swap(other): exchanges all chunks and nodes with another pool. O(1)
+ *          Used by containers to move their nodes without touching them.
+ *    - adopt(other): takes over all chunks (and nodes) of another pool, leaving it
+ *          empty. O(chunks of other). Used by containers that relink nodes from
+ *          one container into another.
+ *    - alloc_stats(): chunks allocated and their bytes, only with ADT_STATS (see Stats.h)
+ *
+ * If nodes are trivially destructible (see NEEDS_DESTROY), a container can
+ * release all of its nodes at once using clear(), without walking them.
+ * Otherwise, nodes must be destroy()-ed before calling clear().
+ *
+ * Chunk sizes start small (so that small containers waste little memory), and double
+ * with each new chunk up to MAX_CHUNK_NODES.
+ */
+template <class N>
+class NodePool {
+public:
+
+    /** Nodes in the first chunk */
+    static const unsigned int MIN_CHUNK_NODES = 16;
+
+    /** Max nodes in a chunk */
+    static const unsigned int MAX_CHUNK_NODES = 4096;
+
+    /** If false, nodes need not be destroy()-ed before clear() */
+    static const bool NEEDS_DESTROY = ! std::is_trivially_destructible<N>::value;
+
+    /** Constructor; an empty pool does not allocate anything. O(1) */
+    NodePool() : _chunks(nullptr), _free(nullptr), _bump(nullptr), _bumpEnd(nullptr),
+            _chunkNodes(MIN_CHUNK_NODES) {}
+
+    /** Destructor; releases all chunks (but does not destroy live nodes). */
+    ~NodePool() {
+        clear();
+    }
+
+    /** Builds a new node, recycling a destroyed one if available. O(1) amortized */
+    template <typename... Args>
+    N *create(Args&&... args) {
+        Slot *slot = allocate();
+        try {
+            return new (slot->_node) N(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(slot);
+            throw;
+        }
+    }
+
+    /** Destroys a node created by this pool, and keeps it for reuse. O(1) */
+    void destroy(N *node) {
+        node->~N();
+        deallocate(reinterpret_cast<Slot*>(node));
+    }
+
+    /**
+     * Makes sure that n nodes can be created without further allocations.
+     * Unused slots in the current chunk are moved to the free-list, and a
+     * new chunk is allocated with room for all n nodes.
+     * O(1) if no allocation needed; O(unused slots in current chunk) otherwise
+     */
+    void reserve(unsigned int n) {
+        if (static_cast<unsigned int>(_bumpEnd - _bump) >= n) {
+            return;
+        }
+        while (_bump != _bumpEnd) {
+            deallocate(_bump++);
+        }
+        addChunk(n);
+    }
+
+    /** Releases all memory; nodes NOT destroyed, see NEEDS_DESTROY. O(chunks) */
+    void clear() {
+        while (_chunks != nullptr) {
+            Slot *next = _chunks->_next;
+            delete[] _chunks;
+            _chunks = next;
+        }
+        _free = _bump = _bumpEnd = nullptr;
+        _chunkNodes = MIN_CHUNK_NODES;
+    }
+
+    /** Exchanges contents with another pool; nodes stay where they are. O(1) */
+    void swap(NodePool &other) noexcept {
+        std::swap(_chunks, other._chunks);
+        std::swap(_free, other._free);
+        std::swap(_bump, other._bump);
+        std::swap(_bumpEnd, other._bumpEnd);
+        std::swap(_chunkNodes, other._chunkNodes);
+    }
+
+    /**
+     * Takes over all chunks of other, which becomes empty: nodes built by
+     * other can now be destroyed through this pool, and are released by its
+     * clear(). Slots that other had free (or never used) are not reused
+     * until then. O(chunks of other)
+     */
+    void adopt(NodePool &other) {
+        if (this == &other || other._chunks == nullptr) {
+            return;
+        }
+        Slot *oldest = other._chunks;
+        while (oldest->_next != nullptr) {
+            oldest = oldest->_next;
+        }
+        oldest->_next = _chunks;
+        _chunks = other._chunks;
+        other._chunks = other._free = other._bump = other._bumpEnd = nullptr;
+        other._chunkNodes = MIN_CHUNK_NODES;
+    }
+
+#ifdef ADT_STATS
+    /**
+     * Chunks allocated by this pool so far (including those already released), and
+     * their size. Counters stay with the pool: swap() and adopt() do not move them.
+     */
+    AllocStats alloc_stats() const {
+        AllocStats s;
+        s.allocations = _allocations.get();
+        s.bytes = _bytes.get();
+        return s;
+    }
+#endif
+
+    // pools own memory; they cannot be copied
+    NodePool(const NodePool &other) = delete;
+    NodePool &operator=(const NodePool &other) = delete;
+
+private:
+
+    /**
+     * Memory for a single node. While free, it is used to
+     * link to the next free slot instead.
+     */
+    union Slot {
+        Slot *_next;
+        alignas(N) unsigned char _node[sizeof(N)];
+    };
+
+    /** Returns a free slot, allocating a new chunk if needed. O(1) amortized */
+    Slot *allocate() {
+        if (_free != nullptr) {
+            Slot *slot = _free;
+            _free = _free->_next;
+            return slot;
+        }
+        if (_bump == _bumpEnd) {
+            addChunk(_chunkNodes);
+            if (_chunkNodes < MAX_CHUNK_NODES) {
+                _chunkNodes *= 2;
+            }
+        }
+        return _bump++;
+    }
+
+    /** Returns a slot to the free-list. O(1) */
+    void deallocate(Slot *slot) {
+        slot->_next = _free;
+        _free = slot;
+    }
+
+    /**
+     * Allocates a new chunk with room for n nodes. Its 1st slot links to the
+     * previous chunk; the remaining ones are handed out by allocate().
+     */
+    void addChunk(unsigned int n) {
+        Slot *chunk = new Slot[n + 1];
+        ADT_STAT(_allocations.add(); _bytes.add((n + 1) * sizeof(Slot)));
+        chunk->_next = _chunks;
+        _chunks = chunk;
+        _bump = chunk + 1;
+        _bumpEnd = chunk + 1 + n;
+    }
+
+    /** Most-recently allocated chunk; chunks are linked via their 1st slot */
+    Slot *_chunks;
+
+    /** Free-list of destroyed nodes */
+    Slot *_free;
+
+    /** Next never-used slot in current chunk */
+    Slot *_bump;
+
+    /** End of current chunk */
+    Slot *_bumpEnd;
+
+    /** Number of nodes in next chunk */
+    unsigned int _chunkNodes;
+
+#ifdef ADT_STATS
+    /** Chunks allocated, and their total size in bytes */
+    StatCounter _allocations, _bytes;
+#endif
+};
+
+#endif // __NODEPOOL_H
@@ -0,0 +1,606 @@
+/**
+ * Persistent map ADT using balanced (AVL) binary trees with shared, immutable nodes
+ * Copies (snapshots) are O(1); changing a map copies only the nodes on the path
+ * from the root to the changed key, and shares all others with earlier versions.
+ */
+
+#ifndef __PERSISTENTTREEMAP_H
+#define __PERSISTENTTREEMAP_H
+
+#include <iostream>
+#include <algorithm>    // max
+#include <atomic>
+#include <functional>   // less
+#include <utility>      // forward, move, swap
+#include "Exceptions.h"
+#include "Stack.h"      // Used by iterators
+
+/**
+ * Map using a persistent height-balanced (AVL) Binary Tree
+ *
+ * Nodes are never modified once built. insert() and erase() build new nodes
+ * for the O(log n) keys on the path they walk (plus O(1) more when rebalancing),
+ * linked to the untouched subtrees of the old tree; and the map then switches to
+ * the new root. Any copy of the map made before still sees the old version, and
+ * shares all nodes that did not change. Copying a map, or calling snapshot(),
+ * is therefore O(1): it only adds a reference to the root.
+ *
+ * Nodes count their references (from parents and from maps) atomically, and are
+ * freed when the last one is dropped. Different maps may be used from different
+ * threads at the same time, without locks, even if they share nodes: for instance,
+ * a writer can keep updating its map while reporting threads read (and finally
+ * destroy) snapshots of earlier versions. As with any other container, a single
+ * map object must not be changed while other threads use that same object.
+ * Nodes are allocated one by one with new: they can outlive the map that built
+ * them, and be freed from any thread, so a per-container NodePool does not fit.
+ *
+ * Requires keys to support a comparison operator, as TreeMap does.
+ * Operations are:
+ *    - PersistentTreeMap constructor: generator
+ *    - insert(key, value): generator, adds a new (key, value) pair to the map.
+ *          If the key was already present, replaces its value with the new one.
+ *          O(log n) new nodes.
+ *    - erase(key): mutator. Removes the key from the map. No effect if key absent.
+ *          O(log n) new nodes.
+ *    - snapshot(): observer. Returns a copy of the current version. O(1)
+ *    - at(key): observer. Returns value that corresponds to a key.
+ *          Partial: key must exist; use contains() first if unsure.
+ *    - contains(key): observer. Returnes true iff key exists in map
+ *    - empty(): observer. Returns true if no keys present.
+ *    - size(): observer. Returns count of currently-contained keys.
+ *    - shares_root(other): observer. True IFF both maps are the same version.
+ *
+ * Only constant iterators are offered, since values cannot change in place.
+ */
+template <typename K, typename V, typename Comparator = std::less<K>>
+class PersistentTreeMap {
+private:
+    /**
+     * Internal node class; immutable once built, except for its reference count
+     */
+    class Node {
+    public:
+        /** The node owns one reference to each child, and starts with one reference */
+        template <typename KK, typename VV>
+        Node(KK &&key, VV &&value, Node *left, Node *right)
+            : _key(std::forward<KK>(key)), _value(std::forward<VV>(value)),
+              _left(left), _right(right),
+              _height(1 + std::max(height(left), height(right))), _refs(1) {}
+
+        const K _key;
+        const V _value;
+        Node *const _left;
+        Node *const _right;
+        /** Height of subtree rooted at this node; 1 for leaves */
+        const int _height;
+        /** Number of parents and maps pointing to this node */
+        std::atomic<unsigned int> _refs;
+    };
+
+public:
+
+    /** Constructor; returns an empty PersistentTreeMap. O(1) */
+    PersistentTreeMap() : _root(nullptr), _size(0) {}
+
+    /** Destructor; frees the nodes not shared with other versions */
+    ~PersistentTreeMap() {
+        release(_root);
+    }
+
+    /**
+     * Adds a new key, value pair to the map. If key
+     * already present, replaces old value with new one.
+     * Other copies of the map do not see the change.
+     * generator, O(log n)
+     */
+    void insert(const K &key, const V &value) {
+        bool added = false;
+        replaceRoot(insertAux(_root, key, value, added));
+        if (added) {
+            _size++;
+        }
+    }
+
+    /**
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(log n)
+     */
+    void insert(K &&key, V &&value) {
+        bool added = false;
+        replaceRoot(insertAux(_root, std::move(key), std::move(value), added));
+        if (added) {
+            _size++;
+        }
+    }
+
+    /**
+     * Removes a key, value pair from the map.
+     * No effect (and no new nodes) if key not there in the first place.
+     * Other copies of the map do not see the change.
+     * mutator, O(log n)
+     */
+    void erase(const K &key) {
+        if (findAux(_root, key) == nullptr) {
+            return;
+        }
+        replaceRoot(eraseAux(_root, key));
+        _size--;
+    }
+
+    /**
+     * Returns an independent copy of the current version, which later changes
+     * to this map will not affect. Same as copying the map.
+     * observer, O(1)
+     */
+    PersistentTreeMap snapshot() const {
+        return *this;
+    }
+
+    /**
+     * Returns value associated to a key.
+     * Partial - if key not present, throws exception. Use contains() if unsure
+     * observer, O(log n)
+     */
+    const V &at(const K &key) const {
+        Node *p = findAux(_root, key);
+        if (p == nullptr) {
+            throw BadKeyException();
+        }
+        return p->_value;
+    }
+
+    /**
+     * Returns true IFF key in map
+     * observer, O(log n)
+     */
+    bool contains(const K &key) const {
+        return findAux(_root, key) != nullptr;
+    }
+
+    /**
+     * Returns true IFF no elements in map
+     * observer, O(1)
+     */
+    bool empty() const {
+        return _root == nullptr;
+    }
+
+    /**
+     * Returns number of keys in map.
+     * observer, O(1)
+     */
+    int size() const {
+        return _size;
+    }
+
+    /**
+     * Returns true IFF both maps are the same version (and therefore share all nodes).
+     * observer, O(1)
+     */
+    bool shares_root(const PersistentTreeMap &other) const {
+        return _root == other._root;
+    }
+
+    // //
+    // CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map, in key order.
+     * Does not allow any changes. Remains valid while the version
+     * it iterates exists, even if the map it came from changes.
+     */
+    class ConstIterator {
+    public:
+        ConstIterator() : _current(nullptr) {}
+
+        /** O(log n) */
+        void next() {
+            if (_current == nullptr)
+                throw InvalidAccessException();
+            // If right child, jump its smallest child (first in order)
+            if (_current->_right != nullptr)
+                _current = firstInOrder(_current->_right);
+            else {
+                // Otherwise, we backtrack to the first unvisited ancestor
+                if (_ancestors.empty()) // Reached root!
+                    _current = nullptr;
+                else {
+                    _current = _ancestors.top();
+                    _ancestors.pop();
+                }
+            }
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_current == nullptr) throw InvalidAccessException();
+            return _current->_key;
+        }
+
+        /** O(1) */
+        const V &value() const {
+            if (_current == nullptr) throw InvalidAccessException();
+            return _current->_value;
+        }
+
+        /** O(1) */
+        bool operator==(const ConstIterator &other) const {
+            return _current == other._current;
+        }
+
+        /** O(1) */
+        bool operator!=(const ConstIterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(log n) */
+        ConstIterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(log n) */
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class PersistentTreeMap;
+
+        ConstIterator(Node *current) {
+            this->_current = firstInOrder(current);
+        }
+
+        /**
+         * Returns the 1st element in an in-order search of the node structure.
+         * Keeps a stack of ancestors to allow backtracking when needed
+         * O(log n)
+         */
+        Node *firstInOrder(Node *p) {
+            if (p == nullptr)
+                return nullptr;
+
+            while (p->_left != nullptr) {
+                _ancestors.push(p);
+                p = p->_left;
+            }
+            return p;
+        }
+
+        /** Pointer to current node in traversal */
+        Node *_current;
+
+        /** Non-visited ascendants, for use when backtracking up the tree */
+        Stack<Node*> _ancestors;
+    };
+
+    /**
+     * Returns a constant iterator starting from the smallest key
+     * O(log n)
+     */
+    ConstIterator cbegin() const {
+        return ConstIterator(_root);
+    }
+
+    /**
+     * Returns a constant iterator just outside the map, reachable by an iterator
+     * that starts at cbegin()
+     * O(1)
+     */
+    ConstIterator cend() const {
+        return ConstIterator(nullptr);
+    }
+
+    /** Same as cbegin(); there are no non-constant iterators */
+    ConstIterator begin() const {
+        return cbegin();
+    }
+
+    /** Same as cend(); there are no non-constant iterators */
+    ConstIterator end() const {
+        return cend();
+    }
+
+    /**
+     * Returns a constant iterator to the node with a given key,
+     * or cend() if not found
+     * O(log n)
+     */
+    ConstIterator find(const K &key) const {
+        ConstIterator ret;
+        Node *p = _root;
+        while (p != nullptr && (_cless(p->_key, key) || _cless(key, p->_key))) {
+            if (_cless(key, p->_key)) {
+                ret._ancestors.push(p);
+                p = p->_left;
+            } else {
+                p = p->_right;
+            }
+        }
+        if (p == nullptr) {
+            return cend();
+        }
+        ret._current = p;
+        return ret;
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    friend std::ostream& operator<<(std::ostream& o, const PersistentTreeMap& t){
+        o<<"{";
+        show(t._root, o);
+        o<<"}";
+        return o;
+    }
+
+    /** Copy ctor: shares all nodes with other. O(1) */
+    PersistentTreeMap(const PersistentTreeMap &other)
+            : _root(ref(other._root)), _size(other._size) {}
+
+    /** Assignment operator: shares all nodes with other. O(1), plus freeing unshared old nodes */
+    PersistentTreeMap &operator=(const PersistentTreeMap &other) {
+        if (this != &other) {
+            replaceRoot(ref(other._root));
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    /** Move ctor; takes over other's version, leaving it empty. O(1) */
+    PersistentTreeMap(PersistentTreeMap &&other) noexcept : _root(other._root), _size(other._size) {
+        other._root = nullptr;
+        other._size = 0;
+    }
+
+    /** Move assignment; takes over other's version, leaving it empty. O(1), plus freeing unshared old nodes */
+    PersistentTreeMap &operator=(PersistentTreeMap &&other) noexcept {
+        if (this != &other) {
+            replaceRoot(other._root);
+            _size = other._size;
+            other._root = nullptr;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+private:
+
+    // //
+    // REFERENCE COUNTING
+    // //
+
+    /** Adds a reference to n (if any), and returns it. O(1) */
+    static Node *ref(Node *n) {
+        if (n != nullptr) {
+            // a new reference is always made from an existing one, so no ordering needed
+            n->_refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    /**
+     * Drops a reference to n (if any). If it was the last one, frees n and
+     * drops its references to its children. O(freed nodes)
+     */
+    static void release(Node *n) {
+        while (n != nullptr && n->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            release(n->_left);
+            Node *right = n->_right;
+            delete n;
+            n = right; // loop instead of recursing on one side
+        }
+    }
+
+    /** Switches to a new root (whose reference this map takes over), releasing the old one */
+    void replaceRoot(Node *root) {
+        Node *old = _root;
+        _root = root;
+        release(old);
+    }
+
+    // //
+    // PATH COPYING
+    // //
+    // Helpers take borrowed pointers to nodes of the old tree, which stays
+    // unchanged, and return new subtrees, owning one reference to their root.
+    // If building a node throws (allocating it, or copying its key or value),
+    // references taken so far are released: nothing is leaked, and the old
+    // tree is left as it was.
+
+    static int height(Node *n) {
+        return n == nullptr ? 0 : n->_height;
+    }
+
+    /** Owned reference to a subtree (or nullptr); released on destruction, unless taken */
+    class Owned {
+    public:
+        explicit Owned(Node *n) : _n(n) {}
+        ~Owned() {
+            release(_n);
+        }
+        Owned(const Owned &) = delete;
+        Owned &operator=(const Owned &) = delete;
+
+        Node *get() const {
+            return _n;
+        }
+
+        /** Hands the reference over to the caller */
+        Node *take() {
+            Node *n = _n;
+            _n = nullptr;
+            return n;
+        }
+
+    private:
+        Node *_n;
+    };
+
+    /** New node, which takes over the references of left and right only once it is built. O(1) */
+    template <typename KK, typename VV>
+    static Node *make(KK &&key, VV &&value, Owned &left, Owned &right) {
+        Node *n = new Node(std::forward<KK>(key), std::forward<VV>(value), left.get(), right.get());
+        left.take();
+        right.take();
+        return n;
+    }
+
+    /**
+     * New tree with the given key and value at its root; takes over (owned)
+     * references to left and right, whose heights may differ by up to 2.
+     * Rotates as needed, building new nodes for those that move: O(1)
+     */
+    template <typename KK, typename VV>
+    static Node *balance(KK &&key, VV &&value, Node *leftTree, Node *rightTree) {
+        // rotated-away roots (still held here) are released on return
+        Owned left(leftTree), right(rightTree);
+        int hl = height(leftTree), hr = height(rightTree);
+        if (hl > hr + 1) {
+            Node *l = leftTree;
+            if (height(l->_left) >= height(l->_right)) {
+                // single rotation to the right
+                Owned ll(ref(l->_left)), lr(ref(l->_right));
+                Owned top(make(std::forward<KK>(key), std::forward<VV>(value), lr, right));
+                return make(l->_key, l->_value, ll, top);
+            } else {
+                // double rotation: l->_right becomes the root
+                Node *lr = l->_right;
+                Owned ll(ref(l->_left)), lrl(ref(lr->_left)), lrr(ref(lr->_right));
+                Owned newLeft(make(l->_key, l->_value, ll, lrl));
+                Owned newRight(make(std::forward<KK>(key), std::forward<VV>(value), lrr, right));
+                return make(lr->_key, lr->_value, newLeft, newRight);
+            }
+        } else if (hr > hl + 1) {
+            Node *r = rightTree;
+            if (height(r->_right) >= height(r->_left)) {
+                // single rotation to the left
+                Owned rl(ref(r->_left)), rr(ref(r->_right));
+                Owned top(make(std::forward<KK>(key), std::forward<VV>(value), left, rl));
+                return make(r->_key, r->_value, top, rr);
+            } else {
+                // double rotation: r->_left becomes the root
+                Node *rl = r->_left;
+                Owned rll(ref(rl->_left)), rlr(ref(rl->_right)), rr(ref(r->_right));
+                Owned newLeft(make(std::forward<KK>(key), std::forward<VV>(value), left, rll));
+                Owned newRight(make(r->_key, r->_value, rlr, rr));
+                return make(rl->_key, rl->_value, newLeft, newRight);
+            }
+        }
+        return make(std::forward<KK>(key), std::forward<VV>(value), left, right);
+    }
+
+    /**
+     * New tree with the nodes of n plus (key, value); added becomes true IFF
+     * the key was not already there (and otherwise, its value is replaced).
+     * O(log n)
+     */
+    template <typename KK, typename VV>
+    Node *insertAux(Node *n, KK &&key, VV &&value, bool &added) const {
+        if (n == nullptr) {
+            added = true;
+            return new Node(std::forward<KK>(key), std::forward<VV>(value), nullptr, nullptr);
+        } else if (_cless(key, n->_key)) {
+            Node *left = insertAux(n->_left, std::forward<KK>(key), std::forward<VV>(value), added);
+            return balance(n->_key, n->_value, left, ref(n->_right));
+        } else if (_cless(n->_key, key)) {
+            Node *right = insertAux(n->_right, std::forward<KK>(key), std::forward<VV>(value), added);
+            return balance(n->_key, n->_value, ref(n->_left), right);
+        } else {
+            // same key: a new node with the new value, sharing both children (so same height)
+            Owned left(ref(n->_left)), right(ref(n->_right));
+            return make(n->_key, std::forward<VV>(value), left, right);
+        }
+    }
+
+    /**
+     * New tree with the nodes of n except the one with key, which must be present.
+     * O(log n)
+     */
+    Node *eraseAux(Node *n, const K &key) const {
+        // new subtrees are built before taking any other reference, which would leak if building threw
+        if (_cless(key, n->_key)) {
+            Node *left = eraseAux(n->_left, key);
+            return balance(n->_key, n->_value, left, ref(n->_right));
+        } else if (_cless(n->_key, key)) {
+            Node *right = eraseAux(n->_right, key);
+            return balance(n->_key, n->_value, ref(n->_left), right);
+        } else if (n->_left == nullptr) {
+            return ref(n->_right);
+        } else if (n->_right == nullptr) {
+            return ref(n->_left);
+        } else {
+            // replace by the smallest key of the right subtree
+            Node *min = n->_right;
+            while (min->_left != nullptr) {
+                min = min->_left;
+            }
+            Node *right = eraseMin(n->_right);
+            return balance(min->_key, min->_value, ref(n->_left), right);
+        }
+    }
+
+    /** New tree with the nodes of n except its smallest one. O(log n) */
+    static Node *eraseMin(Node *n) {
+        if (n->_left == nullptr) {
+            return ref(n->_right);
+        }
+        Node *left = eraseMin(n->_left);
+        return balance(n->_key, n->_value, left, ref(n->_right));
+    }
+
+    /**
+     * Finds a key in the subtree rooted at p
+     * Returns a pointer to its node, or nullptr if not found
+     * O(log n)
+     */
+    Node *findAux(Node *p, const K &key) const {
+        while (p != nullptr) {
+            if (_cless(key, p->_key)) {
+                p = p->_left;
+            } else if (_cless(p->_key, key)) {
+                p = p->_right;
+            } else {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    static void show(Node *n, std::ostream &out) {
+        if (n != nullptr) {
+            if (n->_left != nullptr) {
+                show(n->_left, out);
+                out << ", ";
+            }
+            out << n->_key << " -> " << n->_value;
+            if (n->_right != nullptr) {
+                out << ", ";
+                show(n->_right, out);
+            }
+        }
+    }
+
+    /** Root of the current version; this map owns one reference to it */
+    Node *_root;
+
+    /** Number of keys in the current version */
+    int _size;
+
+    /** Comparison function */
+    Comparator _cless;
+};
+
+#endif // __PERSISTENTTREEMAP_H
@@ -8,13 +8,15 @@
 #define __LL_QUEUE_H
 
 #include "Exceptions.h"
+#include "NodePool.h"   // Allocates nodes
 #include <iostream>
+#include <utility>      // move, forward
 
 /**
  * Implementation of a Queue ADT using a linked list of nodes.
  * Operations are:
  *   - EmptyQueue: -> Queue. Queue (empty constructor)
- *   - push_back: Queue, Elem -> Stack. Generator
+ *   - push_back: Queue, Elem -> Stack. Generator. Also emplace_back(args...), building in place
  *   - pop_front: Queue -> Queue. Partial modifier
  *   - front: Queue -> Elem. Partial observer
  *   - empty: Queue -> Bool. Observer
@@ -36,7 +38,18 @@ public:
 
     /** Pushes an element at back. Generator. O(1) */
     void push_back(const T &_elem) {
-        Node *newNode = new Node(_elem, nullptr);
+        emplace_back(_elem);
+    }
+
+    /** Pushes an element at back, moving it instead of copying it. Generator. O(1) */
+    void push_back(T &&_elem) {
+        emplace_back(std::move(_elem));
+    }
+
+    /** Pushes an element at back, built in place from the given constructor arguments. O(1) */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        Node *newNode = _pool.create(nullptr, std::forward<Args>(args)...);
         if (_last != nullptr) {
             _last->_next = newNode;
         }
@@ -58,7 +71,7 @@ public:
         }
         Node *toRemove = _first;
         _first = _first->_next;
-        delete toRemove;
+        _pool.destroy(toRemove);
         --_size;
         if (_first == nullptr) //si la cola queda vacía, no hay último
             _last = nullptr;
@@ -103,6 +116,20 @@ public:
         return *this;
     }
 
+    /** Move constructor; takes over all nodes, leaving other empty. O(1) */
+    Queue(Queue<T> &&other) noexcept : _first(nullptr), _last(nullptr), _size(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment; frees current nodes and takes over those of other. O(n) */
+    Queue<T> &operator=(Queue<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
     /** Equality operator. O(n) */
     bool operator==(const Queue<T> &rhs) const {
         if (_size != rhs._size)
@@ -142,6 +169,16 @@ protected:
         free(_first);
     }
 
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(Queue &other) {
+        _first = other._first;
+        _last = other._last;
+        _size = other._size;
+        _pool.swap(other._pool);
+        other._first = other._last = nullptr;
+        other._size = 0;
+    }
+
     void copy(const Queue &other) {
         if (other.empty()) {
             _first = _last = nullptr;
@@ -149,11 +186,11 @@ protected:
         } else {
             Node *_current = other._first;
             Node *_prev;
-            _first = new Node(_current->_elem);
+            _first = _pool.create(_current->_elem);
             _prev = _first;
             while (_current->_next != nullptr) {
                 _current = _current->_next;
-                _prev->_next = new Node(_current->_elem);
+                _prev->_next = _pool.create(_current->_elem);
                 _prev = _prev->_next;
             }
             _last = _prev;
@@ -171,7 +208,8 @@ private:
     public:
         Node() : _next(nullptr) {}
         Node(const T &_elem) : _elem(_elem), _next(nullptr) {}
-        Node(const T &_elem, Node *_next) : _elem(_elem), _next(_next) {}
+        template <typename... Args>
+        Node(Node *_next, Args&&... args) : _elem(std::forward<Args>(args)...), _next(_next) {}
 
         T _elem;
         Node *_next;
@@ -181,13 +219,18 @@ private:
      * Removes all nodes from list. 
      * Passing nullptr is ok - nothing to free then. 
      * If argument is non-nullptr, must be 1st element in list.
+     * Nodes only need to be visited if they have destructors to run; 
+     * otherwise, the whole pool is released in one go.
      */
-    static void free(Node *n) {
-        while (n != nullptr) {
-            Node *aux = n;
-            n = n->_next;
-            delete aux;
+    void free(Node *n) {
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            while (n != nullptr) {
+                Node *aux = n;
+                n = n->_next;
+                _pool.destroy(aux);
+            }
         }
+        _pool.clear();
     }
 
     /** Pointer to 1st element */
@@ -198,6 +241,9 @@ private:
 
     /** Element count */
     int _size;
+
+    /** Allocator for all nodes in this queue */
+    NodePool<Node> _pool;
 };
 
 /** Output operator, for use with streams */
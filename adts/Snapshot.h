@@ -0,0 +1,717 @@
+/**
+ * Binary snapshots of HashMaps, TreeMaps and TreeSets, and read-only views of them
+ * A snapshot can be written to any binary stream, and later either loaded back into
+ * a container, or used as it is (for instance, from a memory-mapped file) through
+ * a view, which answers lookups directly against the snapshot bytes.
+ */
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>      // memcmp, memcpy
+#include <algorithm>    // lower_bound, min
+#include <fstream>
+#include <iostream>
+#include <new>          // align_val_t
+#include <string>
+#include <type_traits>  // is_trivially_copyable
+#include <utility>      // pair
+#include <vector>
+#include "Exceptions.h"
+#include "Hash.h"       // mixhash, to place keys in bins as HashMap does
+#include "HashMap.h"
+#include "TreeMap.h"
+#include "TreeSet.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+#define __SNAPSHOT_MMAP
+#endif
+
+/**
+ * Only containers of trivially-copyable keys and values (ints, doubles, structs
+ * and arrays of those...) can be snapshotted: their bytes are written as they are.
+ * Operations are:
+ *    - save_snapshot(container, out): writes a snapshot of a HashMap, TreeMap or
+ *          TreeSet to a binary stream. O(n)
+ *    - load_snapshot(in, container): replaces the contents of a container with
+ *          those of a snapshot read from a binary stream. O(n)
+ *    - MappedFile(path): maps a whole file into memory, read-only. O(1): pages are
+ *          only read from disk when (and if) a lookup touches them.
+ *    - HashMapView, TreeMapView and TreeSetView: read-only lookups against a snapshot
+ *          in memory, with size(), empty(), contains(key), at(key) (not for sets), and
+ *          key(i) / value(i) for the i-th entry in the snapshot; entries of tree
+ *          snapshots are sorted. Building a view only checks the snapshot header, in O(1).
+ *
+ * Format (version 1): a Header, followed by the keys, the values (for maps) and the bins
+ * (for HashMaps, see below) as plain arrays. All of them start at multiples of 64
+ * bytes, zero-padded; as long as the snapshot itself is loaded at a 64-byte aligned
+ * address (as MappedFile and load_snapshot do), each array is aligned for its type.
+ * HashMap snapshots group their entries by bin, with the bin of a key computed as in
+ * HashMap, over a power-of-2 number of bins that is at least the number of entries:
+ * the entries of bin b are those from bins[b] to bins[b + 1] - 1.
+ *
+ * Snapshots are meant to be used on the machine, and with the same key types and
+ * hash functions, that saved them. Views check the byte order, sizes of keys and
+ * values, kind of container and format version, and (for HashMaps) that the hash
+ * of the first key matches; and throw BadSnapshotException otherwise. They never
+ * read outside the snapshot, but do not check that keys are sorted or in their bins.
+ */
+namespace snapshot_detail {
+
+    inline constexpr char MAGIC[8] = {'E', 'D', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+    /** Changes whenever the format changes; snapshots of other versions are rejected */
+    inline constexpr std::uint32_t FORMAT_VERSION = 1;
+
+    /** Stored as written by the saving machine; reads differently on the other byte order */
+    inline constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /** Alignment of the snapshot start, and of each array within it */
+    inline constexpr std::uint64_t ALIGNMENT = 64;
+
+    /** Largest piece read at once from streams whose length is unknown */
+    inline constexpr std::size_t READ_CHUNK = std::size_t(1) << 20;
+
+    enum Kind : std::uint32_t { HASH_MAP = 1, TREE_MAP = 2, TREE_SET = 3 };
+
+    /** Start of every snapshot. Offsets are in bytes from the start of the snapshot */
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t kind;
+        std::uint32_t keySize;      // sizeof(K)
+        std::uint32_t valueSize;    // sizeof(V); 0 for sets
+        std::uint32_t reserved;     // 0
+        std::uint64_t count;        // entries
+        std::uint64_t binCount;     // HashMaps only; otherwise 0
+        std::uint64_t hashCheck;    // HashMaps only: mixed hash of keys[0], if any
+        std::uint64_t keysOffset;
+        std::uint64_t valuesOffset; // 0 for sets
+        std::uint64_t binsOffset;   // 0 except for HashMaps
+        std::uint64_t totalSize;    // including padding at the end
+    };
+
+    /** n, rounded up to a multiple of ALIGNMENT */
+    inline std::uint64_t alignUp(std::uint64_t n) {
+        return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    /** A header for count entries; offsets are set by layout() */
+    inline Header makeHeader(Kind kind, std::uint32_t keySize, std::uint32_t valueSize, std::uint64_t count) {
+        Header h = {};
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version = FORMAT_VERSION;
+        h.byteOrder = BYTE_ORDER_MARK;
+        h.kind = kind;
+        h.keySize = keySize;
+        h.valueSize = valueSize;
+        h.count = count;
+        return h;
+    }
+
+    /** Places keys, values (if any) and bins (if any) after the header, and sets totalSize */
+    inline void layout(Header &h) {
+        std::uint64_t pos = alignUp(sizeof(Header));
+        h.keysOffset = pos;
+        pos = alignUp(pos + h.count * h.keySize);
+        if (h.valueSize != 0) {
+            h.valuesOffset = pos;
+            pos = alignUp(pos + h.count * h.valueSize);
+        }
+        if (h.binCount != 0) {
+            h.binsOffset = pos;
+            pos = alignUp(pos + (h.binCount + 1) * sizeof(std::uint64_t));
+        }
+        h.totalSize = pos;
+    }
+
+    /** Writes zeros from pos up to offset, and then n bytes of data; pos ends after them */
+    inline void writeAt(std::ostream &out, std::uint64_t &pos, std::uint64_t offset,
+                        const void *data, std::uint64_t n) {
+        static const char zeros[ALIGNMENT] = {};
+        out.write(zeros, offset - pos);
+        out.write(static_cast<const char *>(data), n);
+        pos = offset + n;
+    }
+
+    /** Writes a whole snapshot, given a header with layout() already applied */
+    inline void write(std::ostream &out, const Header &h, const void *keys,
+                      const void *values, const std::uint64_t *bins) {
+        std::uint64_t pos = 0;
+        writeAt(out, pos, 0, &h, sizeof(Header));
+        writeAt(out, pos, h.keysOffset, keys, h.count * h.keySize);
+        if (h.valuesOffset != 0) {
+            writeAt(out, pos, h.valuesOffset, values, h.count * h.valueSize);
+        }
+        if (h.binsOffset != 0) {
+            writeAt(out, pos, h.binsOffset, bins, (h.binCount + 1) * sizeof(std::uint64_t));
+        }
+        writeAt(out, pos, h.totalSize, nullptr, 0);
+        if ( ! out) {
+            throw BadSnapshotException("Could not write snapshot");
+        }
+    }
+
+    /** Checks magic, byte order and version: whatever any reader needs */
+    inline void checkFormat(const Header &h) {
+        if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw BadSnapshotException("Not a snapshot");
+        }
+        if (h.byteOrder != BYTE_ORDER_MARK) {
+            throw BadSnapshotException("Snapshot saved on a machine with another byte order");
+        }
+        if (h.version != FORMAT_VERSION) {
+            throw BadSnapshotException("Unsupported snapshot version " + std::to_string(h.version));
+        }
+    }
+
+    /** True IFF count elements of the given size, starting at offset, end before total */
+    inline bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t total) {
+        return offset % ALIGNMENT == 0 && offset <= total
+            && (size == 0 || count <= (total - offset) / size);
+    }
+
+    /**
+     * Returns the header of the snapshot at [data, data + size), after checking it
+     * against the expected kind and sizes, and checking that all arrays lie inside. O(1)
+     */
+    inline Header check(const void *data, std::size_t size, Kind kind,
+                        std::uint32_t keySize, std::uint32_t valueSize) {
+        if (data == nullptr || size < sizeof(Header)) {
+            throw BadSnapshotException("Truncated snapshot");
+        }
+        Header h;
+        std::memcpy(&h, data, sizeof(Header));
+        checkFormat(h);
+        if (h.kind != kind) {
+            throw BadSnapshotException("Snapshot of another kind of container");
+        }
+        if (h.keySize != keySize || h.valueSize != valueSize) {
+            throw BadSnapshotException("Snapshot of other key or value types");
+        }
+        if (h.totalSize > size) {
+            throw BadSnapshotException("Truncated snapshot");
+        }
+        bool inside = fits(h.keysOffset, h.count, h.keySize, h.totalSize)
+            && (h.valueSize == 0 || fits(h.valuesOffset, h.count, h.valueSize, h.totalSize));
+        if (kind == HASH_MAP) {
+            inside = inside && h.binCount != 0 && (h.binCount & (h.binCount - 1)) == 0
+                && fits(h.binsOffset, h.binCount + 1, sizeof(std::uint64_t), h.totalSize);
+        }
+        if ( ! inside) {
+            throw BadSnapshotException("Corrupt snapshot");
+        }
+        return h;
+    }
+
+    /** The array of Ts at offset; throws if misaligned for T */
+    template <typename T>
+    const T *array(const void *data, std::uint64_t offset) {
+        const unsigned char *p = static_cast<const unsigned char *>(data) + offset;
+        if (reinterpret_cast<std::uintptr_t>(p) % alignof(T) != 0) {
+            throw BadSnapshotException("Misaligned snapshot");
+        }
+        return reinterpret_cast<const T *>(p);
+    }
+
+    /** Bytes left in a stream after its current position; -1 if it cannot seek */
+    inline std::streamoff remaining(std::istream &in) {
+        std::streampos here = in.tellg();
+        if (here == std::streampos(-1)) {
+            return -1;
+        }
+        in.seekg(0, std::ios::end);
+        std::streampos end = in.tellg();
+        in.clear();
+        in.seekg(here);
+        return (end == std::streampos(-1)) ? -1 : end - here;
+    }
+
+    /**
+     * The bytes of a single snapshot, read from a stream into ALIGNMENT-aligned memory.
+     * The size claimed by the header is first checked against what is left in the
+     * stream, if it can seek; otherwise, memory grows (by doubling, from READ_CHUNK)
+     * as bytes arrive. Either way, a corrupt or truncated snapshot throws
+     * BadSnapshotException, instead of allocating whatever its header claims.
+     */
+    class Buffer {
+    public:
+        explicit Buffer(std::istream &in) {
+            Header h;
+            if ( ! in.read(reinterpret_cast<char *>(&h), sizeof(Header))) {
+                throw BadSnapshotException("Truncated snapshot");
+            }
+            checkFormat(h);
+            if (h.totalSize < sizeof(Header) || h.totalSize > (std::size_t)-1) {
+                throw BadSnapshotException("Corrupt snapshot");
+            }
+            std::size_t size = (std::size_t)h.totalSize;
+            std::streamoff left = remaining(in);
+            if (left >= 0 && (std::uint64_t)left < size - sizeof(Header)) {
+                throw BadSnapshotException("Truncated snapshot");
+            }
+            std::size_t capacity = (left >= 0) ? size : std::min(size, READ_CHUNK);
+            _data = allocate(capacity);
+            std::memcpy(_data, &h, sizeof(Header));
+            std::size_t filled = sizeof(Header);
+            try {
+                while (filled < size) {
+                    if (filled == capacity) {
+                        capacity = (capacity > size / 2) ? size : capacity * 2;
+                        void *bigger = allocate(capacity);
+                        std::memcpy(bigger, _data, filled);
+                        release(_data);
+                        _data = bigger;
+                    }
+                    if ( ! in.read(static_cast<char *>(_data) + filled, capacity - filled)) {
+                        throw BadSnapshotException("Truncated snapshot");
+                    }
+                    filled = capacity;
+                }
+            } catch (...) {
+                release(_data);
+                throw;
+            }
+            _size = size;
+        }
+
+        ~Buffer() {
+            release(_data);
+        }
+
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        const void *data() const {
+            return _data;
+        }
+
+        std::size_t size() const {
+            return _size;
+        }
+
+    private:
+        static void *allocate(std::size_t size) {
+            return ::operator new(size, std::align_val_t(ALIGNMENT));
+        }
+
+        static void release(void *data) {
+            ::operator delete(data, std::align_val_t(ALIGNMENT));
+        }
+
+        void *_data;
+        std::size_t _size;
+    };
+}
+
+// //
+// MEMORY-MAPPED FILES
+// //
+
+/**
+ * A whole file, mapped read-only into memory (with mmap on POSIX systems; elsewhere,
+ * the snapshot it starts with is read into memory). Views built on it must not
+ * outlive it.
+ */
+class MappedFile {
+public:
+    /** Maps a file; throws BadSnapshotException if it cannot be opened. O(1) */
+    explicit MappedFile(const std::string &path) : _data(nullptr), _size(0) {
+#ifdef __SNAPSHOT_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw BadSnapshotException("Cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw BadSnapshotException("Cannot open " + path);
+        }
+        _size = (std::size_t)st.st_size;
+        if (_size > 0) {
+            void *p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw BadSnapshotException("Cannot map " + path);
+            }
+            _data = p;
+        }
+        ::close(fd); // the mapping stays valid
+#else
+        std::ifstream in(path, std::ios::binary);
+        if ( ! in) {
+            throw BadSnapshotException("Cannot open " + path);
+        }
+        _buffer = new snapshot_detail::Buffer(in);
+        _data = _buffer->data();
+        _size = _buffer->size();
+#endif
+    }
+
+    /** Unmaps the file */
+    ~MappedFile() {
+#ifdef __SNAPSHOT_MMAP
+        if (_data != nullptr) {
+            ::munmap(const_cast<void *>(_data), _size);
+        }
+#else
+        delete _buffer;
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /** Start of the file contents; page-aligned */
+    const void *data() const {
+        return _data;
+    }
+
+    /** Size of the file, in bytes */
+    std::size_t size() const {
+        return _size;
+    }
+
+private:
+    const void *_data;
+    std::size_t _size;
+#ifndef __SNAPSHOT_MMAP
+    snapshot_detail::Buffer *_buffer;
+#endif
+};
+
+// //
+// VIEWS
+// //
+
+/**
+ * Read-only lookups in a HashMap snapshot, without building the map.
+ * Hash must be the hash function of the saved map. contains/at are O(1).
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class HashMapView {
+public:
+    /** View of the snapshot at [data, data + size). O(1) */
+    HashMapView(const void *data, std::size_t size) {
+        snapshot_detail::Header h = snapshot_detail::check(
+            data, size, snapshot_detail::HASH_MAP, sizeof(K), sizeof(V));
+        _count = h.count;
+        _binCount = h.binCount;
+        _keys = snapshot_detail::array<K>(data, h.keysOffset);
+        _values = snapshot_detail::array<V>(data, h.valuesOffset);
+        _bins = snapshot_detail::array<std::uint64_t>(data, h.binsOffset);
+        if (_bins[0] != 0 || _bins[_binCount] != _count) {
+            throw BadSnapshotException("Corrupt snapshot");
+        }
+        if (_count > 0 && mixhash(_hash(_keys[0])) != h.hashCheck) {
+            throw BadSnapshotException("Snapshot saved with another hash function");
+        }
+    }
+
+    /** View of a snapshot that fills a mapped file. O(1) */
+    explicit HashMapView(const MappedFile &file) : HashMapView(file.data(), file.size()) {}
+
+    /** Returns true IFF key in snapshot. O(1) */
+    bool contains(const K &key) const {
+        return findIndex(key) != _count;
+    }
+
+    /** Returns value associated to a key; throws BadKeyException if absent. O(1) */
+    const V &at(const K &key) const {
+        std::uint64_t i = findIndex(key);
+        if (i == _count) {
+            throw BadKeyException();
+        }
+        return _values[i];
+    }
+
+    /** Returns true IFF no entries. O(1) */
+    bool empty() const {
+        return _count == 0;
+    }
+
+    /** Number of entries. O(1) */
+    int size() const {
+        return (int)_count;
+    }
+
+    /** Key of the i-th entry, in snapshot order (by bin). O(1) */
+    const K &key(unsigned int i) const {
+        if (i >= _count) {
+            throw InvalidAccessException();
+        }
+        return _keys[i];
+    }
+
+    /** Value of the i-th entry, in snapshot order (by bin). O(1) */
+    const V &value(unsigned int i) const {
+        if (i >= _count) {
+            throw InvalidAccessException();
+        }
+        return _values[i];
+    }
+
+private:
+    /** Index of the entry with key; _count if not found */
+    std::uint64_t findIndex(const K &key) const {
+        std::uint64_t b = mixhash(_hash(key)) & (_binCount - 1);
+        std::uint64_t first = _bins[b], last = _bins[b + 1];
+        if (first > last || last > _count) {
+            throw BadSnapshotException("Corrupt snapshot");
+        }
+        for (std::uint64_t i = first; i < last; i++) {
+            if (_keys[i] == key) {
+                return i;
+            }
+        }
+        return _count;
+    }
+
+    const K *_keys;
+    const V *_values;
+    const std::uint64_t *_bins;
+    std::uint64_t _count;
+    std::uint64_t _binCount;
+    Hash _hash;
+};
+
+/**
+ * Read-only lookups in a TreeMap snapshot, without building the tree.
+ * Entries are sorted by key; contains/at use binary search, in O(log n).
+ */
+template <typename K, typename V, typename Comparator = std::less<K>>
+class TreeMapView {
+public:
+    /** View of the snapshot at [data, data + size). O(1) */
+    TreeMapView(const void *data, std::size_t size) {
+        snapshot_detail::Header h = snapshot_detail::check(
+            data, size, snapshot_detail::TREE_MAP, sizeof(K), sizeof(V));
+        _count = h.count;
+        _keys = snapshot_detail::array<K>(data, h.keysOffset);
+        _values = snapshot_detail::array<V>(data, h.valuesOffset);
+    }
+
+    /** View of a snapshot that fills a mapped file. O(1) */
+    explicit TreeMapView(const MappedFile &file) : TreeMapView(file.data(), file.size()) {}
+
+    /** Returns true IFF key in snapshot. O(log n) */
+    bool contains(const K &key) const {
+        return findIndex(key) != _count;
+    }
+
+    /** Returns value associated to a key; throws BadKeyException if absent. O(log n) */
+    const V &at(const K &key) const {
+        std::uint64_t i = findIndex(key);
+        if (i == _count) {
+            throw BadKeyException();
+        }
+        return _values[i];
+    }
+
+    /** Returns true IFF no entries. O(1) */
+    bool empty() const {
+        return _count == 0;
+    }
+
+    /** Number of entries. O(1) */
+    int size() const {
+        return (int)_count;
+    }
+
+    /** i-th smallest key. O(1) */
+    const K &key(unsigned int i) const {
+        if (i >= _count) {
+            throw InvalidAccessException();
+        }
+        return _keys[i];
+    }
+
+    /** Value of the i-th smallest key. O(1) */
+    const V &value(unsigned int i) const {
+        if (i >= _count) {
+            throw InvalidAccessException();
+        }
+        return _values[i];
+    }
+
+private:
+    /** Index of the entry with key; _count if not found */
+    std::uint64_t findIndex(const K &key) const {
+        const K *p = std::lower_bound(_keys, _keys + _count, key, _cless);
+        return (p != _keys + _count && ! _cless(key, *p)) ? p - _keys : _count;
+    }
+
+    const K *_keys;
+    const V *_values;
+    std::uint64_t _count;
+    Comparator _cless;
+};
+
+/**
+ * Read-only lookups in a TreeSet snapshot, without building the tree.
+ * Elements are sorted; contains uses binary search, in O(log n).
+ */
+template <typename T, typename Comparator = std::less<T>>
+class TreeSetView {
+public:
+    /** View of the snapshot at [data, data + size). O(1) */
+    TreeSetView(const void *data, std::size_t size) {
+        snapshot_detail::Header h = snapshot_detail::check(
+            data, size, snapshot_detail::TREE_SET, sizeof(T), 0);
+        _count = h.count;
+        _elems = snapshot_detail::array<T>(data, h.keysOffset);
+    }
+
+    /** View of a snapshot that fills a mapped file. O(1) */
+    explicit TreeSetView(const MappedFile &file) : TreeSetView(file.data(), file.size()) {}
+
+    /** Returns true IFF elem in snapshot. O(log n) */
+    bool contains(const T &elem) const {
+        const T *p = std::lower_bound(_elems, _elems + _count, elem, _cless);
+        return p != _elems + _count && ! _cless(elem, *p);
+    }
+
+    /** Returns true IFF no elements. O(1) */
+    bool empty() const {
+        return _count == 0;
+    }
+
+    /** Number of elements. O(1) */
+    int size() const {
+        return (int)_count;
+    }
+
+    /** i-th smallest element. O(1) */
+    const T &key(unsigned int i) const {
+        if (i >= _count) {
+            throw InvalidAccessException();
+        }
+        return _elems[i];
+    }
+
+private:
+    const T *_elems;
+    std::uint64_t _count;
+    Comparator _cless;
+};
+
+// //
+// SAVING AND LOADING
+// //
+
+/** Writes a snapshot of a HashMap; entries are grouped by bin (counting sort). O(n) */
+template <typename K, typename V, typename Hash>
+void save_snapshot(const HashMap<K, V, Hash> &map, std::ostream &out) {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "Snapshots require trivially-copyable keys and values");
+    using namespace snapshot_detail;
+    std::uint64_t n = map.size();
+    Header h = makeHeader(HASH_MAP, sizeof(K), sizeof(V), n);
+    h.binCount = 1;
+    while (h.binCount < n) {
+        h.binCount *= 2;
+    }
+    // bins[b + 1] counts the keys of bin b; prefix sums then give where bins start
+    Hash hash;
+    std::vector<std::uint64_t> bins(h.binCount + 1, 0);
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        bins[(mixhash(hash(it.key())) & (h.binCount - 1)) + 1]++;
+    }
+    for (std::uint64_t b = 0; b < h.binCount; b++) {
+        bins[b + 1] += bins[b];
+    }
+    std::vector<std::uint64_t> next(bins.begin(), bins.end() - 1);
+    std::vector<unsigned char> keys(n * sizeof(K)), values(n * sizeof(V));
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        std::uint64_t i = next[mixhash(hash(it.key())) & (h.binCount - 1)]++;
+        std::memcpy(keys.data() + i * sizeof(K), &it.key(), sizeof(K));
+        std::memcpy(values.data() + i * sizeof(V), &it.value(), sizeof(V));
+        if (i == 0) {
+            h.hashCheck = mixhash(hash(it.key()));
+        }
+    }
+    layout(h);
+    write(out, h, keys.data(), values.data(), bins.data());
+}
+
+/** Writes a snapshot of a TreeMap; entries are written in order. O(n) */
+template <typename K, typename V, typename Comparator, bool Ranked>
+void save_snapshot(const TreeMap<K, V, Comparator, Ranked> &map, std::ostream &out) {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "Snapshots require trivially-copyable keys and values");
+    using namespace snapshot_detail;
+    std::uint64_t n = map.size();
+    Header h = makeHeader(TREE_MAP, sizeof(K), sizeof(V), n);
+    std::vector<unsigned char> keys(n * sizeof(K)), values(n * sizeof(V));
+    std::uint64_t i = 0;
+    for (auto it = map.cbegin(); it != map.cend(); ++it, ++i) {
+        std::memcpy(keys.data() + i * sizeof(K), &it.key(), sizeof(K));
+        std::memcpy(values.data() + i * sizeof(V), &it.value(), sizeof(V));
+    }
+    layout(h);
+    write(out, h, keys.data(), values.data(), nullptr);
+}
+
+/** Writes a snapshot of a TreeSet; elements are written in order. O(n) */
+template <typename T, typename Comparator, bool Ranked>
+void save_snapshot(const TreeSet<T, Comparator, Ranked> &set, std::ostream &out) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Snapshots require trivially-copyable elements");
+    using namespace snapshot_detail;
+    std::vector<unsigned char> elems; // TreeSets do not keep their size: counted here
+    std::uint64_t n = 0;
+    for (auto it = set.cbegin(); it != set.cend(); ++it, ++n) {
+        elems.resize((n + 1) * sizeof(T));
+        std::memcpy(elems.data() + n * sizeof(T), &it.elem(), sizeof(T));
+    }
+    Header h = makeHeader(TREE_SET, sizeof(T), 0, n);
+    layout(h);
+    write(out, h, elems.data(), nullptr, nullptr);
+}
+
+/** Replaces the contents of map with those of the snapshot read from in. O(n) */
+template <typename K, typename V, typename Hash>
+void load_snapshot(std::istream &in, HashMap<K, V, Hash> &map) {
+    snapshot_detail::Buffer buffer(in);
+    HashMapView<K, V, Hash> view(buffer.data(), buffer.size());
+    map = HashMap<K, V, Hash>();
+    map.reserve(view.size());
+    for (int i = 0; i < view.size(); i++) {
+        map.insert(view.key(i), view.value(i));
+    }
+}
+
+/** Replaces the contents of map with those of the snapshot read from in. O(n) */
+template <typename K, typename V, typename Comparator, bool Ranked>
+void load_snapshot(std::istream &in, TreeMap<K, V, Comparator, Ranked> &map) {
+    snapshot_detail::Buffer buffer(in);
+    TreeMapView<K, V, Comparator> view(buffer.data(), buffer.size());
+    std::vector<std::pair<K, V>> entries;
+    entries.reserve(view.size());
+    for (int i = 0; i < view.size(); i++) {
+        entries.emplace_back(view.key(i), view.value(i));
+    }
+    map.assign_sorted(entries.begin(), entries.end());
+}
+
+/** Replaces the contents of set with those of the snapshot read from in. O(n) */
+template <typename T, typename Comparator, bool Ranked>
+void load_snapshot(std::istream &in, TreeSet<T, Comparator, Ranked> &set) {
+    snapshot_detail::Buffer buffer(in);
+    TreeSetView<T, Comparator> view(buffer.data(), buffer.size());
+    std::vector<T> elems;
+    elems.reserve(view.size());
+    for (int i = 0; i < view.size(); i++) {
+        elems.push_back(view.key(i));
+    }
+    set.assign_sorted(elems.begin(), elems.end());
+}
+
+#endif // __SNAPSHOT_H
@@ -8,47 +8,101 @@
 #define __STACK_H
 
 #include "Exceptions.h"
+#include "Stats.h"      // Optional counters, see stats()
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>      // malloc, realloc, free
+#include <cstring>      // memcpy
+#include <new>          // placement new, bad_alloc
+#include <type_traits>  // is_trivially_copyable
+#include <utility>      // move, forward
 
 /**
  * Implementation of a Stack ADT using a dynamic array.
  * Operations are:
  *   - EmptyStack: -> Stack. Generator (empty constructor)
- *   - push: Stack, Elem -> Stack. Generator
+ *   - push: Stack, Elem -> Stack. Generator. Also emplace(args...), building from arguments
  *   - pop: Stack -> Stack. Partial modifier
  *   - top: Stack -> Elem. Partial observer
  *   - empty: Stack -> Bool. Observer
  *   - size: Stack -> Int. Observer
+ * And, to control memory use:
+ *   - capacity(): observer. Elements that fit before the array must grow
+ *   - reserve(n): mutator. Makes room for at least n elements
+ *   - shrink_to_fit(): mutator. Releases all unused capacity
+ *   - growth_factor(), growth_factor(f): observer and mutator. How much
+ *          capacity is multiplied by each time the array grows
+ *   - stats(): observer, only with ADT_STATS. Resizes and allocations of the
+ *          array, as a StackStats (see Stats.h)
+ *
+ * The array is NOT built with new T[]: unused positions are left
+ * uninitialized, elements are built in place when pushed, and destroyed when
+ * popped. Trivially-copyable elements are relocated with realloc/memcpy;
+ * others are moved one by one into the new array.
  */
 template <class T>
 class Stack {
 public:
 
-    /** Initial size of dynamic array. */
+    /** Capacity allocated by the first push. */
     static const int INITIAL_CAPACITY = 10;
 
-    /** Ctor; EmptyStack operation */
+    /** Default growth factor: capacity doubles each time it runs out */
+    static constexpr float DEFAULT_GROWTH_FACTOR = 2.0f;
+
+    /** Ctor; EmptyStack operation. Does not allocate anything */
     Stack() {
         init();
     }
 
-    /** Dtor; frees vector. */
+    /** Dtor; destroys elements and frees array. */
     ~Stack() {
         free();
     }
 
     /** Pushes an element. Generator. O(1) (amortized) */
     void push(const T &_elem) {
-        _data[_size] = _elem;
-        _size++;
-        if (_size == _max) {
-            grow(); // full, must grow
+        emplace(_elem);
+    }
+
+    /** Pushes an element, moving it instead of copying it. Generator. O(1) (amortized) */
+    void push(T &&_elem) {
+        emplace(std::move(_elem));
+    }
+
+    /**
+     * Pushes an element built in place from the given constructor arguments.
+     * Arguments may refer to elements of this same stack.
+     * Generator. O(1) (amortized)
+     */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        if (_size < _max) {
+            new (_data + _size) T(std::forward<Args>(args)...);
+        } else if constexpr (RELOCATE_BY_COPY) {
+            T elem(std::forward<Args>(args)...); // args may be in the array that realloc frees
+            reallocate(nextCapacity());
+            new (_data + _size) T(elem);
+        } else {
+            // build new element in the new array, before old ones are moved out
+            unsigned int max = nextCapacity();
+            T *data = allocate(max);
+            try {
+                new (data + _size) T(std::forward<Args>(args)...);
+            } catch (...) {
+                std::free(data);
+                throw;
+            }
+            relocate(data);
+            _max = max;
+            ADT_STAT(_resizes.add());
         }
+        _size++;
     }
-    
+
     /**
-     * Pops an element (whichever was pushed last). 
+     * Pops an element (whichever was pushed last), and destroys it.
+     * Capacity is kept; see shrink_to_fit().
      * Partial modifier (fails if empty). O(1)
      */
     void pop() {
@@ -56,6 +110,7 @@ public:
             throw EmptyStackException("Cannot pop. The stack is empty");
         }
         --_size;
+        _data[_size].~T();
     }
 
     /**
@@ -79,6 +134,64 @@ public:
         return _size;
     }
 
+    /** Returns number of elements that fit before the array must grow. Observer. O(1) */
+    int capacity() const {
+        return _max;
+    }
+
+    /**
+     * Makes sure that n elements fit without growing again; never shrinks.
+     * Mutator. O(size()) if the array must grow, O(1) otherwise
+     */
+    void reserve(unsigned int n) {
+        if (n > _max) {
+            reallocate(n);
+        }
+    }
+
+    /**
+     * Reduces capacity to the current size, releasing the array altogether
+     * if empty. Mutator. O(size())
+     */
+    void shrink_to_fit() {
+        if (_size < _max) {
+            reallocate(_size);
+        }
+    }
+
+    /** Returns the current growth factor. Observer. O(1) */
+    float growth_factor() const {
+        return _growthFactor;
+    }
+
+    /**
+     * Changes the growth factor used by future growth. Must be > 1;
+     * capacity grows by at least 1 element even if f is close to 1.
+     * Mutator. O(1)
+     */
+    void growth_factor(float f) {
+        if ( ! (f > 1)) {
+            throw InvalidAccessException("Growth factor must be greater than 1");
+        }
+        _growthFactor = f;
+    }
+
+#ifdef ADT_STATS
+    /**
+     * Capacity changes (including the first push) and array allocations
+     * (including reallocs) so far. Observer. O(1)
+     */
+    StackStats stats() const {
+        StackStats s;
+        s.size = _size;
+        s.capacity = _max;
+        s.resizes = _resizes.get();
+        s.alloc.allocations = _allocations.get();
+        s.alloc.bytes = _bytes.get();
+        return s;
+    }
+#endif
+
     // //
     // C++ Boilerplate code to make class more useful
     // //
@@ -97,6 +210,23 @@ public:
         return *this;
     }
 
+    /**
+     * Move constructor; takes over the array of other, which is left empty
+     * (and without an array, until it is next pushed onto). O(1)
+     */
+    Stack(Stack<T> &&other) noexcept {
+        moveFrom(other);
+    }
+
+    /** Move assignment; frees current array and takes over that of other. O(n) */
+    Stack<T> &operator=(Stack<T> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
     /** Equality operator. O(n) */
     bool operator==(const Stack<T> &rhs) const {
         if (_size != rhs._size) {
@@ -125,48 +255,133 @@ public:
 
 protected:
 
-    /** creates a dynamic array with the initial capacity and no elements */
+    /** If true, elements can be moved around as raw bytes */
+    static const bool RELOCATE_BY_COPY = std::is_trivially_copyable<T>::value;
+
+    /** empty stack, without an array; the 1st push allocates INITIAL_CAPACITY */
     void init() {
-        _data = new T[INITIAL_CAPACITY];
-        _max = INITIAL_CAPACITY;
+        _data = nullptr;
+        _max = 0;
         _size = 0;
+        _growthFactor = DEFAULT_GROWTH_FACTOR;
     }
 
+    /** destroys all elements, and frees the array */
     void free() {
-        delete []_data;
-        _data = NULL;
+        if constexpr ( ! std::is_trivially_destructible<T>::value) {
+            for (unsigned int i = 0; i < _size; ++i) {
+                _data[i].~T();
+            }
+        }
+        std::free(_data);
+        _data = nullptr;
+    }
+
+    /** Takes over the array of other, which is left empty and without array */
+    void moveFrom(Stack &other) {
+        _data = other._data;
+        _max = other._max;
+        _size = other._size;
+        _growthFactor = other._growthFactor;
+        other._data = nullptr;
+        other._max = 0;
+        other._size = 0;
     }
 
     void copy(const Stack &other) {
         _max = other._size + INITIAL_CAPACITY;
-        _size = other._size;
-        _data = new T[_max];
-        for (unsigned int i = 0; i < _size; ++i) {
-            _data[i] = other._data[i];
+        _size = 0;
+        _growthFactor = other._growthFactor;
+        _data = allocate(_max);
+        if constexpr (RELOCATE_BY_COPY) {
+            if (other._size > 0) {
+                std::memcpy(static_cast<void *>(_data), other._data, other._size * sizeof(T));
+            }
+            _size = other._size;
+        } else {
+            try {
+                for (; _size < other._size; ++_size) {
+                    new (_data + _size) T(other._data[_size]);
+                }
+            } catch (...) {
+                free();
+                _max = 0;
+                throw;
+            }
         }
     }
 
-    /** creates 2x bigger backing array, copying over data and freeing old array */
-    void grow() {
-        T *old = _data;
-        _max *= 2;
-        _data = new T[_max];
-        for (unsigned int i = 0; i < _size; ++i)
-            _data[i] = old[i];
+    /** capacity after the next growth: INITIAL_CAPACITY, or _max * _growthFactor */
+    unsigned int nextCapacity() const {
+        if (_max == 0) {
+            return INITIAL_CAPACITY;
+        }
+        unsigned int max = static_cast<unsigned int>(_max * _growthFactor);
+        return (max > _max) ? max : _max + 1;
+    }
 
-        delete []old;
+    /** uninitialized room for max elements; nullptr if max is 0 */
+    T *allocate(unsigned int max) {
+        if (max == 0) {
+            return nullptr;
+        }
+        T *data = static_cast<T *>(std::malloc(max * sizeof(T)));
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+        ADT_STAT(_allocations.add(); _bytes.add(max * sizeof(T)));
+        return data;
+    }
+
+    /** moves all elements to data, an array with room for them, and frees the old one */
+    void relocate(T *data) {
+        for (unsigned int i = 0; i < _size; ++i) {
+            new (data + i) T(std::move(_data[i]));
+            _data[i].~T();
+        }
+        std::free(_data);
+        _data = data;
+    }
+
+    /** changes capacity to max, which must be >= _size */
+    void reallocate(unsigned int max) {
+        if constexpr (RELOCATE_BY_COPY) {
+            if (max == 0) {
+                std::free(_data);
+                _data = nullptr;
+            } else {
+                void *data = std::realloc(static_cast<void *>(_data), max * sizeof(T));
+                if (data == nullptr) {
+                    throw std::bad_alloc();
+                }
+                _data = static_cast<T *>(data);
+                ADT_STAT(_allocations.add(); _bytes.add(max * sizeof(T)));
+            }
+        } else {
+            relocate(allocate(max));
+        }
+        _max = max;
+        ADT_STAT(_resizes.add());
     }
 
 private:
 
-    /** Pointer to data. */
+    /** Pointer to data; only the first _size positions hold built elements. */
     T * _data;
 
-    /** Capacity of array (as reserved via new[]). */
+    /** Capacity of array (as reserved via malloc). */
     unsigned int _max;
 
     /** Actual number of stored elements. */
     unsigned int _size;
+
+    /** Capacity is multiplied by this each time the array grows */
+    float _growthFactor;
+
+#ifdef ADT_STATS
+    /** Capacity changes, array allocations and their total size in bytes */
+    StatCounter _resizes, _allocations, _bytes;
+#endif
 };
 
 /** Output operator, for use with streams */
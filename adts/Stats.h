@@ -0,0 +1,176 @@
+/**
+ * Optional instrumentation of ADTs
+ *
+ * Compiling with ADT_STATS defined (-DADT_STATS, or a #define before including
+ * any ADT) adds counters to HashMap, TreeMap, TreeSet, Stack and NodePool, and a
+ * stats() observer to the first four. It returns a snapshot of their counters and
+ * of their current shape, which can be printed as JSON with to_json():
+ *    - HashMapStats: bins, entries, histogram of chain lengths, lookups and keys
+ *          compared by them (probes), and number and total time of grow()s.
+ *    - TreeStats: nodes, histogram of node depths, and lookups made through findAux
+ *          (at and contains) and key comparisons made by them.
+ *    - StackStats: size, capacity and number of times the array was resized.
+ *    - all of them: heap allocations made by the container, and bytes requested.
+ * Counters are cumulative, and belong to each container object: clear() does not
+ * reset them, moves and swaps do not exchange them, and copies start at zero.
+ * Lookups made through const references, even from several threads (see
+ * ConcurrentHashMap), are counted with relaxed atomic increments.
+ *
+ * Without ADT_STATS, neither the counters nor the code that updates them are
+ * compiled: containers have the same size and speed as if this file did not exist.
+ */
+#ifndef __STATS_H
+#define __STATS_H
+
+/** Expands to its arguments only in stats mode; used for one-line counter updates */
+#ifdef ADT_STATS
+#define ADT_STAT(...) __VA_ARGS__
+#else
+#define ADT_STAT(...)
+#endif
+
+#ifdef ADT_STATS
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Event counter that can be incremented from const lookups. Copies start at 0,
+ * so that copying a container does not copy its history.
+ */
+class StatCounter {
+public:
+    StatCounter() : _count(0) {}
+    StatCounter(const StatCounter &) : _count(0) {}
+    StatCounter &operator=(const StatCounter &) { return *this; }
+
+    void add(unsigned long n = 1) const {
+        _count.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    unsigned long get() const {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+private:
+    mutable std::atomic<unsigned long> _count;
+};
+
+/** Nanoseconds elapsed since start, for timing operations such as HashMap::grow */
+inline unsigned long stat_nanos_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+namespace stats_detail {
+
+    inline void writeHistogram(std::ostream &out, const std::vector<unsigned int> &h) {
+        out << "[";
+        for (std::size_t i = 0; i < h.size(); i++) {
+            out << (i ? "," : "") << h[i];
+        }
+        out << "]";
+    }
+
+    /** Adds 1 to h[i], growing h as needed */
+    inline void count(std::vector<unsigned int> &h, unsigned int i) {
+        if (i >= h.size()) {
+            h.resize(i + 1, 0);
+        }
+        h[i]++;
+    }
+}
+
+/** Heap memory requested by a container since it was built */
+struct AllocStats {
+    unsigned long allocations = 0;
+    unsigned long bytes = 0;
+
+    AllocStats &operator+=(const AllocStats &other) {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"allocations\":" << allocations << ",\"bytes\":" << bytes << "}";
+        return out.str();
+    }
+};
+
+/** Snapshot of the counters and shape of a HashMap */
+struct HashMapStats {
+    unsigned int bins = 0;
+    unsigned int entries = 0;
+    /** chainLengths[k] is the number of bins that hold k entries */
+    std::vector<unsigned int> chainLengths;
+    /** Bins searched for a key; while migrating, some keys need 2 */
+    unsigned long lookups = 0;
+    /** Entries whose key was compared while searching */
+    unsigned long probes = 0;
+    unsigned long grows = 0;
+    double growSeconds = 0;
+    AllocStats alloc;
+
+    double probesPerLookup() const {
+        return lookups ? static_cast<double>(probes) / lookups : 0;
+    }
+
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"bins\":" << bins << ",\"entries\":" << entries << ",\"chain_lengths\":";
+        stats_detail::writeHistogram(out, chainLengths);
+        out << ",\"lookups\":" << lookups << ",\"probes\":" << probes
+            << ",\"probes_per_lookup\":" << probesPerLookup()
+            << ",\"grows\":" << grows << ",\"grow_seconds\":" << growSeconds
+            << ",\"alloc\":" << alloc.to_json() << "}";
+        return out.str();
+    }
+};
+
+/** Snapshot of the counters and shape of a TreeMap or TreeSet */
+struct TreeStats {
+    unsigned int nodes = 0;
+    /** depths[d] is the number of nodes at depth d; the root is at depth 0 */
+    std::vector<unsigned int> depths;
+    unsigned long lookups = 0;
+    unsigned long comparisons = 0;
+    AllocStats alloc;
+
+    double comparisonsPerLookup() const {
+        return lookups ? static_cast<double>(comparisons) / lookups : 0;
+    }
+
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"nodes\":" << nodes << ",\"depths\":";
+        stats_detail::writeHistogram(out, depths);
+        out << ",\"lookups\":" << lookups << ",\"comparisons\":" << comparisons
+            << ",\"comparisons_per_lookup\":" << comparisonsPerLookup()
+            << ",\"alloc\":" << alloc.to_json() << "}";
+        return out.str();
+    }
+};
+
+/** Snapshot of the counters and shape of a Stack */
+struct StackStats {
+    unsigned int size = 0;
+    unsigned int capacity = 0;
+    unsigned long resizes = 0;
+    AllocStats alloc;
+
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"size\":" << size << ",\"capacity\":" << capacity
+            << ",\"resizes\":" << resizes << ",\"alloc\":" << alloc.to_json() << "}";
+        return out.str();
+    }
+};
+
+#endif // ADT_STATS
+
+#endif // __STATS_H
@@ -0,0 +1,888 @@
+/**
+ * Map ADT using a "Swiss table": a flat hash table probed 16 slots at a time
+ * Same interface as HashMap.h, but keys and values live inline in a single
+ * array of slots, and a separate array holds one control byte per slot.
+ */
+
+#ifndef __SWISSHASHMAP_H
+#define __SWISSHASHMAP_H
+
+#include <iostream>
+#include <cstdint>
+#include <new>      // placement new
+#include <utility>
+#include "Exceptions.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define __SWISS_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define __SWISS_NEON
+#endif
+
+/**
+ * Control bytes and groups of them, as scanned by SwissHashMap.
+ * A control byte is EMPTY, DELETED (a tombstone), or, for slots in use, the
+ * 7 highest bits of the hash of their key (so, never negative).
+ * A Group loads 16 consecutive control bytes, and compares all of them at once,
+ * with SSE2 or NEON instructions where available (one byte at a time elsewhere).
+ */
+namespace swiss_detail {
+
+    static const std::int8_t EMPTY = -128;   // 0b10000000
+    static const std::int8_t DELETED = -2;   // 0b11111110
+
+    /** Index of the lowest bit set of a non-zero mask */
+    inline unsigned int lowestBit(std::uint64_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(mask);
+#else
+        unsigned int i = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+
+    /**
+     * Set of positions within a group, as returned by Group::match*().
+     * On NEON, each position is 4 bits wide (and only the highest of them is set).
+     */
+    class BitMask {
+    public:
+#ifdef __SWISS_NEON
+        static const unsigned int SHIFT = 2;
+#else
+        static const unsigned int SHIFT = 0;
+#endif
+        explicit BitMask(std::uint64_t bits) : _bits(bits) {}
+
+        /** True IFF any position left */
+        explicit operator bool() const {
+            return _bits != 0;
+        }
+
+        /** Lowest position left; there must be one */
+        unsigned int lowest() const {
+            return lowestBit(_bits) >> SHIFT;
+        }
+
+        /** Removes the lowest position */
+        void dropLowest() {
+            _bits &= _bits - 1;
+        }
+
+    private:
+        std::uint64_t _bits;
+    };
+
+    /** 16 consecutive control bytes */
+    class Group {
+    public:
+        static const unsigned int WIDTH = 16;
+
+#if defined(__SWISS_SSE2)
+        explicit Group(const std::int8_t *ctrl)
+            : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+        /** Positions whose control byte is h2 */
+        BitMask match(std::int8_t h2) const {
+            return BitMask((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+        }
+
+        /** Positions that are EMPTY */
+        BitMask matchEmpty() const {
+            return match(EMPTY);
+        }
+
+        /** Positions that are EMPTY or DELETED: those with the sign bit set */
+        BitMask matchFree() const {
+            return BitMask((unsigned int)_mm_movemask_epi8(_ctrl));
+        }
+
+    private:
+        __m128i _ctrl;
+#elif defined(__SWISS_NEON)
+        explicit Group(const std::int8_t *ctrl) : _ctrl(vld1q_s8(ctrl)) {}
+
+        BitMask match(std::int8_t h2) const {
+            return toMask(vceqq_s8(vdupq_n_s8(h2), _ctrl));
+        }
+
+        BitMask matchEmpty() const {
+            return match(EMPTY);
+        }
+
+        BitMask matchFree() const {
+            return toMask(vcltq_s8(_ctrl, vdupq_n_s8(0)));
+        }
+
+    private:
+        /** Narrows 16 bytes of all-0s or all-1s into 16 nibbles, keeping the top bit of each */
+        static BitMask toMask(uint8x16_t bytes) {
+            uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4);
+            return BitMask(vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull);
+        }
+
+        int8x16_t _ctrl;
+#else
+        explicit Group(const std::int8_t *ctrl) : _ctrl(ctrl) {}
+
+        BitMask match(std::int8_t h2) const {
+            std::uint64_t bits = 0;
+            for (unsigned int i = 0; i < WIDTH; i++) {
+                bits |= (std::uint64_t)(_ctrl[i] == h2) << i;
+            }
+            return BitMask(bits);
+        }
+
+        BitMask matchEmpty() const {
+            return match(EMPTY);
+        }
+
+        BitMask matchFree() const {
+            std::uint64_t bits = 0;
+            for (unsigned int i = 0; i < WIDTH; i++) {
+                bits |= (std::uint64_t)(_ctrl[i] < 0) << i;
+            }
+            return BitMask(bits);
+        }
+
+    private:
+        const std::int8_t *_ctrl;
+#endif
+    };
+}
+
+/**
+ * Map using a Swiss table: open addressing, probing whole groups of 16 slots
+ *
+ * The hash of a key is split in two: its 7 highest bits (h2) are stored in the
+ * control byte of the slot that holds the key, and the bits just below them (h1)
+ * select the group where probing starts. A lookup compares h2 against the 16 control bytes of
+ * a group at once, and only calls operator== on keys whose control byte matches
+ * (a false match happens with probability 1/128 per slot in use). A lookup stops
+ * at the first group that has an empty slot; since the table is kept at most
+ * 7/8 full, most misses are decided by a single group comparison, without
+ * looking at any key.
+ * Groups are probed quadratically (0, 1, 3, 6, ... groups away from the first),
+ * which visits every group of a power-of-2 table. Erasing leaves a DELETED mark
+ * only if the group of the slot was full, since only then may other keys have
+ * probed past it; tombstones are cleared when the table is rebuilt.
+ *
+ * Requires keys to support a hash function (see HashMap.h) and operator==.
+ * Operations are:
+ *    - SwissHashMap constructor: generator
+ *    - insert(key, value): generator, adds a new (key, value) pair to the map.
+ *          If the key was already present, replaces its value with the new one.
+ *          Keys and values passed as rvalues are moved instead of copied.
+ *    - try_emplace(key, args...): generator, adds key with a value built from args,
+ *          if the key was not already present.
+ *    - erase(key): mutator. Removes the key from the map. No effect if key absent.
+ *    - at(key): observer. Returns value that corresponds to a key.
+ *          Partial: key must exist; use contains() first if unsure.
+ *    - contains(key): observer. Returnes true iff key exists in map
+ *    - empty(): observer. Returns true if no keys present.
+ *    - size(): observer. Returns count of currently-contained keys.
+ *
+ * Entries never move once inserted, but all of them do when the table grows:
+ * inserting may invalidate any iterator or reference to a value. Erasing only
+ * invalidates those to the erased entry.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class SwissHashMap {
+private:
+    /**
+     * A key-value pair, as stored in the table
+     */
+    class Entry {
+    public:
+        template <typename KK, typename... Args>
+        Entry(KK &&key, Args&&... args) : _key(std::forward<KK>(key)), _value(std::forward<Args>(args)...) {}
+
+        K _key;
+        V _value;
+    };
+
+    /**
+     * A table slot. The entry is only constructed while the
+     * control byte of the slot says that it is in use.
+     */
+    class Slot {
+    public:
+        Slot() {}
+        ~Slot() {}
+
+        union {
+            Entry _entry;
+        };
+    };
+
+    using Group = swiss_detail::Group;
+    using BitMask = swiss_detail::BitMask;
+
+public:
+
+    /** Initial table size (number of slots). Must be a power of 2, and at least Group::WIDTH */
+    static const int INITIAL_CAPACITY = 16;
+
+    /** Constructor; returns an empty SwissHashMap. O(1) */
+    SwissHashMap() : _entryCount(0) {
+        init(INITIAL_CAPACITY);
+    }
+
+    /** Destructor; destroys entries in O(capacity) */
+    ~SwissHashMap() {
+        free();
+    }
+
+    /**
+     * Adds a new key, value pair to the map. If key
+     * already present, replaces old value with new one.
+     * generator, O(1) amortized cost.
+     */
+    void insert(const K &key, const V &value) {
+        std::uint64_t h = hashOf(key);
+        unsigned int idx = findSlot(key, h);
+        if (idx != _capacity) { // key exists: overwrite value
+            _slots[idx]._entry._value = value;
+        } else {
+            insertNew(h, key, value);
+        }
+    }
+
+    /**
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(1) amortized cost.
+     */
+    void insert(K &&key, V &&value) {
+        std::uint64_t h = hashOf(key);
+        unsigned int idx = findSlot(key, h);
+        if (idx != _capacity) { // key exists: overwrite value
+            _slots[idx]._entry._value = std::move(value);
+        } else {
+            insertNew(h, std::move(key), std::move(value));
+        }
+    }
+
+    /**
+     * If key is not present, adds it, with a value built in place from args.
+     * No effect (and args not used) if key already present.
+     * Returns true IFF the key was added.
+     * generator, O(1) amortized cost.
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        std::uint64_t h = hashOf(key);
+        if (findSlot(key, h) != _capacity) {
+            return false;
+        }
+        insertNew(h, key, std::forward<Args>(args)...);
+        return true;
+    }
+
+    /** Same as try_emplace(key, args...), but moves key if added. */
+    template <typename... Args>
+    bool try_emplace(K &&key, Args&&... args) {
+        std::uint64_t h = hashOf(key);
+        if (findSlot(key, h) != _capacity) {
+            return false;
+        }
+        insertNew(h, std::move(key), std::forward<Args>(args)...);
+        return true;
+    }
+
+    /**
+     * Removes a key, value pair from the map.
+     * No effect if key not there in the first place.
+     * mutator, O(1)
+     */
+    void erase(const K &key) {
+        unsigned int idx = findSlot(key, hashOf(key));
+        if (idx == _capacity) {
+            return;
+        }
+        _slots[idx]._entry.~Entry();
+        // If the group already has an empty slot, no probe ever went past it,
+        // so the slot can become empty again; otherwise, leave a tombstone
+        const std::int8_t *group = _ctrl + (idx & ~(Group::WIDTH - 1));
+        if (Group(group).matchEmpty()) {
+            _ctrl[idx] = swiss_detail::EMPTY;
+            _growthLeft++;
+        } else {
+            _ctrl[idx] = swiss_detail::DELETED;
+        }
+        _entryCount--;
+    }
+
+    /**
+     * Returns value associated to a key.
+     * Partial - if key not present, throws exception. Use contains() if unsure
+     * observer, O(1)
+     */
+    const V &at(const K &key) const {
+        unsigned int idx = findSlot(key, hashOf(key));
+        if (idx == _capacity) {
+            throw BadKeyException();
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    /**
+     * Returns true IFF key in map
+     * observer, O(1)
+     */
+    bool contains(const K &key) const {
+        return findSlot(key, hashOf(key)) != _capacity;
+    }
+
+    /**
+     * Returns true IFF no elements in map
+     * observer, O(1)
+     */
+    bool empty() const {
+        return _entryCount == 0;
+    }
+
+    /**
+     * Returns number of keys in map.
+     * observer, O(1)
+     */
+    int size() const {
+        return _entryCount;
+    }
+
+    /**
+     * Overloads the [] operator, to access (and possibly modify) a value given its key.
+     * If the key is not present, inserts a new (default) value for that key.
+     */
+    V &operator[](const K &key) {
+        std::uint64_t h = hashOf(key);
+        unsigned int idx = findSlot(key, h);
+        if (idx == _capacity) { // Not there, must add
+            idx = insertNew(h, key);
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    /** Same as operator[](key), but moves key if it must be added. */
+    V &operator[](K &&key) {
+        std::uint64_t h = hashOf(key);
+        unsigned int idx = findSlot(key, h);
+        if (idx == _capacity) { // Not there, must add
+            idx = insertNew(h, std::move(key));
+        }
+        return _slots[idx]._entry._value;
+    }
+
+    // //
+    // NON-CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Allows changing values (but not keys)
+     */
+    class Iterator {
+    public:
+        Iterator() : _table(nullptr), _idx(0) {}
+
+        /** O(1) amortized. */
+        void next() {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            _idx = _table->nextUsed(_idx + 1);
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._key;
+        }
+
+        /** O(1) */
+        V &value() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._value;
+        }
+
+        /** O(1) */
+        bool operator==(const Iterator &other) const {
+            return _idx == other._idx;
+        }
+
+        /** O(1) */
+        bool operator!=(const Iterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        Iterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        Iterator operator++(int) {
+            Iterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class SwissHashMap;
+        friend class ConstIterator;
+
+        Iterator(const SwissHashMap *table, unsigned int idx)
+            : _table(table), _idx(idx) { }
+
+        /** Pointer to hash table being iterated */
+        const SwissHashMap *_table;
+
+        /** Current slot index; _table->_capacity when at end */
+        unsigned int _idx;
+    };
+
+    /**
+     * Returns a non-constant map iterator starting at the "first" element.
+     * Note that hash tables are not really ordered.
+     * O(capacity) worst-case
+     */
+    Iterator begin() const {
+        return Iterator(this, nextUsed(0));
+    }
+
+    /**
+     * Returns a non-constant map iterator just outside the map, reachable by an iterator
+     * that starts at begin()
+     * O(1)
+     */
+    Iterator end() const {
+        return Iterator(this, _capacity);
+    }
+
+    /**
+     * Returns an iterator to a the location of a key.
+     * If key not found, returns end().
+     */
+    Iterator find(const K &key) {
+        return Iterator(this, findSlot(key, hashOf(key)));
+    }
+
+    // //
+    // CONSTANT ITERATOR
+    // //
+
+    /**
+     * An iterator that allows walking through the whole map.
+     * Does not allow any changes
+     */
+    class ConstIterator {
+    public:
+        ConstIterator() : _table(nullptr), _idx(0) {}
+
+        /** Converts an Iterator to a ConstIterator */
+        ConstIterator(const Iterator& it) : _table(it._table), _idx(it._idx) {}
+
+        /** O(1) amortized. */
+        void next() {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            _idx = _table->nextUsed(_idx + 1);
+        }
+
+        /** O(1) */
+        const K &key() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._key;
+        }
+
+        /** O(1) */
+        const V &value() const {
+            if (_table == nullptr || _idx == _table->_capacity) {
+                throw InvalidAccessException();
+            }
+            return _table->_slots[_idx]._entry._value;
+        }
+
+        /** O(1) */
+        bool operator==(const ConstIterator &other) const {
+            return _idx == other._idx;
+        }
+
+        /** O(1) */
+        bool operator!=(const ConstIterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        /** O(1) */
+        ConstIterator &operator++() {
+            next();
+            return *this;
+        }
+
+        /** O(1) */
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        friend class SwissHashMap;
+
+        ConstIterator(const SwissHashMap *table, unsigned int idx)
+            : _table(table), _idx(idx) { }
+
+        /** Pointer to hash table being iterated */
+        const SwissHashMap *_table;
+
+        /** Current slot index; _table->_capacity when at end */
+        unsigned int _idx;
+    };
+
+    /**
+     * Returns a constant map iterator starting at the "first" element.
+     * Note that hash tables are not really ordered.
+     * O(capacity) worst-case
+     */
+    ConstIterator cbegin() const {
+        return ConstIterator(this, nextUsed(0));
+    }
+
+    /**
+     * Returns a constant map iterator just outside the map, reachable by an iterator
+     * that starts at cbegin()
+     * O(1)
+     */
+    ConstIterator cend() const {
+        return ConstIterator(this, _capacity);
+    }
+
+    /**
+     * Returns an iterator to a the location of a key.
+     * If key not found, returns cend().
+     */
+    ConstIterator find(const K &key) const {
+        return ConstIterator(this, findSlot(key, hashOf(key)));
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    friend std::ostream& operator<<(std::ostream& o, const SwissHashMap& t){
+        o<<"{";
+        t.show(o);
+        o<<"}";
+        return o;
+    }
+
+    /** Copy ctor. O(capacity) */
+    SwissHashMap(const SwissHashMap<K, V, Hash> &other) {
+        copy(other);
+    }
+
+    /** Assignment operator. O(capacity) */
+    SwissHashMap<K, V, Hash> &operator=(const SwissHashMap<K, V, Hash> &other) {
+        if (this != &other) {
+            free();
+            copy(other);
+        }
+        return *this;
+    }
+
+    /**
+     * Move ctor; takes over all slots, leaving other empty
+     * (without slots, until it is next inserted into). O(1)
+     */
+    SwissHashMap(SwissHashMap<K, V, Hash> &&other) noexcept {
+        moveFrom(other);
+    }
+
+    /** Move assignment operator; frees current contents, and takes over those of other. O(capacity) */
+    SwissHashMap<K, V, Hash> &operator=(SwissHashMap<K, V, Hash> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+private:
+
+    /**
+     * Allocates an empty table with a given capacity (a power of 2, at least Group::WIDTH).
+     * Both arrays are allocated before any member changes: if either allocation
+     * throws, the table that was there before (if any) is left untouched.
+     */
+    void init(unsigned int capacity) {
+        std::int8_t *ctrl = new std::int8_t[capacity];
+        Slot *slots;
+        try {
+            slots = new Slot[capacity];
+        } catch (...) {
+            delete[] ctrl;
+            throw;
+        }
+        for (unsigned int i = 0; i < capacity; i++) {
+            ctrl[i] = swiss_detail::EMPTY;
+        }
+        _slots = slots;
+        _ctrl = ctrl;
+        _capacity = capacity;
+        _groupMask = capacity / Group::WIDTH - 1;
+        _groupShift = 57;
+        for (unsigned int groups = capacity / Group::WIDTH; groups > 1; groups >>= 1) {
+            _groupShift--;
+        }
+        _growthLeft = capacity - capacity / 8;
+    }
+
+    /** Destroys all entries, and frees the slot and control arrays. */
+    void free() {
+        if (_slots != nullptr) {
+            for (unsigned int i = 0; i < _capacity; i++) {
+                if (_ctrl[i] >= 0) {
+                    _slots[i]._entry.~Entry();
+                }
+            }
+            delete[] _slots;
+            delete[] _ctrl;
+            _slots = nullptr;
+            _ctrl = nullptr;
+        }
+    }
+
+    /**
+     * Leaves this table without slots of its own: its control bytes are
+     * emptyGroup(), which no lookup can match, and it rebuilds itself into a
+     * real table on its next insertion (since _growthLeft is 0). O(1)
+     */
+    void initEmpty() noexcept {
+        _slots = nullptr;
+        _ctrl = const_cast<std::int8_t *>(emptyGroup());
+        _capacity = Group::WIDTH;
+        _groupMask = 0;
+        _groupShift = 57;
+        _growthLeft = 0;
+        _entryCount = 0;
+    }
+
+    /** Control bytes shared by all tables in their moved-from state; never written */
+    static const std::int8_t *emptyGroup() noexcept {
+        static const std::int8_t empty[Group::WIDTH] = {
+            swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY,
+            swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY,
+            swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY,
+            swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY, swiss_detail::EMPTY
+        };
+        return empty;
+    }
+
+    /**
+     * Takes over the slots of other, leaving it empty, without slots (see
+     * initEmpty()); allocates nothing, and so never throws.
+     * Before calling this, you should have freed any memory from this table
+     */
+    void moveFrom(SwissHashMap<K, V, Hash> &other) {
+        _slots = other._slots;
+        _ctrl = other._ctrl;
+        _hash = other._hash;
+        _capacity = other._capacity;
+        _groupMask = other._groupMask;
+        _groupShift = other._groupShift;
+        _growthLeft = other._growthLeft;
+        _entryCount = other._entryCount;
+        other.initEmpty();
+    }
+
+    /**
+     * Copies a table received as a parameter.
+     * Since capacity (and therefore probe sequences) are the same, entries
+     * and tombstones keep their original positions.
+     * Before calling this, you should have freed any memory from this table
+     */
+    void copy(const SwissHashMap<K, V, Hash> &other) {
+        if (other._slots == nullptr) {
+            initEmpty();
+            return;
+        }
+        init(other._capacity);
+        _hash = other._hash;
+        _entryCount = other._entryCount;
+        _growthLeft = other._growthLeft;
+        for (unsigned int i = 0; i < _capacity; i++) {
+            if (other._ctrl[i] >= 0) {
+                new (&_slots[i]._entry) Entry(other._slots[i]._entry._key, other._slots[i]._entry._value);
+            }
+            _ctrl[i] = other._ctrl[i];
+        }
+    }
+
+    /**
+     * Hash of a key, multiplied by 2^64 / golden ratio ("Fibonacci hashing"),
+     * so that identity hashes such as those of ints also vary in their top bits.
+     */
+    std::uint64_t hashOf(const K &key) const {
+        return (std::uint64_t)_hash(key) * 11400714819323198485ull;
+    }
+
+    /** First group to probe for a hash: its top bits, above those of h2 */
+    unsigned int firstGroup(std::uint64_t h) const {
+        return (unsigned int)(h >> _groupShift) & _groupMask;
+    }
+
+    /** Control byte for a hash: its 7 top bits */
+    static std::int8_t h2(std::uint64_t h) {
+        return (std::int8_t)(h >> 57);
+    }
+
+    /**
+     * Finds the slot holding a key with hash h. Returns _capacity if not found.
+     * O(1) expected; usually a single group
+     */
+    unsigned int findSlot(const K &key, std::uint64_t h) const {
+        std::int8_t tag = h2(h);
+        unsigned int g = firstGroup(h);
+        for (unsigned int step = 1; ; step++) {
+            unsigned int base = g * Group::WIDTH;
+            Group group(_ctrl + base);
+            for (BitMask m = group.match(tag); m; m.dropLowest()) {
+                unsigned int idx = base + m.lowest();
+                if (_slots[idx]._entry._key == key) {
+                    return idx;
+                }
+            }
+            if (group.matchEmpty()) {
+                return _capacity;
+            }
+            g = (g + step) & _groupMask;
+        }
+    }
+
+    /** Returns the first EMPTY or DELETED slot in the probe sequence of hash h */
+    unsigned int findFree(std::uint64_t h) const {
+        unsigned int g = firstGroup(h);
+        for (unsigned int step = 1; ; step++) {
+            BitMask m = Group(_ctrl + g * Group::WIDTH).matchFree();
+            if (m) {
+                return g * Group::WIDTH + m.lowest();
+            }
+            g = (g + step) & _groupMask;
+        }
+    }
+
+    /**
+     * Inserts a key, with hash h, that is known not to be in the table;
+     * its value is built from args. Returns the slot of the new entry.
+     */
+    template <typename KK, typename... Args>
+    unsigned int insertNew(std::uint64_t h, KK &&key, Args&&... args) {
+        unsigned int idx = findFree(h);
+        if (_growthLeft == 0 && _ctrl[idx] == swiss_detail::EMPTY) {
+            rehash();
+            idx = findFree(h);
+        }
+        new (&_slots[idx]._entry) Entry(std::forward<KK>(key), std::forward<Args>(args)...);
+        if (_ctrl[idx] == swiss_detail::EMPTY) {
+            _growthLeft--;
+        }
+        _ctrl[idx] = h2(h);
+        _entryCount++;
+        return idx;
+    }
+
+    /**
+     * Rebuilds the table, dropping all tombstones. Doubles the number of slots,
+     * unless erased keys had left at least half of the available ones as tombstones.
+     * If allocating the new table throws, the old one is kept as it was. O(n)
+     */
+    void rehash() {
+        Slot *oldSlots = _slots;
+        std::int8_t *oldCtrl = _ctrl;
+        unsigned int oldCapacity = _capacity;
+        unsigned int maxEntries = _capacity - _capacity / 8;
+        // only replaces the old arrays (still in oldSlots, oldCtrl) once the new ones exist
+        init((_entryCount * 2 <= maxEntries) ? _capacity : _capacity * 2);
+        for (unsigned int i = 0; i < oldCapacity; i++) {
+            if (oldCtrl[i] >= 0) {
+                Entry &e = oldSlots[i]._entry;
+                std::uint64_t h = hashOf(e._key);
+                unsigned int idx = findFree(h);
+                new (&_slots[idx]._entry) Entry(std::move(e));
+                _ctrl[idx] = h2(h);
+                _growthLeft--;
+                e.~Entry();
+            }
+        }
+        if (oldSlots != nullptr) { // else, oldCtrl is the shared emptyGroup()
+            delete[] oldSlots;
+            delete[] oldCtrl;
+        }
+    }
+
+    /** Returns index of first used slot at or after i; _capacity if none */
+    unsigned int nextUsed(unsigned int i) const {
+        while (i < _capacity && _ctrl[i] < 0) {
+            i++;
+        }
+        return i;
+    }
+
+    /**
+     * Pretty-printing of map. Only for debugging.
+     * observer, O(n)
+     */
+    void show(std::ostream &out) const {
+        bool first = true;
+        for (unsigned int i = 0; i < _capacity; i++) {
+            if (_ctrl[i] >= 0) {
+                out << (first ? "" : ", ");
+                first = false;
+                out << _slots[i]._entry._key << " -> " << _slots[i]._entry._value;
+            }
+        }
+    }
+
+    /** Array of slots */
+    Slot *_slots;
+
+    /** Control bytes, one per slot: EMPTY, DELETED, or h2 of the key in the slot */
+    std::int8_t *_ctrl;
+
+    /** Chosen hash function */
+    Hash _hash;
+
+    /** Number of slots in _slots (a power of 2, at least Group::WIDTH) */
+    unsigned int _capacity;
+
+    /** Number of groups - 1; used to wrap around */
+    unsigned int _groupMask;
+
+    /** 57 - log2(number of groups); used to select the bits of h1 in firstGroup() */
+    unsigned int _groupShift;
+
+    /** EMPTY slots that can still be used before the table must be rebuilt (keeps it <= 7/8 full) */
+    unsigned int _growthLeft;
+
+    /** Number of entries in the table */
+    unsigned int _entryCount;
+};
+
+#endif // __SWISSHASHMAP_H
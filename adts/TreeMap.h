@@ -1,5 +1,5 @@
 /**
- * Map ADT using binary trees
+ * Map ADT using balanced (AVL) binary trees
  * (c) Marco Antonio Gómez Martín, 2012
  * Modified by Ignacio Fábregas, 2022
  * Modified & translated by Manuel Freire, 2023
@@ -11,9 +11,18 @@
 #include <iostream>
 #include "Exceptions.h"
 #include "Stack.h"      // Used by iterators
+#include "NodePool.h"   // Allocates nodes
+#include "Stats.h"      // Optional counters, see stats()
+#include <type_traits>  // conditional
+#include <algorithm>    // stable_sort
+#include <iterator>     // iterator_traits
+#include <vector>       // for bulk operations
+#include <utility>      // forward, pair
 
 /**
- * Map using an (unbalanced) Binary Tree 
+ * Map using a height-balanced (AVL) Binary Tree: the heights of the two
+ *    children of any node differ by at most 1, so all operations are O(log n)
+ *    regardless of insertion order.
  * 
  * Requires keys to support a comparison operator: a function object that accepts
  *    two values of the key type, and which can answer whether 1st < 2nd.
@@ -22,39 +31,92 @@
  *    - TreeMap constructor: generator
  *    - insert(key, value): generator, adds a new (key, value) pair to the tree.
  *          If the key was already present, replaces its value with the new one.
+ *          Keys and values passed as rvalues are moved instead of copied.
+ *    - try_emplace(key, args...): generator, adds key with a value built in place
+ *          from args, if the key was not already present. 
  *    - erase(key): mutator. Removes the key from the tree. No effect if key absent.
  *    - at(key): observer. Returns value that corresponds to a key. 
  *          Partial: key must exist; use contains() first if unsure.
  *    - contains(key): observer. Returnes true iff key exists in map
  *    - empty(): observer. Returns true if no keys present.
  *    - size(): observer. Returns count of currently-contained keys.
+ *    - contains_batch(keys, n, out), find_batch(keys, n, out): observers. Look up
+ *          n keys at once, overlapping their cache misses (see below).
+ *    - lower_bound(key), upper_bound(key), equal_range(key), floor(key), ceiling(key): 
+ *          observers. Return iterators to the nearest keys in order
+ *    - erase(first, last): mutator. Removes all keys in an iterator range
+ *    - assign_sorted(first, last): mutator. Rebuilds the map from a range of pairs,
+ *          in O(n) if sorted
+ *
+ * If Ranked is true, each node also stores the size of its subtree, which costs
+ * an extra int per node and disables an early exit when rebalancing, but enables:
+ *    - select(k): observer. Returns an iterator to the k-th smallest key (from 0)
+ *    - rank(key): observer. Returns the number of keys that are < key
+ *    - count_range(a, b): observer. Returns the number of keys in [a, b)
+ *
+ * Batched lookups descend the tree for BATCH_SIZE keys at a time, interleaved:
+ * each round moves every unfinished descent one level down, and prefetches the
+ * node it moves to, which is only visited in the next round. In a large tree each
+ * level of a single descent is a cache miss; in a batch, the misses of all its
+ * descents overlap.
+ *
+ * If Comparator is transparent (has an is_transparent member type, as std::less<>
+ * does), at, contains, find, lower_bound and upper_bound also accept any type that
+ * it can compare with keys, such as std::string_view or const char* for std::string
+ * keys. These compare the given key as it is, without first building a K.
+ *
+ * With ADT_STATS defined, stats() returns the depths of all nodes, and the lookups
+ * and comparisons made by at and contains, as a TreeStats (see Stats.h). O(n)
  */
 
-template <typename K, typename V, typename Comparator = std::less<K>>
+template <typename K, typename V, typename Comparator = std::less<K>, bool Ranked = false>
 class TreeMap {
 private:
+    /** Subtree size, only stored in the nodes of Ranked trees */
+    class SubtreeSize {
+    public:
+        SubtreeSize() : _subtreeSize(1) {}
+        int _subtreeSize;
+    };
+    class NoSubtreeSize {};
+
     /**
      * Internal node class
      */
-    class Node {
+    class Node : public std::conditional<Ranked, SubtreeSize, NoSubtreeSize>::type {
     public:
-        Node() : _left(nullptr), _right(nullptr) {}
-        Node(const K &key, const V &value) 
-            : _key(key), _value(value), _left(nullptr), _right(nullptr) {}
-        Node(Node *left, const K &key, const V &value, Node *right)
-            : _key(key), _value(value), _left(left), _right(right) {}
+        Node() : _left(nullptr), _right(nullptr), _height(1) {}
+        /** The value is built from args; default-constructed if none */
+        template <typename KK, typename... Args>
+        Node(KK &&key, Args&&... args) 
+            : _key(std::forward<KK>(key)), _value(std::forward<Args>(args)...), 
+              _left(nullptr), _right(nullptr), _height(1) {}
 
         K _key;
         V _value;
         Node* _left;
         Node* _right;
+        /** Height of subtree rooted at this node; 1 for leaves */
+        int _height;
     };
 
 public:
 
+    /** Keys whose descents are interleaved by batched lookups */
+    static const unsigned int BATCH_SIZE = 8;
+
     /** Constructor; returns an empty TreeMap. O(1) */
     TreeMap() : _root(nullptr) { _size =0; }
 
+    /** 
+     * Constructor from a range of (key, value) pairs, such as those of a std::map; see assign_sorted(). 
+     * O(n) if sorted, O(n log n) otherwise 
+     */
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    TreeMap(It first, It last) : _root(nullptr), _size(0) {
+        assign_sorted(first, last);
+    }
+
     /** Destructor; frees nodes in O(n) */
     ~TreeMap() {
         free();
@@ -69,17 +131,48 @@ public:
      * generator, O(log n) 
      */
     void insert(const K &key, const V &value) {
-        _root = insertAux(key, value, _root);
+        bool inserted;
+        insertAux(key, inserted, value);
         // note that insertAux increases _size accordingly
     }
 
+    /** 
+     * Same as insert(key, value), but moves key & value instead of copying them.
+     * generator, O(log n) 
+     */
+    void insert(K &&key, V &&value) {
+        bool inserted;
+        insertAux(std::move(key), inserted, std::move(value));
+    }
+
+    /** 
+     * If key is not present, adds it, with a value built in place from args.
+     * No effect (and args not used) if key already present.
+     * Returns true IFF the key was added.
+     * generator, O(log n) 
+     */
+    template <typename... Args>
+    bool try_emplace(const K &key, Args&&... args) {
+        bool inserted;
+        insertAux(key, inserted, std::forward<Args>(args)...);
+        return inserted;
+    }
+
+    /** Same as try_emplace(key, args...), but moves key if added. */
+    template <typename... Args>
+    bool try_emplace(K &&key, Args&&... args) {
+        bool inserted;
+        insertAux(std::move(key), inserted, std::forward<Args>(args)...);
+        return inserted;
+    }
+
     /**
      * Removes a key, value pair from the map. 
      * No effect if key not there in the first place. 
      * mutator, O(log n)
      */
     void erase(const K &key) {
-        _root = eraseAux(_root, key);
+        eraseAux(key);
         // note that eraseAux decreases _size accordingly
     }
 
@@ -89,11 +182,13 @@ public:
      * observer, O(log n)
      */
     const V &at(const K &key) const {
-        Node *p = findAux(_root, key);
-        if (p == nullptr) {
-            throw BadKeyException();
-        }
-        return p->_value;
+        return atAux(key);
+    }
+
+    /** Same as at(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    const V &at(const KK &key) const {
+        return atAux(key);
     }
 
     /** 
@@ -104,6 +199,28 @@ public:
         return findAux(_root, key) != nullptr;
     }
 
+    /** Same as contains(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    bool contains(const KK &key) const {
+        return findAux(_root, key) != nullptr;
+    }
+
+    /**
+     * Looks up n keys; out[i] becomes true IFF keys[i] is in the map.
+     * Same results as n calls to contains(), but with their memory accesses overlapped.
+     * observer, O(n log n)
+     */
+    void contains_batch(const K *keys, unsigned int n, bool *out) const {
+        Node *found[BATCH_SIZE];
+        for (unsigned int i = 0; i < n; i += BATCH_SIZE) {
+            unsigned int m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+            descendBatch<ConstIterator>(keys + i, m, found, nullptr);
+            for (unsigned int j = 0; j < m; j++) {
+                out[i + j] = found[j] != nullptr;
+            }
+        }
+    }
+
     /** 
      * Returns true IFF no elements in set
      * observer, O(1)
@@ -126,10 +243,14 @@ public:
      */
     V &operator[](const K &key) {
         bool inserted;
-        Node* ret = findOrInsert(_root, key, inserted); 
-        if (inserted) { 
-            ++_size;
-        }
+        Node* ret = insertAux(key, inserted); // default value if new
+        return ret->_value;
+    }
+
+    /** Same as operator[](key), but moves key if it must be added. */
+    V &operator[](K &&key) {
+        bool inserted;
+        Node* ret = insertAux(std::move(key), inserted); // default value if new
         return ret->_value;
     }
 
@@ -137,7 +258,7 @@ public:
      * Pretty-printing of map. Only for debugging. 
      * observer, O(n)
      */    
-    friend std::ostream& operator<<(std::ostream& o, const TreeMap<K, V, Comparator>& t){
+    friend std::ostream& operator<<(std::ostream& o, const TreeMap<K, V, Comparator, Ranked>& t){
         o<<"{";
         show(t._root, o);
         o<<"}";
@@ -262,21 +383,22 @@ public:
      * O(log n)
      */
     Iterator find(const K &key) {
-        Stack<Node*> ancestors;
-        Node *p = _root;
-        while (p != nullptr && (_cless(p->_key, key) || _cless(key, p->_key))) {
-            if (_cless(key, p->_key)) {
-                ancestors.push(p);
-                p = p->_left;
-            } else {
-                p = p->_right;
-            }
-        }
-        Iterator ret;
-        ret._current = p;
-        if (p != nullptr)
-            ret._ancestors = ancestors;
-        return ret;
+        return findIterator<Iterator>(key);
+    }
+
+    /** Same as find(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator find(const KK &key) {
+        return findIterator<Iterator>(key);
+    }
+
+    /**
+     * Looks up n keys; out[i] becomes find(keys[i]), which is end() if not found.
+     * Same results as n calls to find(), but with their memory accesses overlapped.
+     * O(n log n)
+     */
+    void find_batch(const K *keys, unsigned int n, Iterator *out) {
+        findBatchAux(keys, n, out);
     }
 
 
@@ -404,37 +526,286 @@ public:
      * O(log n)
      */
     ConstIterator find(const K &key) const {
-        Stack<Node*> ancestors;
+        return findIterator<ConstIterator>(key);
+    }
+
+    /** Same as find(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    ConstIterator find(const KK &key) const {
+        return findIterator<ConstIterator>(key);
+    }
+
+    /** Constant version of find_batch(). O(n log n) */
+    void find_batch(const K *keys, unsigned int n, ConstIterator *out) const {
+        findBatchAux(keys, n, out);
+    }
+
+
+
+    // //
+    // ORDERED NAVIGATION AND RANGES
+    // //
+
+    /**
+     * Returns an iterator to the 1st key that is not less than key, or end() if none.
+     * Iterating from there visits all keys >= key in order, and so can be used
+     * to walk ranges without scanning from begin().
+     * O(log n)
+     */
+    Iterator lower_bound(const K &key) {
+        Iterator ret;
+        ret._current = boundAux(key, false, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of lower_bound(). O(log n) */
+    ConstIterator lower_bound(const K &key) const {
+        ConstIterator ret;
+        ret._current = boundAux(key, false, ret._ancestors);
+        return ret;
+    }
+
+    /** Same as lower_bound(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator lower_bound(const KK &key) {
+        Iterator ret;
+        ret._current = boundAux(key, false, ret._ancestors);
+        return ret;
+    }
+
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    ConstIterator lower_bound(const KK &key) const {
+        ConstIterator ret;
+        ret._current = boundAux(key, false, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns an iterator to the 1st key that is greater than key, or end() if none.
+     * O(log n)
+     */
+    Iterator upper_bound(const K &key) {
+        Iterator ret;
+        ret._current = boundAux(key, true, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of upper_bound(). O(log n) */
+    ConstIterator upper_bound(const K &key) const {
+        ConstIterator ret;
+        ret._current = boundAux(key, true, ret._ancestors);
+        return ret;
+    }
+
+    /** Same as upper_bound(key), for other key types; only if Comparator is transparent. O(log n) */
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator upper_bound(const KK &key) {
+        Iterator ret;
+        ret._current = boundAux(key, true, ret._ancestors);
+        return ret;
+    }
+
+    template <typename KK, typename C = Comparator, typename = typename C::is_transparent>
+    ConstIterator upper_bound(const KK &key) const {
+        ConstIterator ret;
+        ret._current = boundAux(key, true, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns the range [lower_bound(key), upper_bound(key)), which holds
+     * key if present, and is empty otherwise.
+     * O(log n)
+     */
+    std::pair<Iterator, Iterator> equal_range(const K &key) {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /** Constant version of equal_range(). O(log n) */
+    std::pair<ConstIterator, ConstIterator> equal_range(const K &key) const {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /**
+     * Returns an iterator to the largest key that is <= key, or end() if none.
+     * O(log n)
+     */
+    Iterator floor(const K &key) {
+        Iterator ret;
+        ret._current = floorAux(key, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of floor(). O(log n) */
+    ConstIterator floor(const K &key) const {
+        ConstIterator ret;
+        ret._current = floorAux(key, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns an iterator to the smallest key that is >= key, or end() if none.
+     * Same as lower_bound().
+     * O(log n)
+     */
+    Iterator ceiling(const K &key) {
+        return lower_bound(key);
+    }
+
+    /** Constant version of ceiling(). O(log n) */
+    ConstIterator ceiling(const K &key) const {
+        return lower_bound(key);
+    }
+
+    /**
+     * Removes all keys in [first, last), given as iterators into this map.
+     * Instead of looking up each key, splits the tree around both ends of the range,
+     * and joins what is left at both sides. Invalidates other iterators.
+     * mutator, O(log n + number of removed keys)
+     */
+    void erase(ConstIterator first, ConstIterator last) {
+        if (first == last) {
+            return;
+        }
+        K from = first.key();
+        Node *below, *rest, *range, *above = nullptr;
+        split(_root, from, below, rest);
+        if (last == cend()) {
+            range = rest;
+        } else {
+            K to = last.key();
+            split(rest, to, range, above);
+        }
+        _size -= free(range);
+        _root = join(below, above);
+    }
+
+    // //
+    // ORDER STATISTICS (only if Ranked)
+    // //
+
+    /**
+     * Returns an iterator to the k-th smallest key (counting from 0),
+     * or end() if there are not that many.
+     * O(log n)
+     */
+    Iterator select(int k) {
+        static_assert(Ranked, "select() requires a Ranked tree");
+        Iterator ret;
+        ret._current = selectAux(k, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of select(). O(log n) */
+    ConstIterator select(int k) const {
+        static_assert(Ranked, "select() requires a Ranked tree");
+        ConstIterator ret;
+        ret._current = selectAux(k, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns the number of keys that are < key;
+     * which is also the position key has, or would have, in order.
+     * O(log n)
+     */
+    int rank(const K &key) const {
+        static_assert(Ranked, "rank() requires a Ranked tree");
+        int count = 0;
         Node *p = _root;
-        while (p != nullptr && (_cless(p->_key, key) || _cless(key, p->_key))) {
-            if (_cless(key, p->_key)) {
-                ancestors.push(p);
-                p = p->_left;
-            } else {
+        while (p != nullptr) {
+            if (_cless(p->_key, key)) { // p and its left subtree are < key
+                count += subtreeSize(p->_left) + 1;
                 p = p->_right;
+            } else {
+                p = p->_left;
             }
         }
-        ConstIterator ret;
-        ret._current = p;
-        if (p != nullptr)
-            ret._ancestors = ancestors;
-        return ret;
+        return count;
     }
 
+    /**
+     * Returns the number of keys in [a, b); 0 if b is not greater than a.
+     * O(log n)
+     */
+    int count_range(const K &a, const K &b) const {
+        static_assert(Ranked, "count_range() requires a Ranked tree");
+        return _cless(a, b) ? rank(b) - rank(a) : 0;
+    }
+
+    // //
+    // BULK OPERATIONS
+    // //
+
+    /**
+     * Replaces the contents with a range of (key, value) pairs, such as those of a std::map. If it is already sorted, builds
+     * a perfectly balanced tree in O(n), instead of inserting one by one;
+     * otherwise, sorts it first. If a key is repeated, its 1st value is kept, as insert() would.
+     * All nodes are allocated in one go if the range length can be known in advance.
+     * mutator, O(n) if sorted, O(n log n) otherwise
+     */
+    template <typename It>
+    void assign_sorted(It first, It last) {
+        free();
+        typedef typename std::iterator_traits<It>::iterator_category Category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, Category>::value) {
+            _pool.reserve(static_cast<unsigned int>(std::distance(first, last)));
+        }
+        // nodes owns every node built so far, until they are linked into the tree;
+        // if building one or comparing them throws, they are all destroyed
+        std::vector<Node*> nodes;
+        try {
+            for (; first != last; ++first) {
+                const auto &entry = *first;
+                nodes.push_back(_pool.create(entry.first, entry.second));
+            }
 
+            bool sorted = true;
+            for (size_t i = 1; i < nodes.size() && sorted; i++) {
+                sorted = _cless(nodes[i - 1]->_key, nodes[i]->_key);
+            }
+            if (! sorted) { // stable, so that the 1st of any repeated keys comes 1st
+                // sorted on a copy: a throwing comparison may leave it with some nodes twice
+                std::vector<Node*> order(nodes);
+                std::stable_sort(order.begin(), order.end(), [this](Node *a, Node *b) {
+                    return _cless(a->_key, b->_key);
+                });
+                size_t kept = 0;
+                for (size_t i = 0; i < order.size(); i++) {
+                    if (kept == 0 || _cless(order[kept - 1]->_key, order[i]->_key)) {
+                        std::swap(order[kept++], order[i]); // repeated ones end up after kept
+                    }
+                }
+                // no more comparisons, so nothing below throws
+                for (size_t i = kept; i < order.size(); i++) {
+                    _pool.destroy(order[i]);
+                }
+                order.resize(kept);
+                nodes.swap(order);
+            }
+        } catch (...) {
+            for (Node *n : nodes) {
+                _pool.destroy(n);
+            }
+            throw;
+        }
+        int count = static_cast<int>(nodes.size());
+        _root = build(nodes.data(), 0, count);
+        _size = count;
+    }
 
     // //
     // C++ Boilerplate code to make class more useful
     // //
 
     /** Copy ctor. O(n) */
-    TreeMap(const TreeMap<K, V, Comparator> &other) : _root(nullptr) {
+    TreeMap(const TreeMap<K, V, Comparator, Ranked> &other) : _root(nullptr) {
         copy(other);
     }
 
 
     /** Copy assignment operator. O(n) */
-    TreeMap<K, V, Comparator> &operator=(const TreeMap<K, V, Comparator> &other) {
+    TreeMap<K, V, Comparator, Ranked> &operator=(const TreeMap<K, V, Comparator, Ranked> &other) {
         if (this != &other) {
             free();
             copy(other);
@@ -442,10 +813,33 @@ public:
         return *this;
     }
 
+    /** Move ctor; takes over all nodes, leaving other empty. O(1) */
+    TreeMap(TreeMap<K, V, Comparator, Ranked> &&other) noexcept : _root(nullptr), _size(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment operator; frees current nodes, and takes over those of other. O(n) */
+    TreeMap<K, V, Comparator, Ranked> &operator=(TreeMap<K, V, Comparator, Ranked> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
 protected:
 
+    /**
+     * Removes all nodes. Nodes only need to be visited if they have 
+     * destructors to run; otherwise, the whole pool is released in one go.
+     */
     void free() {
-        free(_root);
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            free(_root);
+        }
+        _pool.clear();
+        _root = nullptr;
+        _size = 0;
     }
 
     void copy(const TreeMap &other) {
@@ -454,161 +848,517 @@ protected:
         _cless = other._cless;
     }
 
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(TreeMap &other) {
+        _root = other._root;
+        _size = other._size;
+        _cless = other._cless;
+        _pool.swap(other._pool);
+        other._root = nullptr;
+        other._size = 0;
+    }
+
 private:
 
     /**
-     * Removes all nodes from a tree structure that starts at n.
+     * Max height of the tree. AVL trees with n nodes have height < 1.45 log2(n+2),
+     * so this is never reached with 32-bit sizes. Bounds the paths kept by
+     * insertAux() and eraseAux().
+     */
+    static const int MAX_HEIGHT = 64;
+
+    /**
+     * Removes all nodes from a tree structure that starts at n,
+     * returning how many were removed.
+     * Recursion depth is bounded by the (logarithmic) height of the tree.
      * O(n)
      */
-    static void free(Node *n) {
-        if (n != nullptr) {
-            free(n->_left);
-            free(n->_right);
-            delete n;
+    int free(Node *n) {
+        if (n == nullptr) {
+            return 0;
         }
+        int count = 1 + free(n->_left) + free(n->_right);
+        _pool.destroy(n);
+        return count;
     }
 
 
     /**
      * Copies the structure recursively.
      */
-    static Node* copyAux(Node *root) {
+    Node* copyAux(Node *root) {
         if (root == nullptr)
             return nullptr;
-        return new Node(copyAux(root->_left), root->_key, root->_value, 
-                        copyAux(root->_right));
+        Node *n = _pool.create(root->_key, root->_value);
+        n->_left = copyAux(root->_left);
+        n->_right = copyAux(root->_right);
+        update(n); // height (and size) from those of copied children
+        return n;
     }
 
     /**
-     * Inserts a key-value pair into the structure, either at or below p.
-     * p may be nullptr, in which case a root node will be created & returned.
-     * otherwise, returns p.
+     * Inserts a key-value pair into the structure, if the key is not there already. 
+     * Sets inserted to true iff a new node was created.
+     * Returns the node that contains the key (a new one if absent, the old one otherwise)
+     * Iterative: keeps the path from the root in an array, to rebalance it afterwards.
      * O(log n)
      */
-    Node *insertAux(const K &key, const V &value, Node *p) {
+    template <typename KK, typename... Args>
+    Node *insertAux(KK &&key, bool &inserted, Args&&... value) {
+        Node **path[MAX_HEIGHT];
+        int depth = 0;
+        Node **link = &_root;
+        while (*link != nullptr) {
+            Node *p = *link;
+            if (_cless(key, p->_key)) { // key < p->_key
+                path[depth++] = link;
+                link = &p->_left;
+            } else if (_cless(p->_key, key)) { // p->_key < key
+                path[depth++] = link;
+                link = &p->_right;
+            } else { // key == p->key
+                inserted = false;
+                return p;
+            }
+        }
+        Node *n = _pool.create(std::forward<KK>(key), std::forward<Args>(value)...);
+        *link = n;
+        _size ++;
+        inserted = true;
+        rebalancePath(path, depth);
+        return n;
+    }
+
+    /** Value of key (a K, or anything comparable to one); throws if absent. O(log n) */
+    template <typename KK>
+    const V &atAux(const KK &key) const {
+        Node *p = findAux(_root, key);
         if (p == nullptr) {
-            _size ++;
-            return new Node(key, value);
-        } else if (_cless(key, p->_key)) { // key < root->_key
-            p->_left = insertAux(key, value, p->_left);
-            return p;
-        } else if (_cless(p->_key, key)) { // key < root->_key
-            p->_right = insertAux(key, value, p->_right);
-            return p;
-        } else { // key == p->key
-            return p;
+            throw BadKeyException();
+        }
+        return p->_value;
+    }
+
+    /** Iterator (an Iterator or a ConstIterator) at key; at the end if absent. O(log n) */
+    template <typename It, typename KK>
+    It findIterator(const KK &key) const {
+        Stack<Node*> ancestors;
+        Node *p = _root;
+        while (p != nullptr && (_cless(p->_key, key) || _cless(key, p->_key))) {
+            if (_cless(key, p->_key)) {
+                ancestors.push(p);
+                p = p->_left;
+            } else {
+                p = p->_right;
+            }
+        }
+        It ret;
+        ret._current = p;
+        if (p != nullptr)
+            ret._ancestors = ancestors;
+        return ret;
+    }
+
+    /** Implements both find_batch() variants; It is an Iterator or a ConstIterator */
+    template <typename It>
+    void findBatchAux(const K *keys, unsigned int n, It *out) const {
+        Node *found[BATCH_SIZE];
+        for (unsigned int i = 0; i < n; i += BATCH_SIZE) {
+            unsigned int m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+            for (unsigned int j = 0; j < m; j++) {
+                out[i + j] = It();
+            }
+            descendBatch(keys + i, m, found, out + i);
+            for (unsigned int j = 0; j < m; j++) {
+                if (found[j] != nullptr) {
+                    out[i + j]._current = found[j];
+                } else {
+                    out[i + j] = It(); // end(), without ancestors
+                }
+            }
         }
     }
 
+    /**
+     * Interleaved descents for m <= BATCH_SIZE keys: found[j] becomes the node
+     * of keys[j], or nullptr if absent. If out is not nullptr, the ancestors of
+     * out[j] also get the nodes whose left subtrees the descent of keys[j]
+     * entered, as in findIterator(). Each round moves all unfinished descents
+     * one level down, prefetching the nodes that the next round will visit.
+     * O(m log n)
+     */
+    template <typename It>
+    void descendBatch(const K *keys, unsigned int m, Node **found, It *out) const {
+        unsigned int pending[BATCH_SIZE]; // indices of unfinished descents
+        unsigned int count = 0;
+        for (unsigned int j = 0; j < m; j++) {
+            found[j] = _root;
+            if (_root != nullptr) {
+                pending[count++] = j;
+            }
+        }
+        while (count > 0) {
+            unsigned int kept = 0;
+            for (unsigned int k = 0; k < count; k++) {
+                unsigned int j = pending[k];
+                Node *p = found[j];
+                if (_cless(keys[j], p->_key)) {
+                    if (out != nullptr) {
+                        out[j]._ancestors.push(p);
+                    }
+                    p = p->_left;
+                } else if (_cless(p->_key, keys[j])) {
+                    p = p->_right;
+                } else {
+                    continue; // found: descent finished
+                }
+                found[j] = p;
+                if (p != nullptr) {
+                    prefetch(p);
+                    pending[kept++] = j;
+                }
+            }
+            count = kept;
+        }
+    }
+
+    /** _cless(a, b); counted in stats mode. O(1) */
+    template <typename A, typename B>
+    bool countedLess(const A &a, const B &b) const {
+        ADT_STAT(_comparisons.add());
+        return _cless(a, b);
+    }
+
     /**
      * Finds an element in the structure
      * Returns a pointer to the element, or nullptr if not found
      * O(log n)
      */
-    Node *findAux(Node *p, const K &key) const {
-        if (p == nullptr) {
-            return nullptr;
-        } else if (_cless(key, p->_key)) { // key < root->_key
-            return findAux(p->_left, key);
-        } else if (_cless(p->_key, key)) { // key < root->_key
-            return findAux(p->_right, key);
-        } else { // key == p->key
-            return p;
+    template <typename KK>
+    Node *findAux(Node *p, const KK &key) const {
+        ADT_STAT(_lookups.add());
+        while (p != nullptr) {
+            if (countedLess(key, p->_key)) { // key < p->_key
+                p = p->_left;
+            } else if (countedLess(p->_key, key)) { // p->_key < key
+                p = p->_right;
+            } else { // key == p->key
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Removes (if found) a key from the structure.
+     * If the node has 2 children, its in-order successor (the smallest node
+     * in its right subtree) takes its place. 
+     * Iterative: keeps the path from the root in an array, to rebalance it afterwards.
+     * O(log n)
+     */
+    void eraseAux(const K &key) {
+        Node **path[MAX_HEIGHT];
+        int depth = 0;
+        Node **link = &_root;
+        while (*link != nullptr) {
+            Node *p = *link;
+            if (_cless(key, p->_key)) { // key < p->key
+                path[depth++] = link;
+                link = &p->_left;
+            } else if (_cless(p->_key, key)) { // key > p->key
+                path[depth++] = link;
+                link = &p->_right;
+            } else {
+                break;
+            }
+        }
+        Node *p = *link;
+        if (p == nullptr) { // not found
+            return;
+        }
+        if (p->_left == nullptr) { // no left child: right child replaces p
+            *link = p->_right;
+        } else if (p->_right == nullptr) { // no right child: left child replaces p
+            *link = p->_left;
+        } else { // both children: successor replaces p
+            path[depth++] = link;
+            int rightIdx = depth; // position of &p->_right in path, if any
+            Node **slink = &p->_right;
+            while ((*slink)->_left != nullptr) {
+                path[depth++] = slink;
+                slink = &(*slink)->_left;
+            }
+            Node *succ = *slink;
+            *slink = succ->_right; // unlinks successor; may change p->_right
+            succ->_left = p->_left;
+            succ->_right = p->_right;
+            succ->_height = p->_height;
+            *link = succ;
+            if (depth > rightIdx) {
+                path[rightIdx] = &succ->_right; // was &p->_right
+            }
+        }
+        _pool.destroy(p);
+        _size--;
+        rebalancePath(path, depth);
+    }
+
+    // //
+    // AVL BALANCING
+    // //
+
+    /** Height of a (possibly empty) subtree. O(1) */
+    static int height(Node *n) {
+        return (n == nullptr) ? 0 : n->_height;
+    }
+
+    /** Size of a (possibly empty) subtree. Only for Ranked trees. O(1) */
+    static int subtreeSize(Node *n) {
+        return (n == nullptr) ? 0 : n->_subtreeSize;
+    }
+
+    /** Recomputes height (and size, if Ranked) of a node from those of its children. O(1) */
+    static void update(Node *n) {
+        int left = height(n->_left);
+        int right = height(n->_right);
+        n->_height = 1 + ((left > right) ? left : right);
+        if constexpr (Ranked) {
+            n->_subtreeSize = 1 + subtreeSize(n->_left) + subtreeSize(n->_right);
         }
     }
 
+    /** 
+     * Rotates a subtree to the right: its left child becomes its root.
+     * Returns the new root. O(1)
+     */
+    static Node *rotateRight(Node *n) {
+        Node *l = n->_left;
+        n->_left = l->_right;
+        l->_right = n;
+        update(n);
+        update(l);
+        return l;
+    }
+
+    /** 
+     * Rotates a subtree to the left: its right child becomes its root.
+     * Returns the new root. O(1)
+     */
+    static Node *rotateLeft(Node *n) {
+        Node *r = n->_right;
+        n->_right = r->_left;
+        r->_left = n;
+        update(n);
+        update(r);
+        return r;
+    }
+
+    /**
+     * Restores the AVL property at n (children heights differ by at most 1),
+     * assuming that it holds for both children, and their heights differ by at most 2.
+     * Returns the new root of the subtree. O(1)
+     */
+    static Node *rebalance(Node *n) {
+        update(n);
+        int balance = height(n->_left) - height(n->_right);
+        if (balance > 1) { // left too tall
+            if (height(n->_left->_left) < height(n->_left->_right)) {
+                n->_left = rotateLeft(n->_left); // left-right case
+            }
+            return rotateRight(n);
+        } else if (balance < -1) { // right too tall
+            if (height(n->_right->_right) < height(n->_right->_left)) {
+                n->_right = rotateRight(n->_right); // right-left case
+            }
+            return rotateLeft(n);
+        }
+        return n;
+    }
 
     /**
-     * Finds or inserts a key in the map. 
-     * If the key is new, inserts a default value.
-     * If the key was already present, nothing is inserted.
-     * Returns a node with the key (a new one if absent, the old one otherwise)
-     * Used in operator[]. Sets inserted to true iff new node returned
+     * Rebalances subtrees along a path, from its deepest link up to the root.
+     * Stops early if a subtree keeps its height, since nothing above can change;
+     * except in Ranked trees, where all sizes along the path have changed.
      * O(log n)
      */
-    Node *findOrInsert(Node* &root, const K &key, bool& inserted) {
-        if (root == nullptr) { // Key not present: return new Node*
-            inserted = true;
-            root = new Node(key, V()); // adds new node to tree
-            return root; 
-        } else if (_cless(key, root->_key)) { // key < root->_key
-            return findOrInsert(root->_left, key, inserted);
-        } else if (_cless(root->_key, key)) { // key < root->_key
-            return findOrInsert(root->_right, key, inserted);
-        } else {              // Key found: do not modify it
-            inserted = false;
-            return root;      
+    static void rebalancePath(Node **path[], int depth) {
+        for (int i = depth - 1; i >= 0; --i) {
+            int before = (*path[i])->_height;
+            *path[i] = rebalance(*path[i]);
+            if (! Ranked && (*path[i])->_height == before) {
+                break;
+            }
         }
     }
 
     /**
-     * Removes (if found) an element at or below p
-     * If element at p, a modified (but valid) pointer will be returned 
-     * otherwise returns p.
+     * Finds the 1st node with a key >= key (or > key, if strict), and fills ancestors
+     * with the nodes an iterator would visit after it. Returns nullptr if none.
+     * This is the last node where the search turned left, so the stack is just
+     * the path of left turns without it.
      * O(log n)
      */
-    Node* eraseAux(Node *p, const K &key) {
-        if (p == nullptr) {
+    template <typename KK>
+    Node *boundAux(const KK &key, bool strict, Stack<Node*> &ancestors) const {
+        Node *p = _root;
+        while (p != nullptr) {
+            bool before = strict ? ! _cless(key, p->_key) : _cless(p->_key, key);
+            if (before) { // p->_key < key (or <=, if strict)
+                p = p->_right;
+            } else {
+                ancestors.push(p);
+                p = p->_left;
+            }
+        }
+        if (ancestors.empty()) {
             return nullptr;
-        } else if (_cless(key, p->_key)) { // key < p->key
-            p->_left = eraseAux(p->_left, key);
-            return p;
-        } else if(_cless(p->_key, key)) { // (key > p->key)
-            p->_right = eraseAux(p->_right, key);
-            return p;
-        } else {  // p->key == key
-            _size--;
-            return eraseRoot(p);
         }
+        Node *ret = ancestors.top();
+        ancestors.pop();
+        return ret;
     }
 
     /**
-     * Removes the root of a structure, and returns a pointer to the new root.
-     * O(log n) (only if a smallest element needs to be found)
+     * Finds the last node with a key <= key, and fills ancestors with the
+     * nodes an iterator would visit after it. Returns nullptr if none.
+     * This is the last node where the search turned right; left turns taken
+     * below it are discarded from the stack.
+     * O(log n)
      */
-    Node* eraseRoot(Node *p) {
-        Node *aux;
-        if (p->_left == nullptr) {// Si no hay hijo izquierdo, la raíz pasa a ser el hijo derecho
-            aux = p->_right;
-            delete p;
-            return aux;
-        } else
-        if (p->_right == nullptr) {// Si no hay hijo derecho, la raíz pasa a ser el hijo izquierdo
-            aux = p->_left;
-            delete p;
-            return aux;
-        } else { // both right and left nodes
-                 // smallest element will be moved to right subtree
-            return moveSmallestAndErase(p);
+    Node *floorAux(const K &key, Stack<Node*> &ancestors) const {
+        Node *p = _root;
+        Node *ret = nullptr;
+        int depth = 0;
+        while (p != nullptr) {
+            if (_cless(key, p->_key)) { // key < p->_key
+                ancestors.push(p);
+                p = p->_left;
+            } else {
+                ret = p;
+                depth = ancestors.size();
+                p = p->_right;
+            }
+        }
+        while (ancestors.size() > depth) {
+            ancestors.pop();
         }
+        return ret;
     }
 
     /**
-     * Finds smallest element in right subtree, which will be used as new root.
-     *   - Smallest will be new right child
-     *   - Left child of old smallest's parent will be the new left child
+     * Finds the k-th smallest node, and fills ancestors with the nodes
+     * an iterator would visit after it. Returns nullptr if k is out of range.
      * O(log n)
      */
-    Node *moveSmallestAndErase(Node *p) {
-        /*
-         * Find smallest & its immediate parent
-         */
-        Node *parent = nullptr;
-        Node *aux = p->_right;
-        while (aux->_left != nullptr) {
-            parent = aux;
-            aux = aux->_left;
+    Node *selectAux(int k, Stack<Node*> &ancestors) const {
+        if (k < 0 || k >= _size) {
+            return nullptr;
+        }
+        Node *p = _root;
+        while (true) {
+            int left = subtreeSize(p->_left);
+            if (k < left) {
+                ancestors.push(p);
+                p = p->_left;
+            } else if (k > left) {
+                k -= left + 1;
+                p = p->_right;
+            } else {
+                return p;
+            }
+        }
+    }
+
+    /**
+     * Links nodes [lo, hi) of a sorted array into a perfectly balanced tree,
+     * rooted at the middle one. Returns that root.
+     * O(hi - lo)
+     */
+    static Node *build(Node *nodes[], int lo, int hi) {
+        if (lo >= hi) {
+            return nullptr;
+        }
+        int mid = lo + (hi - lo) / 2;
+        Node *n = nodes[mid];
+        n->_left = build(nodes, lo, mid);
+        n->_right = build(nodes, mid + 1, hi);
+        update(n);
+        return n;
+    }
+
+    // //
+    // SPLIT AND JOIN
+    // //
+
+    /**
+     * Splits a subtree into the nodes with keys < key, returned in below,
+     * and those with keys >= key, returned in rest. Both are valid AVL trees.
+     * O(log n)
+     */
+    void split(Node *n, const K &key, Node *&below, Node *&rest) {
+        if (n == nullptr) {
+            below = rest = nullptr;
+            return;
         }
-        if (parent != nullptr) { // parent found, switch
-            parent->_left = aux->_right;
-            aux->_left = p->_left;
-            aux->_right = p->_right;
-        } else { // no parent - was already root
-            aux->_left = p->_left;
+        Node *left = n->_left;
+        Node *right = n->_right;
+        if (_cless(n->_key, key)) { // n and its left subtree go below
+            Node *rightBelow;
+            split(right, key, rightBelow, rest);
+            below = join(left, n, rightBelow);
+        } else { // n and its right subtree go to rest
+            Node *leftRest;
+            split(left, key, below, leftRest);
+            rest = join(leftRest, n, right);
         }
+    }
 
-        delete p;
-        return aux;
+    /**
+     * Joins 2 AVL trees and a node between them (all keys in left < mid's < all in right)
+     * into a single AVL tree. Descends along the taller tree until reaching a subtree
+     * as tall as the other tree, hangs both from mid there, and rebalances back up.
+     * O(difference in heights)
+     */
+    static Node *join(Node *left, Node *mid, Node *right) {
+        if (height(left) > height(right) + 1) {
+            left->_right = join(left->_right, mid, right);
+            return rebalance(left);
+        } else if (height(right) > height(left) + 1) {
+            right->_left = join(left, mid, right->_left);
+            return rebalance(right);
+        }
+        mid->_left = left;
+        mid->_right = right;
+        update(mid);
+        return mid;
+    }
+
+    /**
+     * Joins 2 AVL trees (all keys in left < all in right) into a single AVL tree,
+     * using the smallest node of right as the one between them.
+     * O(log n)
+     */
+    static Node *join(Node *left, Node *right) {
+        if (right == nullptr) {
+            return left;
+        }
+        Node *smallest;
+        right = removeSmallest(right, smallest);
+        return join(left, smallest, right);
+    }
+
+    /**
+     * Unlinks the smallest node of a non-empty AVL tree, returning it in smallest.
+     * Returns the rest of the tree, rebalanced.
+     * O(log n)
+     */
+    static Node *removeSmallest(Node *n, Node *&smallest) {
+        if (n->_left == nullptr) {
+            smallest = n;
+            return n->_right;
+        }
+        n->_left = removeSmallest(n->_left, smallest);
+        return rebalance(n);
     }
 
     /**
@@ -642,6 +1392,39 @@ private:
      * Number of elements in the set
      */
     int _size;
+
+    /**
+     * Allocator for all nodes in this map
+     */
+    NodePool<Node> _pool;
+
+#ifdef ADT_STATS
+    /** Calls to findAux, and key comparisons made by them */
+    mutable StatCounter _lookups, _comparisons;
+
+    /** Counts the nodes at each depth of the subtree at p, which is at the given depth */
+    static void countDepths(const Node *p, unsigned int depth, std::vector<unsigned int> &depths) {
+        for (/**/; p != nullptr; p = p->_right, depth++) {
+            stats_detail::count(depths, depth);
+            countDepths(p->_left, depth + 1, depths);
+        }
+    }
+
+public:
+
+    /** Snapshot of stats counters, plus a histogram of node depths. O(n) */
+    TreeStats stats() const {
+        TreeStats s;
+        countDepths(_root, 0, s.depths);
+        for (unsigned int n : s.depths) {
+            s.nodes += n;
+        }
+        s.lookups = _lookups.get();
+        s.comparisons = _comparisons.get();
+        s.alloc = _pool.alloc_stats();
+        return s;
+    }
+#endif
 };
 
 #endif // __TREEMAP_H
@@ -1,7 +1,7 @@
 /**
- * Set ADT using an unbalanced binary tree 
- *    NOTE that operations are only O(log(n)) if inserts/removals are random
- *         a better implementation would rebalance the tree, making them always O(log(n))
+ * Set ADT using a balanced (AVL) binary tree 
+ *    The heights of the two children of any node differ by at most 1, 
+ *    making operations O(log(n)) regardless of insertion order
  * (c) Marco Antonio Gómez Martín & Miguel Gómez-Zamalloa, 2018
  * Adapted by Ignacio Fábregas, 2022
  * Modified & transaltad by Manuel Freire, 2023
@@ -11,32 +11,72 @@
 
 #include "Exceptions.h"
 #include "Stack.h" // Used for iteration
+#include "NodePool.h" // Allocates nodes
+#include "Stats.h" // Optional counters, see stats()
+#include <functional> // less
+#include <type_traits> // conditional
+#include <algorithm> // stable_sort
+#include <iterator> // iterator_traits
+#include <vector> // for bulk operations
+#include <utility> // pair, move, forward
 
 /**
+ * Requires elements to support a comparison operator: a function object that accepts
+ *    two elements, and which can answer whether 1st < 2nd.
+ *    The < operator is used if present for the element type T. 
  * Operations are:
  *    - TreeSet: constructor
  *    - insert(elem): mutator, adds an element. Does nothing if element was already present.
+ *          Elements passed as rvalues are moved instead of copied; emplace(args...)
+ *          builds the element from constructor arguments.
  *    - erase(elem): mutator, removes an element
  *    - contains(elem): observer, true IFF element already in set
  *    - empty(): observer, true IFF no elements in set
+ *    - lower_bound(elem), upper_bound(elem), equal_range(elem), floor(elem), ceiling(elem): 
+ *          observers. Return iterators to the nearest elements in order
+ *    - erase(first, last): mutator. Removes all elements in an iterator range
+ *    - assign_sorted(first, last): mutator. Rebuilds the set from a range,
+ *          in O(n) if sorted
+ *    - merge(other): mutator. Adds all elements of another set, in O(n + m)
+ *
+ * If Ranked is true, each node also stores the size of its subtree, which costs
+ * an extra int per node and disables an early exit when rebalancing, but enables:
+ *    - select(k): observer. Returns an iterator to the k-th smallest element (from 0)
+ *    - rank(elem): observer. Returns the number of elements that are < elem
+ *    - count_range(a, b): observer. Returns the number of elements in [a, b)
+ *
+ * With ADT_STATS defined, stats() returns the depths of all nodes, and the lookups
+ * and comparisons made by contains, as a TreeStats (see Stats.h). O(n)
  */
-template <class T>
+template <class T, class Comparator = std::less<T>, bool Ranked = false>
 class TreeSet {
 private:
+    /** Subtree size, only stored in the nodes of Ranked trees */
+    class SubtreeSize {
+    public:
+        SubtreeSize() : _subtreeSize(1) {}
+        int _subtreeSize;
+    };
+    class NoSubtreeSize {};
+
     /**
      Internal node class, storing values & pointers to left and right children
      */
-    class Node {
+    class Node : public std::conditional<Ranked, SubtreeSize, NoSubtreeSize>::type {
     public:
-        Node() : _left(nullptr), _right(nullptr) {}
+        Node() : _left(nullptr), _right(nullptr), _height(1) {}
         Node(const T &elem)
-            : _elem(elem), _left(nullptr), _right(nullptr) {}
+            : _elem(elem), _left(nullptr), _right(nullptr), _height(1) {}
+        Node(T &&elem)
+            : _elem(std::move(elem)), _left(nullptr), _right(nullptr), _height(1) {}
         Node(Node *left, const T &elem, Node *right)
-            : _elem(elem), _left(left), _right(right) {}
+            : _elem(elem), _left(left), _right(right), _height(1) {}
 
         T _elem;
         Node *_left;
         Node *_right;
+        /** Height of subtree rooted at this node; 1 for leaves */
+        int _height;
     };
 
 public:
@@ -44,6 +84,15 @@ public:
     /** Constructor; returns an empty TreeSet */
     TreeSet() : _root(nullptr) {}
 
+    /** 
+     * Constructor from a range of elements; see assign_sorted(). 
+     * O(n) if sorted, O(n log n) otherwise 
+     */
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    TreeSet(It first, It last) : _root(nullptr) {
+        assign_sorted(first, last);
+    }
+
     /** Destructor; frees nodes in O(n) */
     ~TreeSet() {
         free();
@@ -56,7 +105,26 @@ public:
      * generator, O(log n) 
      */
     void insert(const T &elem) {
-        _root = insertAux(elem, _root);
+        insertAux(elem);
+    }
+
+    /** 
+     * Same as insert(elem), but moves the element instead of copying it.
+     * generator, O(log n) 
+     */
+    void insert(T &&elem) {
+        insertAux(std::move(elem));
+    }
+
+    /** 
+     * Adds an element built from the given constructor arguments.
+     * It must be built to be compared, so it is built once, and moved into
+     * the set if not already present.
+     * generator, O(log n) 
+     */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        insertAux(T(std::forward<Args>(args)...));
     }
 
     /**
@@ -65,7 +133,7 @@ public:
      * mutator, O(log n)
      */
     void erase(const T &elem) {
-        _root = eraseAux(_root, elem);
+        eraseAux(elem);
     }
 
     /** 
@@ -88,7 +156,7 @@ public:
      * Pretty-printing of tree. Only for debugging. 
      * observer, O(n)
      */
-    friend std::ostream& operator<<(std::ostream& o, const TreeSet<T>& t){
+    friend std::ostream& operator<<(std::ostream& o, const TreeSet<T, Comparator, Ranked>& t){
         o  << "==== Tree =====" << std::endl;
         graph_rec(o, 0, t._root);
         o << "===============" << std::endl;
@@ -211,12 +279,13 @@ public:
     Iterator find(const T &e) {
         Stack<Node*> ancestors;
         Node *p = _root;
-        while ((p != nullptr) && (p->_elem != e)) {
-            if (p->_elem > e) {
+        while (p != nullptr && (_cless(p->_elem, e) || _cless(e, p->_elem))) {
+            if (_cless(e, p->_elem)) {
                 ancestors.push(p);
                 p = p->_left;
-            } else
+            } else {
                 p = p->_right;
+            }
         }
         Iterator ret;
         ret._current = p;
@@ -352,8 +421,8 @@ public:
     ConstIterator find(const T &e) const {
         Stack<Node*> ancestors;
         Node *p = _root;
-        while ((p != nullptr) && (p->_elem != e)) {
-            if (p->_elem > e) {
+        while (p != nullptr && (_cless(p->_elem, e) || _cless(e, p->_elem))) {
+            if (_cless(e, p->_elem)) {
                 ancestors.push(p);
                 p = p->_left;
             } else {
@@ -367,17 +436,267 @@ public:
         return ret;
     }
 
+    // //
+    // ORDERED NAVIGATION AND RANGES
+    // //
+
+    /**
+     * Returns an iterator to the 1st elem that is not less than elem, or end() if none.
+     * Iterating from there visits all elements >= elem in order, and so can be used
+     * to walk ranges without scanning from begin().
+     * O(log n)
+     */
+    Iterator lower_bound(const T &elem) {
+        Iterator ret;
+        ret._current = boundAux(elem, false, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of lower_bound(). O(log n) */
+    ConstIterator lower_bound(const T &elem) const {
+        ConstIterator ret;
+        ret._current = boundAux(elem, false, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns an iterator to the 1st elem that is greater than elem, or end() if none.
+     * O(log n)
+     */
+    Iterator upper_bound(const T &elem) {
+        Iterator ret;
+        ret._current = boundAux(elem, true, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of upper_bound(). O(log n) */
+    ConstIterator upper_bound(const T &elem) const {
+        ConstIterator ret;
+        ret._current = boundAux(elem, true, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns the range [lower_bound(elem), upper_bound(elem)), which holds
+     * elem if present, and is empty otherwise.
+     * O(log n)
+     */
+    std::pair<Iterator, Iterator> equal_range(const T &elem) {
+        return std::make_pair(lower_bound(elem), upper_bound(elem));
+    }
+
+    /** Constant version of equal_range(). O(log n) */
+    std::pair<ConstIterator, ConstIterator> equal_range(const T &elem) const {
+        return std::make_pair(lower_bound(elem), upper_bound(elem));
+    }
+
+    /**
+     * Returns an iterator to the largest elem that is <= elem, or end() if none.
+     * O(log n)
+     */
+    Iterator floor(const T &elem) {
+        Iterator ret;
+        ret._current = floorAux(elem, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of floor(). O(log n) */
+    ConstIterator floor(const T &elem) const {
+        ConstIterator ret;
+        ret._current = floorAux(elem, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns an iterator to the smallest elem that is >= elem, or end() if none.
+     * Same as lower_bound().
+     * O(log n)
+     */
+    Iterator ceiling(const T &elem) {
+        return lower_bound(elem);
+    }
+
+    /** Constant version of ceiling(). O(log n) */
+    ConstIterator ceiling(const T &elem) const {
+        return lower_bound(elem);
+    }
+
+    /**
+     * Removes all elements in [first, last), given as iterators into this set.
+     * Instead of looking up each elem, splits the tree around both ends of the range,
+     * and joins what is left at both sides. Invalidates other iterators.
+     * mutator, O(log n + number of removed elements)
+     */
+    void erase(ConstIterator first, ConstIterator last) {
+        if (first == last) {
+            return;
+        }
+        T from = first.elem();
+        Node *below, *rest, *range, *above = nullptr;
+        split(_root, from, below, rest);
+        if (last == cend()) {
+            range = rest;
+        } else {
+            T to = last.elem();
+            split(rest, to, range, above);
+        }
+        free(range);
+        _root = join(below, above);
+    }
+
+    // //
+    // ORDER STATISTICS (only if Ranked)
+    // //
+
+    /**
+     * Returns an iterator to the k-th smallest elem (counting from 0),
+     * or end() if there are not that many.
+     * O(log n)
+     */
+    Iterator select(int k) {
+        static_assert(Ranked, "select() requires a Ranked tree");
+        Iterator ret;
+        ret._current = selectAux(k, ret._ancestors);
+        return ret;
+    }
+
+    /** Constant version of select(). O(log n) */
+    ConstIterator select(int k) const {
+        static_assert(Ranked, "select() requires a Ranked tree");
+        ConstIterator ret;
+        ret._current = selectAux(k, ret._ancestors);
+        return ret;
+    }
+
+    /**
+     * Returns the number of elements that are < elem;
+     * which is also the position elem has, or would have, in order.
+     * O(log n)
+     */
+    int rank(const T &elem) const {
+        static_assert(Ranked, "rank() requires a Ranked tree");
+        int count = 0;
+        Node *p = _root;
+        while (p != nullptr) {
+            if (_cless(p->_elem, elem)) { // p and its left subtree are < elem
+                count += subtreeSize(p->_left) + 1;
+                p = p->_right;
+            } else {
+                p = p->_left;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Returns the number of elements in [a, b); 0 if b is not greater than a.
+     * O(log n)
+     */
+    int count_range(const T &a, const T &b) const {
+        static_assert(Ranked, "count_range() requires a Ranked tree");
+        return _cless(a, b) ? rank(b) - rank(a) : 0;
+    }
+
+    // //
+    // BULK OPERATIONS
+    // //
+
+    /**
+     * Replaces the contents with a range of elements. If it is already sorted, builds
+     * a perfectly balanced tree in O(n), instead of inserting one by one;
+     * otherwise, sorts it first. Repeated elements are only added once.
+     * All nodes are allocated in one go if the range length can be known in advance.
+     * mutator, O(n) if sorted, O(n log n) otherwise
+     */
+    template <typename It>
+    void assign_sorted(It first, It last) {
+        free();
+        typedef typename std::iterator_traits<It>::iterator_category Category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, Category>::value) {
+            _pool.reserve(static_cast<unsigned int>(std::distance(first, last)));
+        }
+        // nodes owns every node built so far, until they are linked into the tree;
+        // if building one or comparing them throws, they are all destroyed
+        std::vector<Node*> nodes;
+        try {
+            for (; first != last; ++first) {
+                nodes.push_back(_pool.create(*first));
+            }
+
+            bool sorted = true;
+            for (size_t i = 1; i < nodes.size() && sorted; i++) {
+                sorted = _cless(nodes[i - 1]->_elem, nodes[i]->_elem);
+            }
+            if (! sorted) { // stable, so that the 1st of any repeated elements comes 1st
+                // sorted on a copy: a throwing comparison may leave it with some nodes twice
+                std::vector<Node*> order(nodes);
+                std::stable_sort(order.begin(), order.end(), [this](Node *a, Node *b) {
+                    return _cless(a->_elem, b->_elem);
+                });
+                size_t kept = 0;
+                for (size_t i = 0; i < order.size(); i++) {
+                    if (kept == 0 || _cless(order[kept - 1]->_elem, order[i]->_elem)) {
+                        std::swap(order[kept++], order[i]); // repeated ones end up after kept
+                    }
+                }
+                // no more comparisons, so nothing below throws
+                for (size_t i = kept; i < order.size(); i++) {
+                    _pool.destroy(order[i]);
+                }
+                order.resize(kept);
+                nodes.swap(order);
+            }
+        } catch (...) {
+            for (Node *n : nodes) {
+                _pool.destroy(n);
+            }
+            throw;
+        }
+        int count = static_cast<int>(nodes.size());
+        _root = build(nodes.data(), 0, count);
+    }
+
+    /**
+     * Adds all elements of another set to this one (set union).
+     * Walks both sets in order, reusing the nodes of this one, and rebuilds a
+     * perfectly balanced tree from the result; instead of m separate inserts.
+     * mutator, O(n + m)
+     */
+    void merge(const TreeSet<T, Comparator, Ranked> &other) {
+        if (this == &other || other._root == nullptr) {
+            return;
+        }
+        std::vector<Node*> mine, theirs;
+        inOrder(_root, mine);
+        inOrder(other._root, theirs);
+        std::vector<Node*> nodes;
+        nodes.reserve(mine.size() + theirs.size());
+        size_t i = 0, j = 0;
+        while (i < mine.size() || j < theirs.size()) {
+            if (j == theirs.size() 
+                    || (i < mine.size() && _cless(mine[i]->_elem, theirs[j]->_elem))) {
+                nodes.push_back(mine[i++]);
+            } else if (i == mine.size() || _cless(theirs[j]->_elem, mine[i]->_elem)) {
+                nodes.push_back(_pool.create(theirs[j++]->_elem));
+            } else { // in both
+                nodes.push_back(mine[i++]);
+                j++;
+            }
+        }
+        _root = build(nodes.data(), 0, static_cast<int>(nodes.size()));
+    }
+
     // //
     // C++ Boilerplate code to make class more useful
     // //
 
     /** Copy ctor. O(n) */
-    TreeSet(const TreeSet<T> &other) : _root(nullptr) {
+    TreeSet(const TreeSet<T, Comparator, Ranked> &other) : _root(nullptr) {
         copy(other);
     }
 
     /** Copy assignment operator. O(n) */
-    TreeSet<T> &operator=(const TreeSet<T> &other) {
+    TreeSet<T, Comparator, Ranked> &operator=(const TreeSet<T, Comparator, Ranked> &other) {
         if (this != &other) {
             free();
             copy(other);
@@ -385,29 +704,68 @@ public:
         return *this;
     }
 
+    /** Move ctor; takes over all nodes, leaving other empty. O(1) */
+    TreeSet(TreeSet<T, Comparator, Ranked> &&other) noexcept : _root(nullptr) {
+        moveFrom(other);
+    }
+
+    /** Move assignment operator; frees current nodes, and takes over those of other. O(n) */
+    TreeSet<T, Comparator, Ranked> &operator=(TreeSet<T, Comparator, Ranked> &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
 protected:
 
+    /**
+     * Removes all nodes. Nodes only need to be visited if they have 
+     * destructors to run; otherwise, the whole pool is released in one go.
+     */
     void free() {
-        free(_root);
+        if (NodePool<Node>::NEEDS_DESTROY) {
+            free(_root);
+        }
+        _pool.clear();
+        _root = nullptr;
     }
 
     void copy(const TreeSet &other) {
         _root = copyAux(other._root);
+        _cless = other._cless;
+    }
+
+    /** Takes over the nodes of other, which must be freed; leaves other empty */
+    void moveFrom(TreeSet &other) {
+        _root = other._root;
+        _cless = other._cless;
+        _pool.swap(other._pool);
+        other._root = nullptr;
     }
 
 private:
     /** used to generate output */
     static const int TREE_INDENTATION = 4;
 
+    /**
+     * Max height of the tree. AVL trees with n nodes have height < 1.45 log2(n+2),
+     * so this is never reached with 32-bit sizes. Bounds the paths kept by
+     * insertAux() and eraseAux().
+     */
+    static const int MAX_HEIGHT = 64;
+
     /**
      * Deletes the structure recursively.
+     * Recursion depth is bounded by the (logarithmic) height of the tree.
      * O(n)
      */
-    static void free(Node *n) {
+    void free(Node *n) {
         if (n != nullptr) {
             free(n->_left);
             free(n->_right);
-            delete n;
+            _pool.destroy(n);
         }
     }
 
@@ -415,30 +773,45 @@ private:
      * Copies the structure recursively.
      * O(n)
      */
-    static Node* copyAux(Node *root) {
+    Node* copyAux(Node *root) {
         if (root == nullptr)
             return nullptr;
-        return new Node(copyAux(root->_left), root->_elem, copyAux(root->_right));
+        Node *n = _pool.create(copyAux(root->_left), root->_elem, copyAux(root->_right));
+        update(n); // height (and size) from those of copied children
+        return n;
     }
 
     /**
-     * Inserts an element into the structure, either at or below p.
-     * p may be nullptr, in which case a root node will be created & returned.
-     * otherwise, returns p.
+     * Inserts an element into the structure, unless already there.
+     * Moves it into its node if passed as an rvalue.
+     * Iterative: keeps the path from the root in an array, to rebalance it afterwards.
      * O(log n)
      */
-    static Node* insertAux(const T &elem, Node *p) {
-        if (p == nullptr) {
-            return new Node(elem);
-        } else if (p->_elem == elem) {
-            return p;
-        } else if (elem < p->_elem) {
-            p->_left = insertAux(elem, p->_left);
-            return p;
-        } else { // (elem > p->elem)
-            p->_right = insertAux(elem, p->_right);
-            return p;
+    template <typename TT>
+    void insertAux(TT &&elem) {
+        Node **path[MAX_HEIGHT];
+        int depth = 0;
+        Node **link = &_root;
+        while (*link != nullptr) {
+            Node *p = *link;
+            if (_cless(elem, p->_elem)) { // elem < p->elem
+                path[depth++] = link;
+                link = &p->_left;
+            } else if (_cless(p->_elem, elem)) { // elem > p->elem
+                path[depth++] = link;
+                link = &p->_right;
+            } else { // already there
+                return;
+            }
         }
+        *link = _pool.create(std::forward<TT>(elem));
+        rebalancePath(path, depth);
+    }
+
+    /** _cless(a, b); counted in stats mode. O(1) */
+    bool countedLess(const T &a, const T &b) const {
+        ADT_STAT(_comparisons.add());
+        return _cless(a, b);
     }
 
     /**
@@ -446,87 +819,338 @@ private:
      * Returns a pointer to the element, or nullptr if not found
      * O(log n)
      */
-    static Node* findAux(Node *p, const T &elem) {
-        if (p == nullptr) {
+    Node* findAux(Node *p, const T &elem) const {
+        ADT_STAT(_lookups.add());
+        while (p != nullptr) {
+            if (countedLess(elem, p->_elem)) { // elem < p->elem
+                p = p->_left;
+            } else if (countedLess(p->_elem, elem)) { // elem > p->elem
+                p = p->_right;
+            } else {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Removes (if found) an element from the structure.
+     * If the node has 2 children, its in-order successor (the smallest node
+     * in its right subtree) takes its place. 
+     * Iterative: keeps the path from the root in an array, to rebalance it afterwards.
+     * O(log n)
+     */
+    void eraseAux(const T &elem) {
+        Node **path[MAX_HEIGHT];
+        int depth = 0;
+        Node **link = &_root;
+        while (*link != nullptr) {
+            Node *p = *link;
+            if (_cless(elem, p->_elem)) { // elem < p->elem
+                path[depth++] = link;
+                link = &p->_left;
+            } else if (_cless(p->_elem, elem)) { // elem > p->elem
+                path[depth++] = link;
+                link = &p->_right;
+            } else {
+                break;
+            }
+        }
+        Node *p = *link;
+        if (p == nullptr) { // not found
+            return;
+        }
+        if (p->_left == nullptr) { // no left child: right child replaces p
+            *link = p->_right;
+        } else if (p->_right == nullptr) { // no right child: left child replaces p
+            *link = p->_left;
+        } else { // both children: successor replaces p
+            path[depth++] = link;
+            int rightIdx = depth; // position of &p->_right in path, if any
+            Node **slink = &p->_right;
+            while ((*slink)->_left != nullptr) {
+                path[depth++] = slink;
+                slink = &(*slink)->_left;
+            }
+            Node *succ = *slink;
+            *slink = succ->_right; // unlinks successor; may change p->_right
+            succ->_left = p->_left;
+            succ->_right = p->_right;
+            succ->_height = p->_height;
+            *link = succ;
+            if (depth > rightIdx) {
+                path[rightIdx] = &succ->_right; // was &p->_right
+            }
+        }
+        _pool.destroy(p);
+        rebalancePath(path, depth);
+    }
+
+    // //
+    // AVL BALANCING
+    // //
+
+    /** Height of a (possibly empty) subtree. O(1) */
+    static int height(Node *n) {
+        return (n == nullptr) ? 0 : n->_height;
+    }
+
+    /** Size of a (possibly empty) subtree. Only for Ranked trees. O(1) */
+    static int subtreeSize(Node *n) {
+        return (n == nullptr) ? 0 : n->_subtreeSize;
+    }
+
+    /** Recomputes height (and size, if Ranked) of a node from those of its children. O(1) */
+    static void update(Node *n) {
+        int left = height(n->_left);
+        int right = height(n->_right);
+        n->_height = 1 + ((left > right) ? left : right);
+        if constexpr (Ranked) {
+            n->_subtreeSize = 1 + subtreeSize(n->_left) + subtreeSize(n->_right);
+        }
+    }
+
+    /** 
+     * Rotates a subtree to the right: its left child becomes its root.
+     * Returns the new root. O(1)
+     */
+    static Node *rotateRight(Node *n) {
+        Node *l = n->_left;
+        n->_left = l->_right;
+        l->_right = n;
+        update(n);
+        update(l);
+        return l;
+    }
+
+    /** 
+     * Rotates a subtree to the left: its right child becomes its root.
+     * Returns the new root. O(1)
+     */
+    static Node *rotateLeft(Node *n) {
+        Node *r = n->_right;
+        n->_right = r->_left;
+        r->_left = n;
+        update(n);
+        update(r);
+        return r;
+    }
+
+    /**
+     * Restores the AVL property at n (children heights differ by at most 1),
+     * assuming that it holds for both children, and their heights differ by at most 2.
+     * Returns the new root of the subtree. O(1)
+     */
+    static Node *rebalance(Node *n) {
+        update(n);
+        int balance = height(n->_left) - height(n->_right);
+        if (balance > 1) { // left too tall
+            if (height(n->_left->_left) < height(n->_left->_right)) {
+                n->_left = rotateLeft(n->_left); // left-right case
+            }
+            return rotateRight(n);
+        } else if (balance < -1) { // right too tall
+            if (height(n->_right->_right) < height(n->_right->_left)) {
+                n->_right = rotateRight(n->_right); // right-left case
+            }
+            return rotateLeft(n);
+        }
+        return n;
+    }
+
+    /**
+     * Rebalances subtrees along a path, from its deepest link up to the root.
+     * Stops early if a subtree keeps its height, since nothing above can change;
+     * except in Ranked trees, where all sizes along the path have changed.
+     * O(log n)
+     */
+    static void rebalancePath(Node **path[], int depth) {
+        for (int i = depth - 1; i >= 0; --i) {
+            int before = (*path[i])->_height;
+            *path[i] = rebalance(*path[i]);
+            if (! Ranked && (*path[i])->_height == before) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Finds the 1st node with a elem >= elem (or > elem, if strict), and fills ancestors
+     * with the nodes an iterator would visit after it. Returns nullptr if none.
+     * This is the last node where the search turned left, so the stack is just
+     * the path of left turns without it.
+     * O(log n)
+     */
+    Node *boundAux(const T &elem, bool strict, Stack<Node*> &ancestors) const {
+        Node *p = _root;
+        while (p != nullptr) {
+            bool before = strict ? ! _cless(elem, p->_elem) : _cless(p->_elem, elem);
+            if (before) { // p->_elem < elem (or <=, if strict)
+                p = p->_right;
+            } else {
+                ancestors.push(p);
+                p = p->_left;
+            }
+        }
+        if (ancestors.empty()) {
             return nullptr;
-        } else if (p->_elem == elem) {
-            return p;
-        } else if (elem < p->_elem) {
-            return findAux(p->_left, elem);
-        } else {
-            return findAux(p->_right, elem);
         }
+        Node *ret = ancestors.top();
+        ancestors.pop();
+        return ret;
     }
 
     /**
-     * Removes (if found) an element at or below p
-     * If element at p, a modified (but valid) pointer will be returned 
-     * otherwise returns p.
+     * Finds the last node with a elem <= elem, and fills ancestors with the
+     * nodes an iterator would visit after it. Returns nullptr if none.
+     * This is the last node where the search turned right; left turns taken
+     * below it are discarded from the stack.
      * O(log n)
-    */
-    static Node* eraseAux(Node *p, const T &elem) {
-        if (p == nullptr)
+     */
+    Node *floorAux(const T &elem, Stack<Node*> &ancestors) const {
+        Node *p = _root;
+        Node *ret = nullptr;
+        int depth = 0;
+        while (p != nullptr) {
+            if (_cless(elem, p->_elem)) { // elem < p->_elem
+                ancestors.push(p);
+                p = p->_left;
+            } else {
+                ret = p;
+                depth = ancestors.size();
+                p = p->_right;
+            }
+        }
+        while (ancestors.size() > depth) {
+            ancestors.pop();
+        }
+        return ret;
+    }
+
+    /**
+     * Finds the k-th smallest node, and fills ancestors with the nodes
+     * an iterator would visit after it. Returns nullptr if k is out of range.
+     * O(log n)
+     */
+    Node *selectAux(int k, Stack<Node*> &ancestors) const {
+        if (k < 0 || k >= subtreeSize(_root)) {
             return nullptr;
-        if (elem == p->_elem) {
-            return eraseRoot(p);
-        } else if (elem < p->_elem) {
-            p->_left = eraseAux(p->_left, elem);
-            return p;
-        } else { // elem > p->elem
-            p->_right = eraseAux(p->_right, elem);
-            return p;
+        }
+        Node *p = _root;
+        while (true) {
+            int left = subtreeSize(p->_left);
+            if (k < left) {
+                ancestors.push(p);
+                p = p->_left;
+            } else if (k > left) {
+                k -= left + 1;
+                p = p->_right;
+            } else {
+                return p;
+            }
         }
     }
 
     /**
-     * Removes the root of a structure, and returns a pointer to the new root.
-     * O(log n) (only if a smallest element needs to be found)
+     * Links nodes [lo, hi) of a sorted array into a perfectly balanced tree,
+     * rooted at the middle one. Returns that root.
+     * O(hi - lo)
      */
-    static Node* eraseRoot(Node *p) {
-        Node *aux;
-        if (p->_left == nullptr) {// Si no hay hijo izquierdo, la raíz pasa a ser el hijo derecho
-            aux = p->_right;
-            delete p;
-            return aux;
-        } else
-        if (p->_right == nullptr) {// Si no hay hijo derecho, la raíz pasa a ser el hijo izquierdo
-            aux = p->_left;
-            delete p;
-            return aux;
-        } else { // both right and left nodes
-                 // smallest element will be moved to right subtree
-            return moveSmallestAndErase(p);
+    static Node *build(Node *nodes[], int lo, int hi) {
+        if (lo >= hi) {
+            return nullptr;
+        }
+        int mid = lo + (hi - lo) / 2;
+        Node *n = nodes[mid];
+        n->_left = build(nodes, lo, mid);
+        n->_right = build(nodes, mid + 1, hi);
+        update(n);
+        return n;
+    }
+
+    /** Appends the nodes of a subtree, in order, to a vector. O(n) */
+    static void inOrder(Node *n, std::vector<Node*> &out) {
+        if (n != nullptr) {
+            inOrder(n->_left, out);
+            out.push_back(n);
+            inOrder(n->_right, out);
         }
     }
 
+    // //
+    // SPLIT AND JOIN
+    // //
+
     /**
-     * Finds smallest element in right subtree, which will be used as new root.
-     *   - Smallest will be new right child
-     *   - Left child of old smallest's parent will be the new left child
+     * Splits a subtree into the nodes with elements < elem, returned in below,
+     * and those with elements >= elem, returned in rest. Both are valid AVL trees.
      * O(log n)
      */
-    static Node *moveSmallestAndErase(Node *p) {
-        /*
-         * Find smallest & its immediate parent
-         */
-        Node *parent = nullptr;
-        Node *aux = p->_right;
-        while (aux->_left != nullptr) {
-            parent = aux;
-            aux = aux->_left;
+    void split(Node *n, const T &elem, Node *&below, Node *&rest) {
+        if (n == nullptr) {
+            below = rest = nullptr;
+            return;
         }
-        if (parent != nullptr) { // parent found, switch
-            parent->_left = aux->_right;
-            aux->_left = p->_left;
-            aux->_right = p->_right;
-        } else { // no parent - was already root
-            aux->_left = p->_left;
+        Node *left = n->_left;
+        Node *right = n->_right;
+        if (_cless(n->_elem, elem)) { // n and its left subtree go below
+            Node *rightBelow;
+            split(right, elem, rightBelow, rest);
+            below = join(left, n, rightBelow);
+        } else { // n and its right subtree go to rest
+            Node *leftRest;
+            split(left, elem, below, leftRest);
+            rest = join(leftRest, n, right);
         }
+    }
 
-        delete p;
-        return aux;
+    /**
+     * Joins 2 AVL trees and a node between them (all elements in left < mid's < all in right)
+     * into a single AVL tree. Descends along the taller tree until reaching a subtree
+     * as tall as the other tree, hangs both from mid there, and rebalances back up.
+     * O(difference in heights)
+     */
+    static Node *join(Node *left, Node *mid, Node *right) {
+        if (height(left) > height(right) + 1) {
+            left->_right = join(left->_right, mid, right);
+            return rebalance(left);
+        } else if (height(right) > height(left) + 1) {
+            right->_left = join(left, mid, right->_left);
+            return rebalance(right);
+        }
+        mid->_left = left;
+        mid->_right = right;
+        update(mid);
+        return mid;
     }
 
+    /**
+     * Joins 2 AVL trees (all elements in left < all in right) into a single AVL tree,
+     * using the smallest node of right as the one between them.
+     * O(log n)
+     */
+    static Node *join(Node *left, Node *right) {
+        if (right == nullptr) {
+            return left;
+        }
+        Node *smallest;
+        right = removeSmallest(right, smallest);
+        return join(left, smallest, right);
+    }
+
+    /**
+     * Unlinks the smallest node of a non-empty AVL tree, returning it in smallest.
+     * Returns the rest of the tree, rebalanced.
+     * O(log n)
+     */
+    static Node *removeSmallest(Node *n, Node *&smallest) {
+        if (n->_left == nullptr) {
+            smallest = n;
+            return n->_right;
+        }
+        n->_left = removeSmallest(n->_left, smallest);
+        return rebalance(n);
+    }
 
     static void outputIndented(std::ostream & out, int indent, Node* root){
         if (root != nullptr) {
@@ -540,6 +1164,44 @@ private:
      * Root node
      */
     Node *_root;
+
+    /**
+     * Comparator
+     */
+    Comparator _cless;
+
+    /**
+     * Allocator for all nodes in this set
+     */
+    NodePool<Node> _pool;
+
+#ifdef ADT_STATS
+    /** Calls to findAux, and key comparisons made by them */
+    mutable StatCounter _lookups, _comparisons;
+
+    /** Counts the nodes at each depth of the subtree at p, which is at the given depth */
+    static void countDepths(const Node *p, unsigned int depth, std::vector<unsigned int> &depths) {
+        for (/**/; p != nullptr; p = p->_right, depth++) {
+            stats_detail::count(depths, depth);
+            countDepths(p->_left, depth + 1, depths);
+        }
+    }
+
+public:
+
+    /** Snapshot of stats counters, plus a histogram of node depths. O(n) */
+    TreeStats stats() const {
+        TreeStats s;
+        countDepths(_root, 0, s.depths);
+        for (unsigned int n : s.depths) {
+            s.nodes += n;
+        }
+        s.lookups = _lookups.get();
+        s.comparisons = _comparisons.get();
+        s.alloc = _pool.alloc_stats();
+        return s;
+    }
+#endif
 };
 
 #endif // __TREESET_H
@@ -0,0 +1,634 @@
+/**
+ * Implementation of the List ADT, with an unrolled doubly-linked list
+ * Each node ("chunk") holds a small array of elements, instead of a single one.
+ */
+#ifndef __UNROLLED_LIST_H
+#define __UNROLLED_LIST_H
+
+#include "Exceptions.h"
+#include <algorithm>    // move, move_backward
+#include <cassert>
+#include <new>          // placement new
+#include <utility>      // move, forward
+
+/** Default elements per chunk: as many as fit in 256 bytes, but never fewer than 4 */
+template <typename T>
+constexpr unsigned int defaultChunkSize() {
+    return (sizeof(T) * 4 > 256) ? 4 : 256 / sizeof(T);
+}
+
+/**
+ * List with the same interface as List.h, but which stores up to ChunkSize
+ * consecutive elements in each node. Per-element overhead drops from two
+ * pointers to a fraction of one, and sequential scans read mostly
+ * contiguous memory. Operations:
+ *    - EmptyList: -> List. Generator (as empty constructor)
+ *    - push_front: List, Elem -> List. Generator. Also emplace_front(args...), building in place
+ *    - push_back: List, Elem -> List. Mutator. Also emplace_back(args...), building in place
+ *    - front: List - -> Elem. Observer, partial
+ *    - pop_front: List - -> List. Mutator, partial
+ *    - back: List - -> Elem. Observer, partial
+ *    - pop_back: List - -> List. Mutator, partial
+ *    - empty: List -> Bool. Observer
+ *    - size: List -> Int. Observer
+ *    - at: List, Int - -> Elem. Observer, partial. O(n / ChunkSize)
+ *    - insert(elem, it), emplace(it, args...), erase(it): Mutators. Insert just
+ *          before, or remove, the element at an iterator
+ *
+ * Elements within a chunk are kept contiguous, from its 1st position on.
+ * Operations at both ends, and at iterators, shift at most one chunk's worth of
+ * elements, which is O(ChunkSize): still O(1), but not free. A full chunk that
+ * gets an insertion is split in two halves; a chunk that drops below half-full
+ * after an erase takes elements from the next one (or merges with it), so that
+ * chunks are kept reasonably full.
+ *
+ * Unlike with List.h, since elements are moved between positions, insert,
+ * emplace and erase invalidate all iterators to the chunk(s) they touch,
+ * except for the one they return; and pushes and pops invalidate iterators
+ * to the 1st or last chunk.
+ */
+template <class T, unsigned int ChunkSize = defaultChunkSize<T>()>
+class UnrolledList {
+    static_assert(ChunkSize >= 2, "UnrolledList requires room for at least 2 elements per chunk");
+
+private:
+    /**
+     * Chunk class. Stores up to ChunkSize elements, in uninitialized storage,
+     * and pointers to previous and next chunks.
+     * Positions [0, _count) hold elements; the rest are unused.
+     */
+    class Chunk {
+    public:
+        Chunk(Chunk *prev, Chunk *next) : _prev(prev), _next(next), _count(0) {}
+
+        T *elems() {
+            return reinterpret_cast<T *>(_storage);
+        }
+
+        bool full() const {
+            return _count == ChunkSize;
+        }
+
+        Chunk *_prev;
+        Chunk *_next;
+        unsigned int _count;
+        alignas(T) unsigned char _storage[ChunkSize * sizeof(T)];
+    };
+
+public:
+
+    /** Constructor; EmptyList. O(1) */
+    UnrolledList() : _first(nullptr), _last(nullptr), _size(0) {}
+
+    /** Destructor; frees list. O(n) */
+    ~UnrolledList() {
+        free();
+    }
+
+    /** Adds an an element at the front. O(ChunkSize) */
+    void push_front(const T &_elem) {
+        emplace_front(_elem);
+    }
+
+    /** Adds an an element at the front, moving it instead of copying it. O(ChunkSize) */
+    void push_front(T &&_elem) {
+        emplace_front(std::move(_elem));
+    }
+
+    /** Adds an element at the front, built in place from the given constructor arguments. O(ChunkSize) */
+    template <typename... Args>
+    void emplace_front(Args&&... args) {
+        if (_first == nullptr || _first->full()) {
+            insertIntoNewChunk(nullptr, _first, std::forward<Args>(args)...);
+        } else {
+            insertAt(_first, 0, std::forward<Args>(args)...);
+        }
+    }
+
+    /** Adds an element at the back. O(1) */
+    void push_back(const T &_elem) {
+        emplace_back(_elem);
+    }
+
+    /** Adds an element at the back, moving it instead of copying it. O(1) */
+    void push_back(T &&_elem) {
+        emplace_back(std::move(_elem));
+    }
+
+    /** Adds an element at the back, built in place from the given constructor arguments. O(1) */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (_last == nullptr || _last->full()) {
+            insertIntoNewChunk(_last, nullptr, std::forward<Args>(args)...);
+        } else {
+            insertAt(_last, _last->_count, std::forward<Args>(args)...);
+        }
+    }
+
+    /**
+     * Returns 1st (front) element. It is an error to do this on an empty list.
+     * O(1)
+     */
+    const T &front() const {
+        if (empty())
+            throw EmptyListException("Cannot get front. The list is empty.");
+        return _first->elems()[0];
+    }
+
+    /**
+     * Returns last (back) element. It is an error to do this on an empty list.
+     * O(1)
+     */
+    const T &back() const {
+        if (empty())
+            throw EmptyListException("Cannot get back. The list is empty.");
+        return _last->elems()[_last->_count - 1];
+    }
+
+    /**
+     * Removes 1st element. It is an error to do this on an empty list.
+     * O(ChunkSize)
+     */
+    void pop_front() {
+        if (empty())
+            throw EmptyListException("Cannot pop. The list is empty.");
+        eraseAt(_first, 0);
+    }
+
+    /**
+     * Removes last element. It is an error to do this on an empty list.
+     * O(1)
+     */
+    void pop_back() {
+        if (empty())
+            throw EmptyListException("Cannot pop. The list is empty.");
+        _last->elems()[--_last->_count].~T();
+        _size--;
+        if (_last->_count == 0) {
+            deleteChunk(_last);
+        }
+    }
+
+    /** True IFF the list has no elements. O(1) */
+    bool empty() const {
+        return _first == nullptr;
+    }
+
+    /** Returns the number of elements in the list. O(1) */
+    unsigned int size() const {
+        return _size;
+    }
+
+    /**
+     * Returns the idx-th element, where the 1st one is at 0 and the last one at size()-1.
+     * Partial observer; fails if idx is out of range.
+     * Skips whole chunks, starting from the closest end: O(n / ChunkSize)
+     */
+    const T &at(unsigned int idx) const {
+        if (idx >= _size)
+            throw InvalidAccessException("Cannot get specified element. Invalid index");
+        Chunk *chunk;
+        if (idx < _size / 2) {
+            chunk = _first;
+            while (idx >= chunk->_count) {
+                idx -= chunk->_count;
+                chunk = chunk->_next;
+            }
+        } else {
+            // count from the back: rest is the number of elements from idx to the end
+            unsigned int rest = _size - idx;
+            chunk = _last;
+            while (rest > chunk->_count) {
+                rest -= chunk->_count;
+                chunk = chunk->_prev;
+            }
+            idx = chunk->_count - rest;
+        }
+        return chunk->elems()[idx];
+    }
+
+    // //
+    // ITERATORS
+    // //
+
+    /**
+     * Iterator over the list, which allows walking through all its elements,
+     * but not changing them.
+     */
+    class ConstIterator {
+    public:
+        ConstIterator() : _chunk(nullptr), _idx(0) {}
+
+        void next() {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            if (++_idx == _chunk->_count) {
+                _chunk = _chunk->_next;
+                _idx = 0;
+            }
+        }
+
+        const T &_elem() const {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            return _chunk->elems()[_idx];
+        }
+
+        bool operator==(const ConstIterator &other) const {
+            return _chunk == other._chunk && _idx == other._idx;
+        }
+
+        bool operator!=(const ConstIterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        const T& operator*() const {
+            return _elem();
+        }
+
+        ConstIterator &operator++() {
+            next();
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        /** Allows lists to create iterators */
+        friend class UnrolledList;
+
+        ConstIterator(Chunk *chunk, unsigned int idx) : _chunk(chunk), _idx(idx) {}
+
+        /** Chunk being iterated; nullptr if past the end */
+        Chunk *_chunk;
+
+        /** Position of current element in chunk */
+        unsigned int _idx;
+    };
+
+    /**
+     * Iterator over the list, which allows walking through all its elements,
+     * and changing their values.
+     */
+    class Iterator {
+    public:
+        Iterator() : _chunk(nullptr), _idx(0) {}
+
+        void next() {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            if (++_idx == _chunk->_count) {
+                _chunk = _chunk->_next;
+                _idx = 0;
+            }
+        }
+
+        const T &_elem() const {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            return _chunk->elems()[_idx];
+        }
+
+        void set(const T &_elem) const {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            _chunk->elems()[_idx] = _elem;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _chunk == other._chunk && _idx == other._idx;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return !(this->operator==(other));
+        }
+
+        const T& operator*() const {
+            return _elem();
+        }
+
+        /** same as _elem(), but non-const */
+        T& operator*() {
+            if (_chunk == nullptr) throw InvalidAccessException();
+            return _chunk->elems()[_idx];
+        }
+
+        Iterator &operator++() {
+            next();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+    protected:
+        /** Allows lists to create iterators */
+        friend class UnrolledList;
+
+        Iterator(Chunk *chunk, unsigned int idx) : _chunk(chunk), _idx(idx) {}
+
+        /** Chunk being iterated; nullptr if past the end */
+        Chunk *_chunk;
+
+        /** Position of current element in chunk */
+        unsigned int _idx;
+    };
+
+    // //
+    // OPERATORS ON ITERATORS
+    // //
+
+    /** Const iterator, starting at 1st element. O(1) */
+    ConstIterator cbegin() const {
+        return ConstIterator(_first, 0);
+    }
+
+    /** Const iterator at after-last element. O(1) */
+    ConstIterator cend() const {
+        return ConstIterator(nullptr, 0);
+    }
+
+    /** Non-const iterator, starting at 1st element. O(1) */
+    Iterator begin() {
+        return Iterator(_first, 0);
+    }
+
+    /** Non-const iterator at after-last element. O(1) */
+    Iterator end() const {
+        return Iterator(nullptr, 0);
+    }
+
+    /**
+     * Removes element at current position.
+     * The passed-in iterator is NO LONGER VALID. Use the returned iterator instead,
+     * which will point to the next element in the list (the one that was next to the removed one).
+     * @return New iterator pointing to the element that was after the removed one
+     * O(ChunkSize).
+     */
+    Iterator erase(const Iterator &it) {
+        if (it._chunk == nullptr)
+            throw InvalidAccessException("Cannot erase specified element. Iterator pointing to nullptr");
+        return eraseAt(it._chunk, it._idx);
+    }
+
+    /**
+     * Inserts just before current element; see List::insert.
+     * Returns an iterator to the element it pointed to, which may have moved. O(ChunkSize).
+     */
+    Iterator insert(const T &_elem, const Iterator &it) {
+        return emplace(it, _elem);
+    }
+
+    /** Inserts at current location, moving the element instead of copying it. O(ChunkSize) */
+    Iterator insert(T &&_elem, const Iterator &it) {
+        return emplace(it, std::move(_elem));
+    }
+
+    /**
+     * Inserts just before current location an element built in place from
+     * the given constructor arguments. Returns an iterator to the element it
+     * pointed to, which may have moved. O(ChunkSize)
+     */
+    template <typename... Args>
+    Iterator emplace(const Iterator &it, Args&&... args) {
+        if (it._chunk == nullptr) {
+            // Special case: insert at end
+            emplace_back(std::forward<Args>(args)...);
+            return end();
+        }
+        Chunk *chunk = it._chunk;
+        unsigned int idx = it._idx;
+        if (idx == 0 && chunk->_prev != nullptr && ! chunk->_prev->full()) {
+            // append to previous chunk; nothing moves
+            insertAt(chunk->_prev, chunk->_prev->_count, std::forward<Args>(args)...);
+            return it;
+        }
+        if (chunk->full()) {
+            split(chunk);
+            if (idx >= chunk->_count) {
+                // element at it moved to the new chunk; keep new element next to it
+                idx -= chunk->_count;
+                chunk = chunk->_next;
+            }
+        }
+        insertAt(chunk, idx, std::forward<Args>(args)...);
+        return Iterator(chunk, idx + 1);
+    }
+
+    // //
+    // C++ Boilerplate code to make class more useful
+    // //
+
+    /** Copy ctor. O(n) */
+    UnrolledList(const UnrolledList &other) : _first(nullptr), _last(nullptr), _size(0) {
+        copy(other);
+    }
+
+    /** Assignment op. O(n) */
+    UnrolledList &operator=(const UnrolledList &other) {
+        if (this != &other) {
+            free();
+            copy(other);
+        }
+        return *this;
+    }
+
+    /** Move ctor; takes over all chunks, leaving other empty. O(1) */
+    UnrolledList(UnrolledList &&other) noexcept : _first(nullptr), _last(nullptr), _size(0) {
+        moveFrom(other);
+    }
+
+    /** Move assignment op; frees current chunks and takes over those of other. O(n) */
+    UnrolledList &operator=(UnrolledList &&other) noexcept {
+        if (this != &other) {
+            free();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    /** Equality op. O(n) */
+    bool operator==(const UnrolledList &rhs) const {
+        if (_size != rhs._size) {
+            return false;
+        }
+        for (ConstIterator a = cbegin(), b = rhs.cbegin(); a != cend(); ++a, ++b) {
+            if (*a != *b) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const UnrolledList &rhs) const {
+        return !(*this == rhs);
+    }
+
+protected:
+
+    /** Destroys all elements and frees all chunks. O(n) */
+    void free() {
+        while (_first != nullptr) {
+            Chunk *next = _first->_next;
+            destroyRange(_first->elems(), _first->elems() + _first->_count);
+            delete _first;
+            _first = next;
+        }
+        _last = nullptr;
+        _size = 0;
+    }
+
+    /** Takes over the chunks of other, which must be freed; leaves other empty */
+    void moveFrom(UnrolledList &other) {
+        _first = other._first;
+        _last = other._last;
+        _size = other._size;
+        other._first = other._last = nullptr;
+        other._size = 0;
+    }
+
+    /** Copies via push_back, which fills chunks completely */
+    void copy(const UnrolledList &other) {
+        for (ConstIterator it = other.cbegin(); it != other.cend(); ++it) {
+            push_back(*it);
+        }
+    }
+
+private:
+
+    static void destroyRange(T *begin, T *end) {
+        for (; begin != end; ++begin) {
+            begin->~T();
+        }
+    }
+
+    /** Inserts a new, empty chunk between chunk1 & chunk2 (either may be nullptr). O(1) */
+    Chunk *insertChunk(Chunk *chunk1, Chunk *chunk2) {
+        Chunk *chunk = new Chunk(chunk1, chunk2);
+        if (chunk1 != nullptr)
+            chunk1->_next = chunk;
+        else
+            _first = chunk;
+        if (chunk2 != nullptr)
+            chunk2->_prev = chunk;
+        else
+            _last = chunk;
+        return chunk;
+    }
+
+    /** Unlinks and frees an empty chunk. O(1) */
+    void deleteChunk(Chunk *chunk) {
+        assert(chunk->_count == 0);
+        if (chunk->_prev != nullptr)
+            chunk->_prev->_next = chunk->_next;
+        else
+            _first = chunk->_next;
+        if (chunk->_next != nullptr)
+            chunk->_next->_prev = chunk->_prev;
+        else
+            _last = chunk->_prev;
+        delete chunk;
+    }
+
+    /**
+     * Inserts an element, built from args, as the only one of a new chunk linked
+     * between chunk1 and chunk2 (either may be nullptr). If building it throws, the
+     * chunk is unlinked and freed again, so that chunks are never left empty. O(1)
+     */
+    template <typename... Args>
+    void insertIntoNewChunk(Chunk *chunk1, Chunk *chunk2, Args&&... args) {
+        Chunk *chunk = insertChunk(chunk1, chunk2);
+        try {
+            insertAt(chunk, 0, std::forward<Args>(args)...);
+        } catch (...) {
+            deleteChunk(chunk);
+            throw;
+        }
+    }
+
+    /**
+     * Inserts an element, built from args, at position idx of a non-full chunk,
+     * shifting later elements one position up. O(ChunkSize)
+     */
+    template <typename... Args>
+    void insertAt(Chunk *chunk, unsigned int idx, Args&&... args) {
+        assert( ! chunk->full() && idx <= chunk->_count);
+        T *elems = chunk->elems();
+        unsigned int count = chunk->_count;
+        if (idx == count) {
+            new (elems + count) T(std::forward<Args>(args)...);
+        } else {
+            // built before anything moves, in case it throws
+            T elem(std::forward<Args>(args)...);
+            new (elems + count) T(std::move(elems[count - 1]));
+            std::move_backward(elems + idx, elems + count - 1, elems + count);
+            elems[idx] = std::move(elem);
+        }
+        chunk->_count++;
+        _size++;
+    }
+
+    /**
+     * Removes element idx of a chunk, and rebalances it with the next chunk if it
+     * becomes less than half-full. Returns an iterator to the following element. O(ChunkSize)
+     */
+    Iterator eraseAt(Chunk *chunk, unsigned int idx) {
+        T *elems = chunk->elems();
+        std::move(elems + idx + 1, elems + chunk->_count, elems + idx);
+        elems[--chunk->_count].~T();
+        _size--;
+
+        Chunk *next = chunk->_next;
+        if (chunk->_count == 0) {
+            deleteChunk(chunk);
+            return Iterator(next, 0);
+        }
+        if (next != nullptr && chunk->_count < ChunkSize / 2) {
+            if (chunk->_count + next->_count <= ChunkSize) {
+                // merge next into chunk
+                moveRange(next->elems(), next->_count, elems + chunk->_count);
+                chunk->_count += next->_count;
+                next->_count = 0;
+                deleteChunk(next);
+            } else {
+                // take 1st element of next
+                new (elems + chunk->_count) T(std::move(next->elems()[0]));
+                chunk->_count++;
+                _size++;     // eraseAt will subtract it again
+                eraseAt(next, 0);
+            }
+        }
+        // elements after idx, if any, are still in chunk; otherwise, next one is 1st of next chunk
+        if (idx < chunk->_count) {
+            return Iterator(chunk, idx);
+        }
+        return Iterator(chunk->_next, 0);
+    }
+
+    /** Moves the upper half of a full chunk into a new chunk that follows it. O(ChunkSize) */
+    void split(Chunk *chunk) {
+        Chunk *half = insertChunk(chunk, chunk->_next);
+        unsigned int keep = ChunkSize / 2;
+        moveRange(chunk->elems() + keep, ChunkSize - keep, half->elems());
+        half->_count = ChunkSize - keep;
+        chunk->_count = keep;
+    }
+
+    /** Move-constructs n elements into uninitialized dest, and destroys the originals */
+    static void moveRange(T *src, unsigned int n, T *dest) {
+        for (unsigned int i = 0; i < n; ++i) {
+            new (dest + i) T(std::move(src[i]));
+            src[i].~T();
+        }
+    }
+
+    // Pointers to 1st and last chunks. Both nullptr for empty lists; chunks are never empty
+    Chunk *_first, *_last;
+
+    // Element count
+    unsigned int _size;
+};
+
+#endif // __UNROLLED_LIST_H
@@ -0,0 +1,821 @@
+/**
+ * Benchmark suite: the general-purpose ADTs of adts/, each next to its std:: counterpart
+ *
+ * Build & run (from the repository root), with CMake:
+ *     cmake -S . -B build
+ *     cmake --build build --target bench     (builds all benchmarks, then runs this one)
+ * or by hand:
+ *     g++ -O2 -std=c++17 -Iadts bench/AdtBench.cpp -o adt-bench
+ *     ./adt-bench [n] [filter]     (defaults to 100000, and every case)
+ *
+ * Covers List, ListLinkedSingle, Stack, LinkedListStack, Queue, BinTree,
+ * BinTreeSmart, TreeSet, TreeMap and HashMap, with int, 8-char and 64-char string
+ * elements (64-char strings share long prefixes, as paths or URLs do), n at a time:
+ *    - TreeSet, TreeMap and HashMap vs. std::set, std::map and std::unordered_map:
+ *          random and sorted inserts, lookups of present and absent keys, iteration,
+ *          copies, and a mix of 80% lookups and 20% inserts and erases.
+ *    - List, ListLinkedSingle, Stack, LinkedListStack and Queue vs. std::list,
+ *          std::forward_list, std::stack (twice) and std::queue: pushes, pops, copies,
+ *          a mix of 60% pushes and 40% pops, and iteration where supported.
+ *    - BinTree, BinTreeSmart and BinTreeSmart with IntrusiveLinks, which have no
+ *          std:: counterpart and are compared with each other: building balanced
+ *          trees, in-order iteration, and (shared, O(1)) copies.
+ *
+ * For each case, reports
+ *    - throughput, in operations per second. An operation is a single insert, lookup,
+ *          push, pop or node built, an element visited, or a whole copy.
+ *    - latency percentiles (p50, p90, p99) per operation. Each operation is timed on
+ *          its own, minus the cost of reading the clock (measured at startup), and
+ *          counted in a histogram with buckets 1/16 of a power of 2 wide: percentiles
+ *          are accurate to about 6%, but operations faster than the jitter of clock
+ *          readings (a few ns) are not resolved.
+ *    - peak RSS (maximum resident memory). On Unix, each case runs in a child process
+ *          of its own, so that this measures that case (plus the runner, which uses
+ *          very little memory); elsewhere, it is not reported.
+ * filter selects the cases whose name contains it, such as "TreeMap" or "string64".
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <forward_list>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define __BENCH_FORK
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "List.h"
+#include "ListSingle.h"
+#include "Stack.h"
+#include "LinkedListStack.h"
+#include "Queue.h"
+#include "BinTree.h"
+#include "BinTreeSmart.h"
+#include "TreeSet.h"
+#include "TreeMap.h"
+#include "HashMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+/** Copies made by copy cases */
+static const unsigned int COPIES = 20;
+
+/** Times each element or key is visited by iteration cases */
+static const unsigned int ROUNDS = 10;
+
+/** Elements or keys per case */
+static unsigned int n = 100000;
+
+// //
+// Timing
+// //
+
+/** What is reported for a case; plain data, so that it can be sent through a pipe */
+struct Result {
+    double seconds;
+    unsigned long ops;
+    double p50, p90, p99; // nanoseconds per operation
+    long peakKb;          // -1 if unknown
+};
+
+/** Nanoseconds taken by a Clock::now() call; subtracted from each timed operation */
+static std::uint64_t clockOverhead = 0;
+
+/** Median of the time between consecutive clock readings; call before timing anything */
+static void calibrateClock() {
+    std::vector<std::uint64_t> gaps(10001);
+    Clock::time_point last = Clock::now();
+    for (std::uint64_t &gap : gaps) {
+        Clock::time_point now = Clock::now();
+        gap = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
+    }
+    std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+    clockOverhead = gaps[gaps.size() / 2];
+}
+
+/**
+ * Counts of latencies, in nanoseconds, in a fixed array (so that recording them
+ * neither allocates nor adds to the peak RSS of a case). Values below 16 have a
+ * bucket each; above, each power of 2 is split into 16 buckets.
+ */
+class Histogram {
+public:
+    Histogram() : _total(0) {
+        _counts.fill(0);
+    }
+
+    void add(std::uint64_t ns) {
+        _counts[bucket(ns)]++;
+        _total++;
+    }
+
+    /** Smallest latency that is >= a fraction q of all those added; middle of its bucket */
+    double percentile(double q) const {
+        if (_total == 0) {
+            return 0;
+        }
+        unsigned long rank = static_cast<unsigned long>(q * (_total - 1));
+        unsigned long seen = 0;
+        unsigned int b = 0;
+        while (seen + _counts[b] <= rank) {
+            seen += _counts[b++];
+        }
+        if (b < SUB) {
+            return b;
+        }
+        unsigned int shift = b / SUB - 1;
+        return (static_cast<double>(SUB + b % SUB) + 0.5) * (1ull << shift);
+    }
+
+private:
+    static const unsigned int SUB = 16;
+    /** Up to 2^40 ns (about 18 minutes); longer ones go to the last bucket */
+    static const unsigned int BUCKETS = SUB * 37;
+
+    static unsigned int bucket(std::uint64_t ns) {
+        if (ns < SUB) {
+            return static_cast<unsigned int>(ns);
+        }
+        unsigned int shift = 0;
+        while ((ns >> shift) >= 2 * SUB) {
+            shift++;
+        }
+        unsigned int b = (shift + 1) * SUB + static_cast<unsigned int>((ns >> shift) - SUB);
+        return (b < BUCKETS) ? b : BUCKETS - 1;
+    }
+
+    std::array<unsigned long, BUCKETS> _counts;
+    unsigned long _total;
+};
+
+/**
+ * Times operations one at a time: start() before the first one (setup before
+ * that is not timed), and tick() after each. Work between a tick() and the next
+ * start() is not timed either.
+ */
+class Timer {
+public:
+    Timer() : _ops(0), _nanos(0) {}
+
+    void start() {
+        _last = Clock::now();
+    }
+
+    void tick() {
+        Clock::time_point now = Clock::now();
+        std::uint64_t ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - _last).count());
+        ns = (ns > clockOverhead) ? ns - clockOverhead : 0;
+        _nanos += ns;
+        _latencies.add(ns);
+        _ops++;
+        _last = now;
+    }
+
+    /** Throughput and percentiles of all operations so far */
+    Result result() const {
+        Result r;
+        r.ops = _ops;
+        r.seconds = _nanos / 1e9;
+        r.p50 = _latencies.percentile(0.5);
+        r.p90 = _latencies.percentile(0.9);
+        r.p99 = _latencies.percentile(0.99);
+        r.peakKb = -1;
+        return r;
+    }
+
+private:
+    unsigned long _ops;
+    std::uint64_t _nanos;
+    Clock::time_point _last;
+    Histogram _latencies;
+};
+
+// //
+// Keys and elements
+// //
+
+/** Scrambles ids into distinct, unordered 32-bit values (odd multiplier: a bijection) */
+static std::uint32_t scramble(std::uint32_t id) {
+    return id * 2654435761u;
+}
+
+struct IntKeys {
+    using type = int;
+    static constexpr const char *NAME = "int";
+    static int make(std::uint32_t id) {
+        return static_cast<int>(scramble(id));
+    }
+};
+
+/** 'k' + 7 base-26 digits, enough to spell any 32-bit value */
+struct ShortKeys {
+    using type = std::string;
+    static constexpr const char *NAME = "string8";
+    static std::string make(std::uint32_t id) {
+        std::string s(8, 'k');
+        std::uint32_t v = scramble(id);
+        for (int i = 7; i > 0; i--, v /= 26) {
+            s[i] = static_cast<char>('a' + v % 26);
+        }
+        return s;
+    }
+};
+
+/** One of 4 shared 56-char prefixes, + a short key */
+struct LongKeys {
+    using type = std::string;
+    static constexpr const char *NAME = "string64";
+    static std::string make(std::uint32_t id) {
+        std::string s = "/srv/bench/datasets/collection-" + std::to_string(id % 4) + "/";
+        s.resize(56, '_');
+        return s + ShortKeys::make(id);
+    }
+};
+
+/** n keys in random order, the same keys sorted, and n other keys */
+template <class Kind>
+struct Keys {
+    using K = typename Kind::type;
+
+    std::vector<K> present, sorted, absent;
+
+    Keys() {
+        for (std::uint32_t id = 0; id < n; id++) {
+            present.push_back(Kind::make(id));
+            absent.push_back(Kind::make(n + id));
+        }
+        sorted = present;
+        std::sort(sorted.begin(), sorted.end());
+    }
+};
+
+/** Reads an element, so that visiting it is not optimized away */
+static unsigned long touch(int x) {
+    return static_cast<unsigned int>(x);
+}
+
+static unsigned long touch(const std::string &s) {
+    return static_cast<unsigned char>(s.back());
+}
+
+/**
+ * Operation codes for mixed cases, the same for all containers:
+ * r % 100 < readPercent reads, and the rest write.
+ */
+static std::vector<unsigned char> mixedOps(unsigned int readPercent) {
+    std::mt19937 rng(42);
+    std::vector<unsigned char> ops(n);
+    for (unsigned char &op : ops) {
+        op = static_cast<unsigned char>(rng() % 100 < readPercent ? 0 : 1 + rng() % 2);
+    }
+    return ops;
+}
+
+// //
+// Uniform operations on sets and maps, ADT and std::
+// //
+
+template <class T> void add(TreeSet<T> &c, const T &k) { c.insert(k); }
+template <class T> void add(std::set<T> &c, const T &k) { c.insert(k); }
+template <class K, class V> void add(TreeMap<K, V> &c, const K &k) { c.insert(k, V()); }
+template <class K, class V> void add(std::map<K, V> &c, const K &k) { c.emplace(k, V()); }
+template <class K, class V> void add(HashMap<K, V> &c, const K &k) { c.insert(k, V()); }
+template <class K, class V> void add(std::unordered_map<K, V> &c, const K &k) { c.emplace(k, V()); }
+
+template <class T> bool has(const TreeSet<T> &c, const T &k) { return c.contains(k); }
+template <class T> bool has(const std::set<T> &c, const T &k) { return c.count(k) != 0; }
+template <class K, class V> bool has(const TreeMap<K, V> &c, const K &k) { return c.contains(k); }
+template <class K, class V> bool has(const std::map<K, V> &c, const K &k) { return c.count(k) != 0; }
+template <class K, class V> bool has(const HashMap<K, V> &c, const K &k) { return c.contains(k); }
+template <class K, class V> bool has(const std::unordered_map<K, V> &c, const K &k) { return c.count(k) != 0; }
+
+/** Visits all elements, calling tick() for each */
+template <class T>
+unsigned long visit(const TreeSet<T> &c, Timer &t) {
+    unsigned long acc = 0;
+    for (auto it = c.cbegin(); it != c.cend(); ++it) {
+        acc += touch(*it);
+        t.tick();
+    }
+    return acc;
+}
+
+template <class T>
+unsigned long visit(const std::set<T> &c, Timer &t) {
+    unsigned long acc = 0;
+    for (const T &k : c) {
+        acc += touch(k);
+        t.tick();
+    }
+    return acc;
+}
+
+/** TreeMaps and HashMaps */
+template <class M>
+unsigned long visitMap(const M &c, Timer &t) {
+    unsigned long acc = 0;
+    for (auto it = c.cbegin(); it != c.cend(); ++it) {
+        acc += touch(it.key()) + it.value();
+        t.tick();
+    }
+    return acc;
+}
+
+template <class K, class V>
+unsigned long visit(const TreeMap<K, V> &c, Timer &t) {
+    return visitMap(c, t);
+}
+
+template <class K, class V>
+unsigned long visit(const HashMap<K, V> &c, Timer &t) {
+    return visitMap(c, t);
+}
+
+template <class K, class V>
+unsigned long visit(const std::map<K, V> &c, Timer &t) {
+    unsigned long acc = 0;
+    for (const auto &p : c) {
+        acc += touch(p.first) + p.second;
+        t.tick();
+    }
+    return acc;
+}
+
+template <class K, class V>
+unsigned long visit(const std::unordered_map<K, V> &c, Timer &t) {
+    unsigned long acc = 0;
+    for (const auto &p : c) {
+        acc += touch(p.first) + p.second;
+        t.tick();
+    }
+    return acc;
+}
+
+// //
+// Cases for sets and maps
+// //
+
+template <class C, class Kind>
+void insertRandom(Timer &t) {
+    Keys<Kind> keys;
+    C c;
+    t.start();
+    for (const auto &k : keys.present) {
+        add(c, k);
+        t.tick();
+    }
+}
+
+template <class C, class Kind>
+void insertSorted(Timer &t) {
+    Keys<Kind> keys;
+    C c;
+    t.start();
+    for (const auto &k : keys.sorted) {
+        add(c, k);
+        t.tick();
+    }
+}
+
+/** Looks up (in random order) either the keys in c, or as many that are not */
+template <class C, class Kind, bool Hits>
+void lookup(Timer &t) {
+    Keys<Kind> keys;
+    C c;
+    for (const auto &k : keys.present) {
+        add(c, k);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (const auto &k : (Hits ? keys.present : keys.absent)) {
+        acc += has(c, k);
+        t.tick();
+    }
+    sink = acc;
+}
+
+template <class C, class Kind>
+void iterate(Timer &t) {
+    Keys<Kind> keys;
+    C c;
+    for (const auto &k : keys.present) {
+        add(c, k);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        acc += visit(c, t);
+    }
+    sink = acc;
+}
+
+/** Times copying a container of n elements; destroying it is not timed */
+template <class C, class Fill>
+void copyOf(Timer &t, Fill fill) {
+    C c;
+    fill(c);
+    for (unsigned int r = 0; r < COPIES; r++) {
+        t.start();
+        C *copy = new C(c);
+        t.tick();
+        delete copy;
+    }
+}
+
+template <class C, class Kind>
+void copyAssociative(Timer &t) {
+    Keys<Kind> keys;
+    copyOf<C>(t, [&keys](C &c) {
+        for (const auto &k : keys.present) {
+            add(c, k);
+        }
+    });
+}
+
+/** 80% lookups (alternating hits and misses), 10% inserts and 10% erases */
+template <class C, class Kind>
+void mixedAssociative(Timer &t) {
+    Keys<Kind> keys;
+    std::vector<unsigned char> ops = mixedOps(80);
+    C c;
+    for (const auto &k : keys.present) {
+        add(c, k);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int i = 0; i < n; i++) {
+        if (ops[i] == 0) {
+            acc += has(c, (i % 2) ? keys.present[i] : keys.absent[i]);
+        } else if (ops[i] == 1) {
+            add(c, keys.absent[i]);
+        } else {
+            c.erase(keys.present[i]);
+        }
+        t.tick();
+    }
+    sink = acc;
+}
+
+// //
+// Uniform operations on sequences; each pops from where it is cheapest
+// //
+
+template <class T> void put(List<T> &c, const T &x) { c.push_back(x); }
+template <class T> void put(std::list<T> &c, const T &x) { c.push_back(x); }
+template <class T> void put(ListLinkedSingle<T> &c, const T &x) { c.push_front(x); }
+template <class T> void put(std::forward_list<T> &c, const T &x) { c.push_front(x); }
+template <class T> void put(Stack<T> &c, const T &x) { c.push(x); }
+template <class T> void put(LinkedListStack<T> &c, const T &x) { c.push(x); }
+template <class T> void put(std::stack<T> &c, const T &x) { c.push(x); }
+template <class T> void put(Queue<T> &c, const T &x) { c.push_back(x); }
+template <class T> void put(std::queue<T> &c, const T &x) { c.push(x); }
+
+template <class T> unsigned long take(List<T> &c) { unsigned long r = touch(c.front()); c.pop_front(); return r; }
+template <class T> unsigned long take(std::list<T> &c) { unsigned long r = touch(c.front()); c.pop_front(); return r; }
+template <class T> unsigned long take(ListLinkedSingle<T> &c) { unsigned long r = touch(c.front()); c.pop_front(); return r; }
+template <class T> unsigned long take(std::forward_list<T> &c) { unsigned long r = touch(c.front()); c.pop_front(); return r; }
+template <class T> unsigned long take(Stack<T> &c) { unsigned long r = touch(c.top()); c.pop(); return r; }
+template <class T> unsigned long take(LinkedListStack<T> &c) { unsigned long r = touch(c.top()); c.pop(); return r; }
+template <class T> unsigned long take(std::stack<T> &c) { unsigned long r = touch(c.top()); c.pop(); return r; }
+template <class T> unsigned long take(Queue<T> &c) { unsigned long r = touch(c.front()); c.pop_front(); return r; }
+template <class T> unsigned long take(std::queue<T> &c) { unsigned long r = touch(c.front()); c.pop(); return r; }
+
+// //
+// Cases for sequences
+// //
+
+template <class C, class Kind>
+void push(Timer &t) {
+    Keys<Kind> elems;
+    C c;
+    t.start();
+    for (const auto &x : elems.present) {
+        put(c, x);
+        t.tick();
+    }
+}
+
+template <class C, class Kind>
+void pop(Timer &t) {
+    Keys<Kind> elems;
+    C c;
+    for (const auto &x : elems.present) {
+        put(c, x);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int i = 0; i < n; i++) {
+        acc += take(c);
+        t.tick();
+    }
+    sink = acc;
+}
+
+template <class C, class Kind>
+void copySequence(Timer &t) {
+    Keys<Kind> elems;
+    copyOf<C>(t, [&elems](C &c) {
+        for (const auto &x : elems.present) {
+            put(c, x);
+        }
+    });
+}
+
+/** Starting with n/2 elements: 60% pushes and 40% pops (pushes, if empty) */
+template <class C, class Kind>
+void mixedSequence(Timer &t) {
+    Keys<Kind> elems;
+    std::vector<unsigned char> ops = mixedOps(60);
+    C c;
+    for (unsigned int i = 0; i < n / 2; i++) {
+        put(c, elems.present[i]);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int i = 0; i < n; i++) {
+        if (ops[i] == 0 || c.empty()) {
+            put(c, elems.absent[i]);
+        } else {
+            acc += take(c);
+        }
+        t.tick();
+    }
+    sink = acc;
+}
+
+/** Only for lists that can be iterated */
+template <class C, class Kind>
+void iterateSequence(Timer &t) {
+    Keys<Kind> elems;
+    C c;
+    for (const auto &x : elems.present) {
+        put(c, x);
+    }
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        for (const auto &x : c) {
+            acc += touch(x);
+            t.tick();
+        }
+    }
+    sink = acc;
+}
+
+// //
+// Cases for binary trees
+// //
+
+/** Balanced tree with the elements of sorted[lo, hi), in order; ticks once per node */
+template <class Tree, class T>
+Tree balanced(const std::vector<T> &sorted, std::size_t lo, std::size_t hi, Timer &t) {
+    if (lo == hi) {
+        return Tree();
+    }
+    std::size_t mid = lo + (hi - lo) / 2;
+    Tree left = balanced<Tree>(sorted, lo, mid, t);
+    Tree right = balanced<Tree>(sorted, mid + 1, hi, t);
+    Tree tree(left, sorted[mid], right);
+    t.tick();
+    return tree;
+}
+
+template <class Tree, class Kind>
+void buildTree(Timer &t) {
+    Keys<Kind> elems;
+    t.start();
+    Tree tree = balanced<Tree>(elems.sorted, 0, n, t);
+    sink = tree.empty();
+}
+
+template <class Tree, class Kind>
+void iterateTree(Timer &t) {
+    Keys<Kind> elems;
+    Timer untimed;
+    Tree tree = balanced<Tree>(elems.sorted, 0, n, untimed);
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            acc += touch(*it);
+            t.tick();
+        }
+    }
+    sink = acc;
+}
+
+/** Copies share all nodes: O(1) each, so these are timed in groups */
+template <class Tree, class Kind>
+void copyTree(Timer &t) {
+    Keys<Kind> elems;
+    Timer untimed;
+    Tree tree = balanced<Tree>(elems.sorted, 0, n, untimed);
+    unsigned long acc = 0;
+    t.start();
+    for (unsigned int i = 0; i < n; i++) {
+        Tree copy(tree);
+        acc += copy.empty();
+        t.tick();
+    }
+    sink = acc;
+}
+
+// //
+// Registry and runner
+// //
+
+struct Case {
+    std::string name;
+    std::function<void(Timer &)> run;
+};
+
+static std::vector<Case> cases;
+
+template <class Kind>
+static void enlist(const std::string &container, const char *pattern, void (*run)(Timer &)) {
+    cases.push_back({container + "<" + Kind::NAME + "> " + pattern, run});
+}
+
+/** ADT a, and its std:: counterpart s, side by side for each pattern */
+template <class Kind, class A, class S>
+static void associative(const std::string &a, const std::string &s) {
+    enlist<Kind>(a, "insert-random", insertRandom<A, Kind>);
+    enlist<Kind>(s, "insert-random", insertRandom<S, Kind>);
+    enlist<Kind>(a, "insert-sorted", insertSorted<A, Kind>);
+    enlist<Kind>(s, "insert-sorted", insertSorted<S, Kind>);
+    enlist<Kind>(a, "find-hit", lookup<A, Kind, true>);
+    enlist<Kind>(s, "find-hit", lookup<S, Kind, true>);
+    enlist<Kind>(a, "find-miss", lookup<A, Kind, false>);
+    enlist<Kind>(s, "find-miss", lookup<S, Kind, false>);
+    enlist<Kind>(a, "iterate", iterate<A, Kind>);
+    enlist<Kind>(s, "iterate", iterate<S, Kind>);
+    enlist<Kind>(a, "copy", copyAssociative<A, Kind>);
+    enlist<Kind>(s, "copy", copyAssociative<S, Kind>);
+    enlist<Kind>(a, "mixed", mixedAssociative<A, Kind>);
+    enlist<Kind>(s, "mixed", mixedAssociative<S, Kind>);
+}
+
+template <class Kind, class A, class S, bool Iterable = false>
+static void sequence(const std::string &a, const std::string &s) {
+    enlist<Kind>(a, "push", push<A, Kind>);
+    enlist<Kind>(s, "push", push<S, Kind>);
+    enlist<Kind>(a, "pop", pop<A, Kind>);
+    enlist<Kind>(s, "pop", pop<S, Kind>);
+    enlist<Kind>(a, "copy", copySequence<A, Kind>);
+    enlist<Kind>(s, "copy", copySequence<S, Kind>);
+    enlist<Kind>(a, "mixed", mixedSequence<A, Kind>);
+    enlist<Kind>(s, "mixed", mixedSequence<S, Kind>);
+    if constexpr (Iterable) {
+        enlist<Kind>(a, "iterate", iterateSequence<A, Kind>);
+        enlist<Kind>(s, "iterate", iterateSequence<S, Kind>);
+    }
+}
+
+template <class Kind>
+static void registerAll() {
+    using T = typename Kind::type;
+    sequence<Kind, List<T>, std::list<T>, true>("List", "std::list");
+    sequence<Kind, ListLinkedSingle<T>, std::forward_list<T>>("ListLinkedSingle", "std::forward_list");
+    sequence<Kind, Stack<T>, std::stack<T>>("Stack", "std::stack");
+    sequence<Kind, LinkedListStack<T>, std::stack<T>>("LinkedListStack", "std::stack");
+    sequence<Kind, Queue<T>, std::queue<T>>("Queue", "std::queue");
+    for (auto pattern : {std::make_pair("build", 0), std::make_pair("iterate", 1), std::make_pair("copy", 2)}) {
+        void (*runs[3][3])(Timer &) = {
+            {buildTree<BinTree<T>, Kind>, buildTree<BinTreeSmart<T>, Kind>,
+                buildTree<BinTreeSmart<T, IntrusiveLinks>, Kind>},
+            {iterateTree<BinTree<T>, Kind>, iterateTree<BinTreeSmart<T>, Kind>,
+                iterateTree<BinTreeSmart<T, IntrusiveLinks>, Kind>},
+            {copyTree<BinTree<T>, Kind>, copyTree<BinTreeSmart<T>, Kind>,
+                copyTree<BinTreeSmart<T, IntrusiveLinks>, Kind>},
+        };
+        enlist<Kind>("BinTree", pattern.first, runs[pattern.second][0]);
+        enlist<Kind>("BinTreeSmart", pattern.first, runs[pattern.second][1]);
+        enlist<Kind>("BinTreeSmart/intrusive", pattern.first, runs[pattern.second][2]);
+    }
+    associative<Kind, TreeSet<T>, std::set<T>>("TreeSet", "std::set");
+    associative<Kind, TreeMap<T, int>, std::map<T, int>>("TreeMap", "std::map");
+    associative<Kind, HashMap<T, int>, std::unordered_map<T, int>>("HashMap", "std::unordered_map");
+}
+
+static Result measure(const Case &c) {
+    Timer t;
+    c.run(t);
+    return t.result();
+}
+
+/** Runs a case, in a child process if possible; false if it failed */
+static bool run(const Case &c, Result &r) {
+#ifdef __BENCH_FORK
+    int fds[2];
+    if (pipe(fds) == 0) {
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            Result child = measure(c);
+            bool sent = write(fds[1], &child, sizeof(child)) == static_cast<ssize_t>(sizeof(child));
+            _exit(sent ? 0 : 1);
+        }
+        close(fds[1]);
+        bool received = pid > 0 && read(fds[0], &r, sizeof(r)) == static_cast<ssize_t>(sizeof(r));
+        close(fds[0]);
+        int status = 0;
+        struct rusage usage;
+        if (pid <= 0 || wait4(pid, &status, 0, &usage) != pid) {
+            return false;
+        }
+#ifdef __APPLE__
+        r.peakKb = usage.ru_maxrss / 1024; // bytes
+#else
+        r.peakKb = usage.ru_maxrss;        // kilobytes
+#endif
+        return received && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+#endif
+    r = measure(c);
+    return true;
+}
+
+/** 1234567 as "1.23M" */
+static std::string withPrefix(double v) {
+    const char *prefixes[] = {"", "k", "M", "G"};
+    int i = 0;
+    while (v >= 1000 && i < 3) {
+        v /= 1000;
+        i++;
+    }
+    std::ostringstream out;
+    out << std::setprecision(3) << v << prefixes[i];
+    return out.str();
+}
+
+/** 1234567 nanoseconds as "1.23ms" */
+static std::string nanos(double ns) {
+    const char *units[] = {"ns", "us", "ms", "s"};
+    int i = 0;
+    while (ns >= 1000 && i < 3) {
+        ns /= 1000;
+        i++;
+    }
+    std::ostringstream out;
+    out << std::setprecision(3) << ns << units[i];
+    return out.str();
+}
+
+int main(int argc, char **argv) {
+    n = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    std::string filter = (argc > 2) ? argv[2] : "";
+
+    registerAll<IntKeys>();
+    registerAll<ShortKeys>();
+    registerAll<LongKeys>();
+
+    calibrateClock();
+    std::cout << n << " elements per case; " << clockOverhead
+              << "ns per clock reading, not counted in latencies" << std::endl;
+    std::cout << std::left << std::setw(48) << "case" << std::right << std::setw(10) << "ops/s"
+              << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+              << std::setw(12) << "peak RSS" << std::endl;
+    bool ok = true;
+    for (const Case &c : cases) {
+        if (c.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cout << std::left << std::setw(48) << c.name << std::right;
+        Result r;
+        if ( ! run(c, r)) {
+            std::cout << "    failed" << std::endl;
+            ok = false;
+            continue;
+        }
+        double throughput = (r.seconds > 0) ? r.ops / r.seconds : 0;
+        std::cout << std::setw(10) << withPrefix(throughput) << std::setw(10) << nanos(r.p50)
+                  << std::setw(10) << nanos(r.p90) << std::setw(10) << nanos(r.p99)
+                  << std::setw(12) << (r.peakKb < 0 ? std::string("-")
+                        : withPrefix(r.peakKb / 1024.0) + "MB") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+/**
+ * Build-and-discard cost of many small trees: BinTree vs. ArenaBinTree
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/ArenaBinTreeBench.cpp -o arena-bench
+ *     ./arena-bench [requests] [trees] [nodes]     (defaults to 100 10000 64)
+ *
+ * Simulates `requests` requests, each of which builds `trees` random trees
+ * of `nodes` nodes, walks them, and then drops all of them. BinTrees count
+ * references and delete nodes one by one; ArenaBinTrees release the
+ * whole arena at the end of each request.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "BinTree.h"
+#include "ArenaBinTree.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/** Random BinTree with n nodes */
+static BinTree<int> build(unsigned int n, std::mt19937 &rng) {
+    if (n == 0) {
+        return BinTree<int>();
+    }
+    unsigned int leftNodes = rng() % n;
+    BinTree<int> left = build(leftNodes, rng);
+    BinTree<int> right = build(n - 1 - leftNodes, rng);
+    return BinTree<int>(left, (int)n, right);
+}
+
+/** Random ArenaBinTree with n nodes, with the same shape as build() */
+static ArenaBinTree<int> build(TreeArena<int> &arena, unsigned int n, std::mt19937 &rng) {
+    if (n == 0) {
+        return ArenaBinTree<int>();
+    }
+    unsigned int leftNodes = rng() % n;
+    ArenaBinTree<int> left = build(arena, leftNodes, rng);
+    ArenaBinTree<int> right = build(arena, n - 1 - leftNodes, rng);
+    return ArenaBinTree<int>(arena, left, (int)n, right);
+}
+
+int main(int argc, char **argv) {
+    unsigned int requests = (argc > 1) ? std::atoi(argv[1]) : 100;
+    unsigned int trees = (argc > 2) ? std::atoi(argv[2]) : 10000;
+    unsigned int nodes = (argc > 3) ? std::atoi(argv[3]) : 64;
+
+    std::mt19937 rng(42);
+    auto start = Clock::now();
+    for (unsigned int r = 0; r < requests; r++) {
+        std::vector<BinTree<int>> built;
+        for (unsigned int i = 0; i < trees; i++) {
+            built.push_back(build(nodes, rng));
+            sink = built.back().depth();
+        }
+    }
+    double refSecs = seconds(start);
+    std::cout << "BinTree\t\t" << refSecs << " s" << std::endl;
+
+    rng.seed(42);
+    TreeArena<int> arena;
+    start = Clock::now();
+    for (unsigned int r = 0; r < requests; r++) {
+        std::vector<ArenaBinTree<int>> built;
+        for (unsigned int i = 0; i < trees; i++) {
+            built.push_back(build(arena, nodes, rng));
+            sink = built.back().depth();
+        }
+        arena.release();
+    }
+    double arenaSecs = seconds(start);
+    std::cout << "ArenaBinTree\t" << arenaSecs << " s\tspeedup "
+              << refSecs / arenaSecs << "x" << std::endl;
+    return 0;
+}
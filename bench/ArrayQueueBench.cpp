@@ -0,0 +1,73 @@
+/**
+ * Push/pop throughput of ArrayQueue (circular array) vs. the linked Queue
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/ArrayQueueBench.cpp -o queue-bench
+ *     ./queue-bench [operations] [window]     (defaults to 10000000 1000)
+ *
+ * Keeps `window` elements queued, as a work-dispatch loop would, and then
+ * performs `operations` push_back + pop_front pairs; then runs a
+ * breadth-first traversal of a complete binary tree with its nodes
+ * numbered as in a heap, which lets the queue grow to half the tree.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "Queue.h"
+#include "ArrayQueue.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Q>
+void run(const char *name, unsigned int ops, unsigned int window) {
+    Q queue;
+    for (unsigned int i = 0; i < window; i++) {
+        queue.push_back(i);
+    }
+    unsigned long acc = 0;
+    auto start = Clock::now();
+    for (unsigned int i = 0; i < ops; i++) {
+        acc += queue.front();
+        queue.pop_front();
+        queue.push_back(i);
+    }
+    double steadySecs = seconds(start);
+
+    // children of node i are 2i+1 and 2i+2
+    Q bfs;
+    start = Clock::now();
+    bfs.push_back(0);
+    while ( ! bfs.empty()) {
+        unsigned int current = bfs.front();
+        bfs.pop_front();
+        acc += current;
+        if (2 * current + 2 < ops) {
+            bfs.push_back(2 * current + 1);
+            bfs.push_back(2 * current + 2);
+        }
+    }
+    double bfsSecs = seconds(start);
+    sink = acc;
+
+    double n = ops / 1e6;
+    std::cout << name << "\tpush+pop " << n / steadySecs << " M/s"
+              << "\tbfs " << n / bfsSecs << " M/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    unsigned int ops = (argc > 1) ? std::atoi(argv[1]) : 10000000;
+    unsigned int window = (argc > 2) ? std::atoi(argv[2]) : 1000;
+
+    run<Queue<unsigned int>>("Queue", ops, window);
+    run<ArrayQueue<unsigned int>>("ArrayQueue", ops, window);
+    return 0;
+}
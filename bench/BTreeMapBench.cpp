@@ -0,0 +1,86 @@
+/**
+ * Lookup and scan throughput of BTreeMap vs. the binary TreeMap
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/BTreeMapBench.cpp -o btree-bench
+ *     ./btree-bench [entries...]       (defaults to 1000000 10000000)
+ *
+ * For each size, inserts n random keys, performs n successful lookups in
+ * random order, and then iterates the whole map, reporting millions of
+ * operations per second.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "TreeMap.h"
+#include "BTreeMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding lookups whose results are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Map>
+void run(const char *name, const std::vector<unsigned int> &keys,
+         const std::vector<unsigned int> &hits) {
+    Map map;
+    auto start = Clock::now();
+    for (unsigned int k : keys) {
+        map.insert(k, k);
+    }
+    double insertSecs = seconds(start);
+
+    unsigned long acc = 0;
+    start = Clock::now();
+    for (unsigned int k : hits) {
+        acc += map.at(k);
+    }
+    double hitSecs = seconds(start);
+
+    start = Clock::now();
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        acc += it.value();
+    }
+    double scanSecs = seconds(start);
+    sink = acc;
+
+    double n = keys.size() / 1e6;
+    std::cout << "  " << name
+              << "\tinsert " << n / insertSecs << " M/s"
+              << "\thit " << n / hitSecs << " M/s"
+              << "\tscan " << map.size() / 1e6 / scanSecs << " M/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::vector<unsigned int> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {1000000, 10000000};
+    }
+
+    for (unsigned int n : sizes) {
+        std::mt19937 rng(n);
+        std::vector<unsigned int> keys(n);
+        for (unsigned int &k : keys) {
+            k = rng();
+        }
+        std::vector<unsigned int> hits(keys);
+        std::shuffle(hits.begin(), hits.end(), rng);
+
+        std::cout << n << " entries" << std::endl;
+        run<TreeMap<unsigned int, unsigned int>>("TreeMap", keys, hits);
+        run<BTreeMap<unsigned int, unsigned int>>("BTreeMap", keys, hits);
+    }
+    return 0;
+}
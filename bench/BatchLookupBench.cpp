@@ -0,0 +1,91 @@
+/**
+ * One-at-a-time vs. batched lookups (contains_batch) in HashMap and TreeMap
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/BatchLookupBench.cpp -o batch-bench
+ *     ./batch-bench [entries] [lookups]     (defaults to 4000000 4000000)
+ *
+ * Inserts `entries` random keys, and then looks up `lookups` random keys
+ * (half of them present) first with contains() and then with contains_batch(),
+ * both for int and for (short) string keys.
+ * Maps much larger than the caches make every lookup wait for memory;
+ * batches overlap those waits. Out-of-order cores already overlap some of them
+ * for cheap, independent lookups, such as those of ints in a HashMap.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HashMap.h"
+#include "TreeMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Map, typename K>
+void run(const char *name, const std::vector<K> &keys, const std::vector<K> &queries) {
+    Map map;
+    for (const K &k : keys) {
+        map.insert(k, 1);
+    }
+
+    unsigned long found = 0;
+    auto start = Clock::now();
+    for (const K &k : queries) {
+        found += map.contains(k);
+    }
+    double singleSecs = seconds(start);
+
+    bool *out = new bool[queries.size()];
+    start = Clock::now();
+    map.contains_batch(queries.data(), queries.size(), out);
+    double batchSecs = seconds(start);
+    for (unsigned int i = 0; i < queries.size(); i++) {
+        found += out[i];
+    }
+    delete[] out;
+    sink = found;
+
+    double n = queries.size() / 1e6;
+    std::cout << name << "\tcontains " << n / singleSecs << " M/s\tcontains_batch "
+              << n / batchSecs << " M/s\tspeedup " << singleSecs / batchSecs << "x" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 4000000;
+    unsigned int lookups = (argc > 2) ? std::atoi(argv[2]) : 4000000;
+
+    std::mt19937 rng(42);
+    std::vector<int> keys(n), queries(lookups);
+    for (int &k : keys) {
+        k = rng() & 0x7fffffff;
+    }
+    for (unsigned int i = 0; i < lookups; i++) {
+        // odd queries are (almost certainly) misses
+        queries[i] = (i % 2 == 0) ? keys[rng() % n] : (int)(rng() & 0x7fffffff);
+    }
+
+    run<HashMap<int, int>>("HashMap<int>", keys, queries);
+    run<TreeMap<int, int>>("TreeMap<int>", keys, queries);
+
+    std::vector<std::string> strKeys, strQueries;
+    for (int k : keys) {
+        strKeys.push_back("key" + std::to_string(k));
+    }
+    for (int k : queries) {
+        strQueries.push_back("key" + std::to_string(k));
+    }
+    run<HashMap<std::string, int, Hash<std::string>>>("HashMap<string>", strKeys, strQueries);
+    run<TreeMap<std::string, int>>("TreeMap<string>", strKeys, strQueries);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * Sequential vs. parallel aggregates and traversals on a large BinTree
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -pthread -Iadts bench/BinTreeParallelBench.cpp -o bintree-bench
+ *     ./bintree-bench [nodes] [threads] [cutoff]    (defaults to 10000000, all hardware threads, 4096)
+ *
+ * Builds a random binary tree (each subtree splits its nodes at random between
+ * left and right), and reports the time taken by nodeCount, depth, a fold, map
+ * and inOrder, first sequentially and then with the given ParallelOptions.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "BinTree.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/** Random tree with n nodes, numbered in-order starting at next */
+static BinTree<int> build(unsigned int n, int &next, std::mt19937 &rng) {
+    if (n == 0) {
+        return BinTree<int>();
+    }
+    unsigned int leftNodes = rng() % n;
+    BinTree<int> left = build(leftNodes, next, rng);
+    int elem = next++;
+    BinTree<int> right = build(n - 1 - leftNodes, next, rng);
+    return BinTree<int>(left, elem, right);
+}
+
+/** Times op() run with no options, and with options, as "name seq par speedup" */
+template <typename Op>
+static void compare(const char *name, Op op, const ParallelOptions &options) {
+    auto start = Clock::now();
+    op(nullptr);
+    double seqSecs = seconds(start);
+    start = Clock::now();
+    op(&options);
+    double parSecs = seconds(start);
+    std::cout << name << "\tseq " << seqSecs << " s\tpar " << parSecs << " s"
+              << "\tspeedup " << seqSecs / parSecs << "x" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 10000000;
+    unsigned int threads = (argc > 2) ? std::atoi(argv[2]) : 0;
+    unsigned int cutoff = (argc > 3) ? std::atoi(argv[3]) : ParallelOptions::DEFAULT_CUTOFF;
+    ParallelOptions options(threads, cutoff);
+
+    std::mt19937 rng(42);
+    int next = 0;
+    BinTree<int> tree = build(n, next, rng);
+    std::cout << n << " nodes, " << ForkJoinPool::threadCount(threads) << " threads, cutoff "
+              << cutoff << std::endl;
+
+    compare("nodeCount", [&](const ParallelOptions *o) {
+        sink = o ? tree.nodeCount(*o) : tree.nodeCount();
+    }, options);
+    compare("depth", [&](const ParallelOptions *o) {
+        sink = o ? tree.depth(*o) : tree.depth();
+    }, options);
+    auto sum = [](long left, int elem, long right) { return left + elem + right; };
+    compare("fold sum", [&](const ParallelOptions *o) {
+        sink = o ? tree.fold(0L, sum, *o) : tree.fold(0L, sum);
+    }, options);
+    auto twice = [](int elem) { return 2 * elem; };
+    compare("map", [&](const ParallelOptions *o) {
+        BinTree<int> mapped = o ? tree.map(twice, *o) : tree.map(twice);
+        sink = mapped.elem();
+    }, options);
+    compare("inOrder", [&](const ParallelOptions *o) {
+        List<int> *elems = o ? tree.inOrder(*o) : tree.inOrder();
+        sink = elems->size();
+        delete elems;
+    }, options);
+    return 0;
+}
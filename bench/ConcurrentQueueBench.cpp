@@ -0,0 +1,127 @@
+/**
+ * Throughput of SPSCQueue and MPMCQueue vs. a Queue guarded by a mutex
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -pthread -Iadts bench/ConcurrentQueueBench.cpp -o cqueue-bench
+ *     ./cqueue-bench [elements] [max-threads]        (defaults to 10000000 32)
+ *
+ * For 1, 2, 4 ... max-threads threads, half of them (rounding up) push
+ * `elements` elements in total, and the rest pop them; with a single thread,
+ * that thread alternates pushes and pops. Reports millions of elements
+ * through the queue per second. SPSCQueue is only run with 1 producer and 1 consumer.
+ * A full or empty queue makes threads yield and retry; with more threads
+ * than cores, those retries (and the thread holding the mutex being
+ * descheduled) are part of what is measured.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Queue.h"
+#include "ConcurrentQueue.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Capacity of bounded queues */
+static const std::size_t CAPACITY = 1024;
+
+/** Keeps the optimizer from discarding results that are not used */
+static std::atomic<unsigned long> sink;
+
+/** Queue guarded by a mutex, with the same try_push/try_pop interface */
+class LockedQueue {
+public:
+    explicit LockedQueue(std::size_t capacity) : _capacity(capacity) {}
+
+    bool try_push(unsigned long elem) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (static_cast<std::size_t>(_queue.size()) == _capacity) {
+            return false;
+        }
+        _queue.push_back(elem);
+        return true;
+    }
+
+    bool try_pop(unsigned long &out) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_queue.empty()) {
+            return false;
+        }
+        out = _queue.front();
+        _queue.pop_front();
+        return true;
+    }
+
+private:
+    std::size_t _capacity;
+    std::mutex _mutex;
+    Queue<unsigned long> _queue;
+};
+
+template <typename Q>
+void run(const char *name, unsigned int n, unsigned int threads) {
+    Q queue(CAPACITY);
+    auto start = Clock::now();
+    if (threads == 1) {
+        unsigned long acc = 0, out = 0;
+        for (unsigned long i = 0; i < n; i++) {
+            queue.try_push(i);
+            queue.try_pop(out);
+            acc += out;
+        }
+        sink += acc;
+    } else {
+        unsigned int producers = (threads + 1) / 2;
+        unsigned int consumers = threads - producers;
+        std::vector<std::thread> workers;
+        for (unsigned int p = 0; p < producers; p++) {
+            // first producers push one element more if n does not divide evenly
+            unsigned long count = n / producers + (p < n % producers ? 1 : 0);
+            workers.emplace_back([&queue, count]() {
+                for (unsigned long i = 0; i < count; i++) {
+                    while ( ! queue.try_push(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (unsigned int c = 0; c < consumers; c++) {
+            unsigned long count = n / consumers + (c < n % consumers ? 1 : 0);
+            workers.emplace_back([&queue, count]() {
+                unsigned long acc = 0, out;
+                for (unsigned long i = 0; i < count; i++) {
+                    while ( ! queue.try_pop(out)) {
+                        std::this_thread::yield();
+                    }
+                    acc += out;
+                }
+                sink += acc;
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  " << name << "\t" << n / 1e6 / secs << " M/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 10000000;
+    unsigned int maxThreads = (argc > 2) ? std::atoi(argv[2]) : 32;
+
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        std::cout << threads << " threads" << std::endl;
+        if (threads <= 2) {
+            run<SPSCQueue<unsigned long>>("SPSCQueue", n, threads);
+        }
+        run<MPMCQueue<unsigned long>>("MPMCQueue", n, threads);
+        run<LockedQueue>("mutex+Queue", n, threads);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * Lookup throughput of FlatHashMap and SwissHashMap vs. the chained HashMap
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/FlatHashMapBench.cpp -o flat-bench
+ *     ./flat-bench [entries...]        (defaults to 1000000 10000000)
+ *
+ * For each size, inserts n random keys and then performs n successful and
+ * n unsuccessful lookups in random order, reporting millions of lookups per second.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "HashMap.h"
+#include "FlatHashMap.h"
+#include "SwissHashMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding lookups whose results are not used */
+static volatile unsigned long sink;
+
+template <typename Map>
+void run(const char *name, const std::vector<unsigned int> &keys,
+         const std::vector<unsigned int> &hits, const std::vector<unsigned int> &misses) {
+    Map map;
+    auto start = Clock::now();
+    for (unsigned int k : keys) {
+        map.insert(k, k);
+    }
+    double insertSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    unsigned long found = 0;
+    start = Clock::now();
+    for (unsigned int k : hits) {
+        found += map.at(k);
+    }
+    double hitSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (unsigned int k : misses) {
+        found += map.contains(k);
+    }
+    double missSecs = std::chrono::duration<double>(Clock::now() - start).count();
+    sink = found;
+
+    double n = keys.size() / 1e6;
+    std::cout << "  " << name
+              << "\tinsert " << n / insertSecs << " M/s"
+              << "\thit " << n / hitSecs << " M/s"
+              << "\tmiss " << n / missSecs << " M/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::vector<unsigned int> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {1000000, 10000000};
+    }
+
+    for (unsigned int n : sizes) {
+        // inserted keys have their top bit clear; setting it yields a guaranteed miss
+        std::mt19937 rng(n);
+        std::vector<unsigned int> keys(n), misses(n);
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int k = rng() & 0x7fffffffu;
+            keys[i] = k;
+            misses[i] = k | 0x80000000u;
+        }
+        std::vector<unsigned int> hits(keys);
+        std::shuffle(hits.begin(), hits.end(), rng);
+
+        std::cout << n << " entries" << std::endl;
+        run<HashMap<unsigned int, unsigned int>>("HashMap", keys, hits, misses);
+        run<FlatHashMap<unsigned int, unsigned int>>("FlatHashMap", keys, hits, misses);
+        run<SwissHashMap<unsigned int, unsigned int>>("SwissHashMap", keys, hits, misses);
+    }
+    return 0;
+}
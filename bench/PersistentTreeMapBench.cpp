@@ -0,0 +1,73 @@
+/**
+ * Taking snapshots of a map: copying a TreeMap vs. sharing a PersistentTreeMap
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/PersistentTreeMapBench.cpp -o persistent-bench
+ *     ./persistent-bench [entries] [updates] [every]     (defaults to 1000000 100000 1000)
+ *
+ * Fills a map with `entries` random keys, and then performs `updates` random
+ * inserts and erases, taking a snapshot every `every` updates (as when handing
+ * read-only versions to reporting threads). Reports the time spent on updates
+ * and on snapshots with each map.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "TreeMap.h"
+#include "PersistentTreeMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Map>
+void run(const char *name, unsigned int n, unsigned int updates, unsigned int every) {
+    std::mt19937 rng(42);
+    Map map;
+    for (unsigned int i = 0; i < n; i++) {
+        map.insert(rng() % (2 * n), i);
+    }
+
+    double updateSecs = 0, snapshotSecs = 0;
+    std::vector<Map> snapshots;
+    for (unsigned int i = 0; i < updates; i++) {
+        auto start = Clock::now();
+        unsigned int k = rng() % (2 * n);
+        if (i % 2 == 0) {
+            map.insert(k, i);
+        } else {
+            map.erase(k);
+        }
+        updateSecs += seconds(start);
+        if (i % every == 0) {
+            start = Clock::now();
+            snapshots.push_back(map); // the copy is the snapshot
+            snapshotSecs += seconds(start);
+            if (snapshots.size() > 4) {
+                snapshots.erase(snapshots.begin()); // oldest reader is done
+            }
+        }
+    }
+    sink = map.size() + snapshots.size();
+    std::cout << name << "\tupdates " << updateSecs << " s\tsnapshots " << snapshotSecs
+              << " s\t(" << updates / every << " snapshots)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    unsigned int updates = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    unsigned int every = (argc > 3) ? std::atoi(argv[3]) : 1000;
+
+    run<TreeMap<unsigned int, unsigned int>>("TreeMap", n, updates, every);
+    run<PersistentTreeMap<unsigned int, unsigned int>>("PersistentTreeMap", n, updates, every);
+    return 0;
+}
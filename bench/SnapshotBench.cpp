@@ -0,0 +1,93 @@
+/**
+ * Cold start of a HashMap: parsing text vs. loading a snapshot vs. mapping it
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/SnapshotBench.cpp -o snapshot-bench
+ *     ./snapshot-bench [entries] [file]     (defaults to 4000000 snapshot.bin)
+ *
+ * Saves a map of `entries` random int keys both as text ("key value" lines) and
+ * as a snapshot, and then times how long it takes to get to the 1st lookup
+ * (and through 100000 lookups) after rebuilding from the text, loading the
+ * snapshot into a HashMap, or viewing the snapshot through a MappedFile.
+ * The file is left behind; the OS will usually still have it cached.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "HashMap.h"
+#include "Snapshot.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Map>
+static unsigned long lookups(const Map &map, const std::vector<int> &queries) {
+    unsigned long found = 0;
+    for (int q : queries) {
+        found += map.contains(q);
+    }
+    return found;
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 4000000;
+    std::string path = (argc > 2) ? argv[2] : "snapshot.bin";
+
+    std::mt19937 rng(42);
+    HashMap<int, int> map;
+    std::ostringstream text;
+    for (unsigned int i = 0; i < n; i++) {
+        int k = rng() & 0x7fffffff;
+        map.insert(k, i);
+        text << k << ' ' << i << '\n';
+    }
+    {
+        std::ofstream out(path, std::ios::binary);
+        save_snapshot(map, out);
+    }
+    std::vector<int> queries(100000);
+    for (int &q : queries) {
+        q = rng() & 0x7fffffff;
+    }
+
+    auto start = Clock::now();
+    std::istringstream in(text.str());
+    HashMap<int, int> parsed;
+    int k, v;
+    while (in >> k >> v) {
+        parsed.insert(k, v);
+    }
+    sink = lookups(parsed, queries);
+    std::cout << "text\t\t" << seconds(start) << " s" << std::endl;
+
+    start = Clock::now();
+    HashMap<int, int> loaded;
+    {
+        std::ifstream file(path, std::ios::binary);
+        load_snapshot(file, loaded);
+    }
+    sink = lookups(loaded, queries);
+    std::cout << "load_snapshot\t" << seconds(start) << " s" << std::endl;
+
+    start = Clock::now();
+    MappedFile file(path);
+    HashMapView<int, int> view(file);
+    double openSecs = seconds(start);
+    sink = lookups(view, queries);
+    std::cout << "mmap view\t" << seconds(start) << " s\t(" << openSecs * 1e3
+              << " ms to open)" << std::endl;
+    return 0;
+}
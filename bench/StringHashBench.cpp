@@ -0,0 +1,93 @@
+/**
+ * String hashing: byte-at-a-time FNV vs. the wide-word hash of Hash.h
+ *
+ * Build & run (from the repository root):
+ *     g++ -O2 -std=c++17 -Iadts bench/StringHashBench.cpp -o hash-bench
+ *     ./hash-bench [keys] [rounds]     (defaults to 100000 20)
+ *
+ * For several key lengths (short identifiers to long lines), hashes `keys`
+ * random keys `rounds` times with each function, and reports GB/s; then
+ * looks up every key in a HashMap<std::string, int> that uses each of them.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+#include "HashMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Keeps the optimizer from discarding results that are not used */
+static volatile unsigned long sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/** The previous Hash<std::string>: FNV, one byte at a time */
+struct FnvHash {
+    std::size_t operator()(const std::string &key) const {
+        return fnv_hash(key);
+    }
+};
+
+template <typename H>
+static double hashSecs(const std::vector<std::string> &keys, unsigned int rounds) {
+    H hash;
+    unsigned long acc = 0;
+    auto start = Clock::now();
+    for (unsigned int r = 0; r < rounds; r++) {
+        for (const std::string &key : keys) {
+            acc += hash(key);
+        }
+    }
+    sink = acc;
+    return seconds(start);
+}
+
+template <typename H>
+static double lookupSecs(const std::vector<std::string> &keys, unsigned int rounds) {
+    HashMap<std::string, int, H> map;
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        map.insert(keys[i], i);
+    }
+    unsigned long acc = 0;
+    auto start = Clock::now();
+    for (unsigned int r = 0; r < rounds; r++) {
+        for (const std::string &key : keys) {
+            acc += map.at(key);
+        }
+    }
+    sink = acc;
+    return seconds(start);
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    unsigned int rounds = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 rng(42);
+    for (unsigned int length : {4u, 8u, 16u, 32u, 64u, 256u, 1024u}) {
+        std::vector<std::string> keys(n);
+        for (std::string &key : keys) {
+            for (unsigned int i = 0; i < length; i++) {
+                key.push_back('a' + rng() % 26);
+            }
+        }
+        double bytes = (double)n * length * rounds;
+        double fnv = hashSecs<FnvHash>(keys, rounds);
+        double wide = hashSecs<Hash<std::string>>(keys, rounds);
+        std::cout << length << " bytes\thash: fnv " << bytes / fnv / 1e9 << " GB/s\twide "
+                  << bytes / wide / 1e9 << " GB/s";
+        double fnvMap = lookupSecs<FnvHash>(keys, rounds);
+        double wideMap = lookupSecs<Hash<std::string>>(keys, rounds);
+        std::cout << "\tHashMap lookups: fnv " << fnvMap << " s\twide " << wideMap
+                  << " s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * Moves of ADTs: they must not throw, and must leave usable, empty objects
+ *
+ * Build & run (from the repository root):
+ *     g++ -std=c++17 -Iadts tests/MoveTest.cpp -o move-test && ./move-test
+ *
+ * Checks at compile time that move ctors and move assignments are noexcept, so
+ * that std::vector and friends move (instead of copying) ADTs when reallocating;
+ * and at run time that moved-from objects are empty, and can be used as such.
+ * Exits with a non-zero status, after printing what failed, if any check fails.
+ */
+
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ArrayQueue.h"
+#include "BTreeMap.h"
+#include "BinTree.h"
+#include "FlatHashMap.h"
+#include "HashMap.h"
+#include "IntrusivePtr.h"
+#include "LinkedListStack.h"
+#include "List.h"
+#include "PersistentTreeMap.h"
+#include "Queue.h"
+#include "Stack.h"
+#include "SwissHashMap.h"
+#include "TreeMap.h"
+#include "TreeSet.h"
+#include "UnrolledList.h"
+
+template <typename T>
+constexpr bool nothrowMovable() {
+    return std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value;
+}
+
+struct Counted : IntrusiveRefCount {};
+
+static_assert(nothrowMovable<ArrayQueue<std::string>>(), "ArrayQueue");
+static_assert(nothrowMovable<BTreeMap<int, std::string>>(), "BTreeMap");
+static_assert(nothrowMovable<BinTree<std::string>>(), "BinTree");
+static_assert(nothrowMovable<FlatHashMap<int, std::string>>(), "FlatHashMap");
+static_assert(nothrowMovable<HashMap<int, std::string>>(), "HashMap");
+static_assert(nothrowMovable<IntrusivePtr<Counted>>(), "IntrusivePtr");
+static_assert(nothrowMovable<LinkedListStack<std::string>>(), "LinkedListStack");
+static_assert(nothrowMovable<List<std::string>>(), "List");
+static_assert(nothrowMovable<PersistentTreeMap<int, std::string>>(), "PersistentTreeMap");
+static_assert(nothrowMovable<Queue<std::string>>(), "Queue");
+static_assert(nothrowMovable<Stack<std::string>>(), "Stack");
+static_assert(nothrowMovable<SwissHashMap<int, std::string>>(), "SwissHashMap");
+static_assert(nothrowMovable<TreeMap<int, std::string>>(), "TreeMap");
+static_assert(nothrowMovable<TreeSet<std::string>>(), "TreeSet");
+static_assert(nothrowMovable<UnrolledList<std::string>>(), "UnrolledList");
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what) {
+    if ( ! ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * Moves a map of n entries, then checks that both the target and the
+ * moved-from map (which must be empty) work: lookups, copies, and insertions.
+ */
+template <typename Map>
+void checkMap(const std::string &name, int n) {
+    Map map;
+    for (int i = 0; i < n; i++) {
+        map.insert(i, std::to_string(i));
+    }
+    Map target(std::move(map));
+    check(target.size() == n && target.contains(n - 1), name + ": target of move ctor");
+    check(map.empty() && ! map.contains(0), name + ": moved-from is empty");
+    check(map.begin() == map.end(), name + ": moved-from iterates nothing");
+    map.erase(0);
+
+    Map copied(map);
+    check(copied.empty(), name + ": copy of moved-from");
+    copied.insert(1, "1");
+    check(copied.size() == 1 && copied.at(1) == "1", name + ": insert into copy of moved-from");
+
+    for (int i = 0; i < n; i++) {
+        map.insert(i, std::to_string(-i));
+    }
+    check(map.size() == n && map.at(n - 1) == std::to_string(1 - n), name + ": reused after move");
+
+    target = std::move(map);
+    check(target.size() == n && map.empty(), name + ": move assignment");
+    map = target;
+    check(map.size() == n, name + ": copy into moved-from");
+}
+
+/** Vector reallocation must move its elements, leaving their addresses inside valid */
+template <typename Map>
+void checkVectorOf(const std::string &name) {
+    std::vector<Map> maps(1);
+    maps[0].insert(1, "one");
+    for (int i = 0; i < 100; i++) {
+        maps.emplace_back();
+    }
+    check(maps[0].at(1) == "one", name + ": vector reallocations");
+}
+
+int main() {
+    checkMap<HashMap<int, std::string>>("HashMap", 1000);
+    checkMap<FlatHashMap<int, std::string>>("FlatHashMap", 1000);
+    checkMap<SwissHashMap<int, std::string>>("SwissHashMap", 1000);
+    checkVectorOf<HashMap<int, std::string>>("HashMap");
+    checkVectorOf<FlatHashMap<int, std::string>>("FlatHashMap");
+    checkVectorOf<SwissHashMap<int, std::string>>("SwissHashMap");
+
+    HashMap<int, std::string> reserved;
+    HashMap<int, std::string> taken(std::move(reserved));
+    reserved.reserve(100);
+    check(reserved.bin_count() >= HashMap<int, std::string>::INITIAL_BIN_COUNT,
+          "HashMap: reserve on moved-from");
+
+    if (failures == 0) {
+        std::cout << "all moves OK" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}